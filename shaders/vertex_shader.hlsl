@@ -6,6 +6,13 @@ cbuffer TransformationBuffer : register(b0)
 	matrix ProjectionMatrix;
 };
 
+// Decodes the positions of compact vertices, see CompactVertexDecode in meshcompact.h
+cbuffer VertexDecodeBuffer : register(b1)
+{
+	float4 PositionScale;
+	float4 PositionOffset;
+};
+
 struct VSIn
 {
 	float3 Pos : POSITION;
@@ -15,6 +22,14 @@ struct VSIn
 	float2 TexCoord : TEX;
 };
 
+// CompactVertex in meshcompact.h
+struct VSCompactIn
+{
+	float4 Pos : POSITION; // position and handedness, before decoding
+	float4 Frame : FRAME; // octahedral normal (xy) and tangent (zw)
+	float2 TexCoord : TEX;
+};
+
 struct PSIn
 {
 	float4 Pos  : SV_Position;
@@ -49,4 +64,30 @@ PSIn VS_main(VSIn input)
 	output.TexCoord = input.TexCoord;
 	
 	return output;
-}
\ No newline at end of file
+}
+
+//-----------------------------------------------------------------------------------------
+// Vertex Shader for compact vertices
+//-----------------------------------------------------------------------------------------
+
+float3 OctDecode(float2 e)
+{
+	float3 v = float3(e, 1 - abs(e.x) - abs(e.y));
+	float t = saturate(-v.z);
+	v.xy += v.xy >= 0 ? -t : t;
+	return normalize(v);
+}
+
+PSIn VS_compact(VSCompactIn input)
+{
+	float4 pos = input.Pos * PositionScale + PositionOffset;
+
+	VSIn decoded;
+	decoded.Pos = pos.xyz;
+	decoded.Normal = OctDecode(input.Frame.xy);
+	decoded.Tangent = OctDecode(input.Frame.zw);
+	decoded.Binormal = cross(decoded.Normal, decoded.Tangent) * pos.w;
+	decoded.TexCoord = input.TexCoord;
+
+	return VS_main(decoded);
+}
@@ -0,0 +1,73 @@
+//
+//  Monotonic arena for loader temporaries
+//
+
+#include <cstdint>
+#include <algorithm>
+#include "arena.h"
+
+const size_t LoadArena::MinBlockSize;
+
+LoadArena::~LoadArena()
+{
+	for (auto& block : m_blocks)
+		::operator delete(block.data);
+}
+
+void* LoadArena::Allocate(size_t bytes, size_t alignment)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_blocks.size())
+	{
+		const block_t& block = m_blocks.back();
+		const uintptr_t top = (uintptr_t)block.data + m_top;
+		const size_t padding = (size_t)(((top + alignment - 1) & ~(uintptr_t)(alignment - 1)) - top);
+		if (bytes <= block.size - m_top && padding <= block.size - m_top - bytes)
+		{
+			m_top += padding + bytes;
+			m_used += padding + bytes;
+			return (void*)(top + padding);
+		}
+	}
+
+	// New block, at least twice the previous one so a load needs few of them.
+	// Blocks come from operator new and are aligned for any type.
+	size_t size = (std::max)(bytes, MinBlockSize);
+	if (m_blocks.size())
+		size = (std::max)(size, 2 * m_blocks.back().size);
+	m_blocks.push_back({ nullptr, size });
+	m_blocks.back().data = static_cast<char*>(::operator new(size));
+	m_heapAllocations++;
+
+	m_top = bytes;
+	m_used += bytes;
+	return m_blocks.back().data;
+}
+
+void LoadArena::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// The largest block that may be retained is kept as it is, rather than replaced by a
+	// larger one, which would allocate while nothing is loading
+	block_t kept = { nullptr, 0 };
+	for (auto& block : m_blocks)
+		if (block.size <= MESH_ARENA_MAX_RETAINED && block.size > kept.size)
+			kept = block;
+	for (auto& block : m_blocks)
+		if (block.data != kept.data)
+			::operator delete(block.data);
+	m_blocks.clear();
+	if (kept.data)
+		m_blocks.push_back(kept);
+
+	m_top = 0;
+	m_used = 0;
+}
+
+LoadArena& LoadArena::ForThread()
+{
+	static thread_local LoadArena arena;
+	return arena;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file arena.h
+ * @brief Monotonic arena for the temporary arrays of a mesh load
+*/
+
+#pragma once
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+//! Largest arena (in bytes) a thread keeps between loads. Memory above this is freed when a load ends.
+#ifndef MESH_ARENA_MAX_RETAINED
+#define MESH_ARENA_MAX_RETAINED ((size_t)4 << 20)
+#endif
+
+/**
+ * @brief Monotonic memory arena for short-lived loader data.
+ * @details Allocation bumps a pointer in the current block, freeing is a no-op and
+ * Reset() releases everything at once. After a Reset() the largest block is kept (up to
+ * MESH_ARENA_MAX_RETAINED), and since blocks double in size, loading models of similar size
+ * back to back reaches a steady state where the arena does no heap allocation at all.
+ *
+ * Allocate() may be called from several threads at once. Loaders allocate few,
+ * large arrays, so it simply takes a lock.
+*/
+class LoadArena
+{
+public:
+	LoadArena() = default;
+	LoadArena(const LoadArena&) = delete;
+	LoadArena& operator=(const LoadArena&) = delete;
+
+	/**
+	 * @brief Frees all blocks.
+	*/
+	~LoadArena();
+
+	/**
+	 * @brief Allocates memory that stays valid until the next Reset().
+	 * @param bytes Size of the allocation.
+	 * @param alignment Alignment, a power of two no larger than alignof(std::max_align_t).
+	 * @return Pointer to the memory, never nullptr.
+	 * @throw std::bad_alloc if a new block can not be allocated.
+	*/
+	void* Allocate(size_t bytes, size_t alignment);
+
+	/**
+	 * @brief Releases all allocations.
+	 * @details Keeps the largest block for the next load if it is no larger than
+	 * MESH_ARENA_MAX_RETAINED, and frees the others.
+	 * Containers using the arena must be destroyed or cleared before this is called.
+	*/
+	void Reset();
+
+	/**
+	 * @brief Bytes allocated since the last Reset(), including alignment padding.
+	*/
+	size_t Used() const { return m_used; }
+
+	/**
+	 * @brief Number of blocks the arena has allocated from the heap since it was created.
+	*/
+	size_t HeapAllocations() const { return m_heapAllocations; }
+
+	/**
+	 * @brief The arena of the calling thread.
+	 * @details Loads on one thread reuse the same memory. Other threads may allocate from it
+	 * while the load they work for is running, e.g. in a ThreadPool::ParallelFor().
+	*/
+	static LoadArena& ForThread();
+
+	/**
+	 * @brief Resets the arena when the outermost scope on it ends.
+	 * @details Declare before any container using the arena, so the containers are gone when
+	 * the arena is reset. Scopes may nest, e.g. a loader that is used by another loader.
+	*/
+	class Scope
+	{
+	public:
+		explicit Scope(LoadArena& arena) : m_arena(arena) { m_arena.m_scopes++; }
+		~Scope() { if (!--m_arena.m_scopes) m_arena.Reset(); }
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		LoadArena& m_arena;
+	};
+
+private:
+	static const size_t MinBlockSize = 64 << 10;
+
+	struct block_t
+	{
+		char* data;
+		size_t size;
+	};
+
+	std::vector<block_t> m_blocks;
+	size_t m_top = 0;	// bytes used in the last block
+	size_t m_used = 0;
+	size_t m_heapAllocations = 0;
+	int m_scopes = 0;
+	std::mutex m_mutex;
+};
+
+/**
+ * @brief Standard library allocator drawing from a LoadArena.
+ * @details deallocate() does nothing, the memory is reclaimed by LoadArena::Reset().
+ * A default constructed allocator (no arena) uses the heap like std::allocator.
+*/
+template<class T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	ArenaAllocator(LoadArena* arena = nullptr) noexcept : m_arena(arena) {}
+
+	template<class U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.Arena()) {}
+
+	T* allocate(size_t n)
+	{
+		if (n > (size_t)-1 / sizeof(T))
+			throw std::bad_alloc();
+		if (!m_arena)
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		return static_cast<T*>(m_arena->Allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* p, size_t) noexcept
+	{
+		if (!m_arena)
+			::operator delete(p);
+	}
+
+	LoadArena* Arena() const noexcept { return m_arena; }
+
+private:
+	LoadArena* m_arena;
+};
+
+template<class T, class U>
+inline bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.Arena() == b.Arena(); }
+
+template<class T, class U>
+inline bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.Arena() != b.Arena(); }
+
+//! std::vector in a LoadArena
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+//! std::unordered_map in a LoadArena
+template<class Key, class T>
+using ArenaHashMap = std::unordered_map<Key, T, std::hash<Key>, std::equal_to<Key>, ArenaAllocator<std::pair<const Key, T>>>;
+
+#endif
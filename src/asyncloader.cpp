@@ -0,0 +1,113 @@
+//
+//  Background loading of assets with device uploads on the render thread
+//
+
+#include <chrono>
+#include <iostream>
+#include <exception>
+#include "asyncloader.h"
+
+AsyncLoader::AsyncLoader(unsigned thread_count)
+	: m_threads(thread_count ? thread_count : 1)
+{
+}
+
+AsyncLoader::~AsyncLoader()
+{
+	// m_threads is destroyed first and runs the jobs still queued, make them return right away
+	m_cancelled = true;
+}
+
+void AsyncLoader::Queue(Job job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending++;
+	}
+
+	m_threads.Submit([this, job]()
+	{
+		Upload upload;
+		if (!m_cancelled)
+		{
+			try
+			{
+				upload = job();
+			}
+			catch (const std::exception& e)
+			{
+				std::cout << "Background load failed: " << e.what() << std::endl;
+			}
+			catch (...)
+			{
+				std::cout << "Background load failed" << std::endl;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (upload)
+			m_uploads.push_back(std::move(upload));
+		else
+			m_pending--;
+		m_finished.notify_all();
+	});
+}
+
+void AsyncLoader::QueueUpload(Upload upload)
+{
+	if (m_cancelled)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_uploads.push_back(std::move(upload));
+	m_pending++;
+	m_finished.notify_all();
+}
+
+size_t AsyncLoader::Update(double time_budget)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t count = 0;
+	for (;;)
+	{
+		Upload upload;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_uploads.empty())
+				break;
+			upload = std::move(m_uploads.front());
+			m_uploads.pop_front();
+		}
+
+		upload();
+		count++;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pending--;
+		}
+
+		auto now = std::chrono::high_resolution_clock::now();
+		if (std::chrono::duration<double>(now - start).count() >= time_budget)
+			break;
+	}
+	return count;
+}
+
+void AsyncLoader::Flush()
+{
+	for (;;)
+	{
+		Update(0);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!m_pending)
+			return;
+		m_finished.wait(lock, [this] { return !m_uploads.empty() || !m_pending; });
+	}
+}
+
+size_t AsyncLoader::PendingCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pending;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file asyncloader.h
+ * @brief Background loading of assets with device uploads on the render thread
+*/
+
+#pragma once
+#ifndef ASYNCLOADER_H
+#define ASYNCLOADER_H
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "threadpool.h"
+
+/**
+ * @brief Runs the CPU side of asset loads (parsing, welding, image decoding) on background
+ * threads and hands the results back to the render thread for the device upload.
+ * @details A job runs on a loader thread and returns an upload step. Upload steps are run
+ * by Update() on the thread that owns the device context, in the order the jobs finished.
+ * Jobs for different files run in parallel; the loaders inside a job still spread their
+ * own work over ThreadPool::Global().
+*/
+class AsyncLoader
+{
+public:
+	typedef std::function<void()> Upload; //!< Device work, run on the render thread
+	typedef std::function<Upload()> Job; //!< CPU work, run on a loader thread. May return an empty Upload.
+
+	/**
+	 * @brief Starts the loader threads.
+	 * @param thread_count Number of jobs that can run at the same time.
+	*/
+	explicit AsyncLoader(unsigned thread_count = 2);
+
+	AsyncLoader(const AsyncLoader&) = delete;
+	AsyncLoader& operator=(const AsyncLoader&) = delete;
+
+	/**
+	 * @brief Skips jobs that have not started, waits for running jobs and discards all pending uploads.
+	*/
+	~AsyncLoader();
+
+	/**
+	 * @brief Queues a job.
+	 * @details Exceptions thrown by the job are printed and the job's upload is skipped.
+	 * @param job Job to run on a loader thread.
+	*/
+	void Queue(Job job);
+
+	/**
+	 * @brief Queues an upload directly, e.g. for partial results of a job that is still running.
+	 * @details Thread safe. Uploads run in the order they are queued, so partial results queued
+	 * by a job are uploaded before the job's own upload.
+	 * @param upload Device work to run on the render thread.
+	*/
+	void QueueUpload(Upload upload);
+
+	/**
+	 * @brief Runs the upload steps of finished jobs. Call once per frame from the render thread.
+	 * @details At least one upload is run per call, more as long as the time budget allows.
+	 * @param time_budget Seconds to spend on uploads.
+	 * @return Number of uploads run.
+	*/
+	size_t Update(double time_budget = 0.004);
+
+	/**
+	 * @brief Blocks until all queued jobs have finished and runs their uploads.
+	*/
+	void Flush();
+
+	/**
+	 * @brief Number of jobs that are queued, running or waiting for their upload.
+	*/
+	size_t PendingCount() const;
+
+private:
+	mutable std::mutex m_mutex;
+	std::condition_variable m_finished;
+	std::deque<Upload> m_uploads;
+	size_t m_pending = 0; // jobs queued or running, plus uploads not yet run
+	std::atomic<bool> m_cancelled{ false };
+
+	// Declared last so it is destroyed (and joined) first
+	ThreadPool m_threads;
+};
+
+#endif
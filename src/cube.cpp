@@ -41,7 +41,7 @@ Cube::Cube(
 
 	//Geometry
 	std::vector<Vertex> vertices;
-	std::vector<unsigned> indices;
+	std::vector<uint16_t> indices;
 
 	//Create temporary vertex array
 	Vertex v[24];
@@ -230,7 +230,7 @@ Cube::Cube(
 	indexbufferDesc.CPUAccessFlags = 0;
 	indexbufferDesc.Usage = D3D11_USAGE_DEFAULT;
 	indexbufferDesc.MiscFlags = 0;
-	indexbufferDesc.ByteWidth = (UINT)(indices.size() * sizeof(unsigned));
+	indexbufferDesc.ByteWidth = (UINT)(indices.size() * sizeof(uint16_t));
 	// Data resource
 	D3D11_SUBRESOURCE_DATA indexData{ 0 };
 	indexData.pSysMem = &indices[0];
@@ -249,7 +249,7 @@ void Cube::Render() const
 	m_dxdevice_context->IASetVertexBuffers(0, 1, &m_vertex_buffer, &stride, &offset);
 
 	// Bind our index buffer
-	m_dxdevice_context->IASetIndexBuffer(m_index_buffer, DXGI_FORMAT_R32_UINT, 0);
+	m_dxdevice_context->IASetIndexBuffer(m_index_buffer, DXGI_FORMAT_R16_UINT, 0);
 	
 	m_dxdevice_context->PSSetShaderResources(0, 1, &m_materials[0].DiffuseTexture.TextureView);
 	m_dxdevice_context->PSSetShaderResources(1, 1, &m_materials[0].NormalTexture.TextureView);
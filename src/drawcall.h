@@ -9,12 +9,16 @@
 #define MATERIAL_H
 
 #include <iostream>
+#include <string>
 #include <vector>
 #include <unordered_map>
-#include "stdafx.h"
 #include "vec/vec.h"
 
+//! Defined by builds without a device (e.g. the objbench tool), leaves out the D3D textures of Material
+#ifndef MESH_HEADLESS
+#include "stdafx.h"
 #include "Texture.h"
+#endif
 
 using namespace linalg;
 
@@ -48,10 +52,12 @@ struct Material
 
 	// + more texture types (extend OBJLoader::LoadMaterials if needed)
 
+#ifndef MESH_HEADLESS
 	// Device textures
 	Texture DiffuseTexture; //!< Diffuse Texture
 	Texture NormalTexture; //!< Normal Texture
 	// + other texture types
+#endif
 };
 
 /**
@@ -99,4 +105,15 @@ struct Drawcall
     }
 };
 
+/**
+ * @brief A range of indices within an index buffer, drawn with one material
+*/
+struct IndexRange
+{
+	unsigned int Start; //!< First index of the range
+	unsigned int Size; //!< Number of indices in the range
+	unsigned Offset; //!< Value added to each index before reading the vertex buffer
+	int MaterialIndex; //!< Index of the material used by the range
+};
+
 #endif
@@ -0,0 +1,1000 @@
+//
+//  glTF 2.0 binary (.glb) loader
+//
+
+#include <fstream>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cctype>
+#include <stdexcept>
+#include "glbloader.h"
+#include "json.h"
+#include "parseutil.h"
+#include "vec/mat.h"
+
+static const uint32_t GLBMagic = 0x46546C67; // "glTF"
+static const uint32_t GLBVersion = 2;
+static const uint32_t GLBChunkJSON = 0x4E4F534A; // "JSON"
+static const uint32_t GLBChunkBIN = 0x004E4942; // "BIN\0"
+
+// Accessor component types
+static const int ComponentByte = 5120;
+static const int ComponentUnsignedByte = 5121;
+static const int ComponentShort = 5122;
+static const int ComponentUnsignedShort = 5123;
+static const int ComponentUnsignedInt = 5125;
+static const int ComponentFloat = 5126;
+
+static const int ModeTriangles = 4;
+
+// Node hierarchies deeper than this are treated as cyclic
+static const int MaxNodeDepth = 64;
+
+// Offsets of the Vertex members, as attribute byte offsets
+static const size_t PositionOffset = 0;
+static const size_t NormalOffset = sizeof(vec3f);
+static const size_t TangentOffset = 2 * sizeof(vec3f);
+static const size_t BinormalOffset = 3 * sizeof(vec3f);
+static const size_t TexCoordOffset = 4 * sizeof(vec3f);
+
+struct glb_header_t { uint32_t magic, version, length; };
+struct glb_chunk_t { uint32_t length, type; };
+
+struct glb_view_t
+{
+	const char* data;
+	size_t size;
+	size_t stride; // 0 if tightly packed
+};
+
+struct glb_accessor_t
+{
+	int view;
+	size_t offset; // from the start of the view
+	size_t count;
+	int component_type;
+	int components;
+	bool normalized;
+	const char* data; // first element
+	size_t stride;
+};
+
+struct glb_instance_t
+{
+	int mesh;
+	mat4f transform;
+};
+
+/**
+ * @brief The parsed document and its buffer views, with the file name for error messages.
+*/
+struct glb_document_t
+{
+	std::string filename;
+	JsonValue json;
+	std::vector<glb_view_t> views;
+
+	[[noreturn]] void Fail(const std::string& what) const
+	{
+		throw std::runtime_error("GLB: " + what + " in " + filename);
+	}
+};
+
+static size_t component_size(int component_type)
+{
+	switch (component_type)
+	{
+	case ComponentByte: case ComponentUnsignedByte: return 1;
+	case ComponentShort: case ComponentUnsignedShort: return 2;
+	case ComponentUnsignedInt: case ComponentFloat: return 4;
+	default: return 0;
+	}
+}
+
+static int type_components(const std::string& type)
+{
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	if (type == "MAT2") return 4;
+	if (type == "MAT3") return 9;
+	if (type == "MAT4") return 16;
+	return 0;
+}
+
+//
+// Resolves an accessor and checks that all its elements lie within its buffer view
+//
+static glb_accessor_t get_accessor(const glb_document_t& doc, int index)
+{
+	const JsonValue& accessor = doc.json["accessors"][(size_t)index];
+	if (accessor.IsNull())
+		doc.Fail("missing accessor " + std::to_string(index));
+	if (!accessor["sparse"].IsNull())
+		doc.Fail("sparse accessors are not supported");
+
+	glb_accessor_t a;
+	a.view = accessor["bufferView"].Int(-1);
+	a.offset = (size_t)accessor["byteOffset"].Number(0);
+	a.count = (size_t)accessor["count"].Number(0);
+	a.component_type = accessor["componentType"].Int();
+	a.components = type_components(accessor["type"].String());
+	a.normalized = accessor["normalized"].Bool();
+
+	const size_t elementSize = component_size(a.component_type) * a.components;
+	if (!elementSize)
+		doc.Fail("invalid type of accessor " + std::to_string(index));
+	if (a.view < 0 || (size_t)a.view >= doc.views.size())
+		doc.Fail("accessor " + std::to_string(index) + " has no buffer view");
+
+	const glb_view_t& view = doc.views[a.view];
+	a.stride = view.stride ? view.stride : elementSize;
+	if (a.count && (a.offset > view.size || (a.count - 1) > (view.size - a.offset) / a.stride ||
+		a.offset + (a.count - 1) * a.stride + elementSize > view.size))
+		doc.Fail("accessor " + std::to_string(index) + " exceeds its buffer view");
+	a.data = view.data + a.offset;
+	return a;
+}
+
+static float read_component(const char* p, int component_type, bool normalized)
+{
+	switch (component_type)
+	{
+	case ComponentFloat: { float f; memcpy(&f, p, sizeof(f)); return f; }
+	case ComponentByte: { int8_t v = *(const int8_t*)p; return normalized ? (std::max)(v / 127.0f, -1.0f) : v; }
+	case ComponentUnsignedByte: { uint8_t v = *(const uint8_t*)p; return normalized ? v / 255.0f : v; }
+	case ComponentShort: { int16_t v; memcpy(&v, p, sizeof(v)); return normalized ? (std::max)(v / 32767.0f, -1.0f) : v; }
+	case ComponentUnsignedShort: { uint16_t v; memcpy(&v, p, sizeof(v)); return normalized ? v / 65535.0f : v; }
+	case ComponentUnsignedInt: { uint32_t v; memcpy(&v, p, sizeof(v)); return (float)v; }
+	default: return 0;
+	}
+}
+
+static void read_floats(const glb_accessor_t& a, size_t element, float* out, int count)
+{
+	const char* p = a.data + element * a.stride;
+	const size_t size = component_size(a.component_type);
+	for (int c = 0; c < count; c++)
+		out[c] = c < a.components ? read_component(p + c * size, a.component_type, a.normalized) : 0.0f;
+}
+
+static unsigned read_index(const glb_accessor_t& a, size_t element)
+{
+	const char* p = a.data + element * a.stride;
+	switch (a.component_type)
+	{
+	case ComponentUnsignedByte: return *(const uint8_t*)p;
+	case ComponentUnsignedShort: { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+	default: { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+	}
+}
+
+//
+// Decodes %XX escapes in a relative URI
+//
+static std::string decode_uri(const std::string& uri)
+{
+	std::string path;
+	for (size_t i = 0; i < uri.size(); i++)
+	{
+		if (uri[i] == '%' && i + 2 < uri.size() && isxdigit((unsigned char)uri[i + 1]) && isxdigit((unsigned char)uri[i + 2]))
+		{
+			path += (char)strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+			i += 2;
+		}
+		else
+			path += uri[i];
+	}
+	return path;
+}
+
+//
+// Percent-encodes the characters of a relative path that are not allowed in a URI
+//
+static std::string encode_uri(const std::string& path)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	std::string uri;
+	for (char ch : path)
+	{
+		unsigned char c = (unsigned char)ch;
+		if (c == '\\')
+			uri += '/';
+		else if (isalnum(c) || strchr("-._~/!$&'()*+,;=:@", c))
+			uri += ch;
+		else
+		{
+			uri += '%';
+			uri += hex[c >> 4];
+			uri += hex[c & 15];
+		}
+	}
+	return uri;
+}
+
+static bool is_absolute_path(const std::string& path)
+{
+	return (path.size() && (path[0] == '/' || path[0] == '\\')) || (path.size() > 1 && path[1] == ':');
+}
+
+//
+// Local transform of a node, column-major like glTF
+//
+static mat4f node_transform(const JsonValue& node)
+{
+	mat4f m = mat4f_identity;
+	const JsonValue& matrix = node["matrix"];
+	if (matrix.Size() == 16)
+	{
+		for (size_t i = 0; i < 16; i++)
+			m.array[i] = (float)matrix[i].Number();
+		return m;
+	}
+
+	const JsonValue& t = node["translation"];
+	const JsonValue& r = node["rotation"];
+	const JsonValue& s = node["scale"];
+	const float x = (float)r[0].Number(0), y = (float)r[1].Number(0), z = (float)r[2].Number(0), w = (float)r[3].Number(1);
+	const float sx = (float)s[0].Number(1), sy = (float)s[1].Number(1), sz = (float)s[2].Number(1);
+
+	// T * R * S
+	m.m11 = (1 - 2 * (y * y + z * z)) * sx; m.m12 = (2 * (x * y - z * w)) * sy;     m.m13 = (2 * (x * z + y * w)) * sz;
+	m.m21 = (2 * (x * y + z * w)) * sx;     m.m22 = (1 - 2 * (x * x + z * z)) * sy; m.m23 = (2 * (y * z - x * w)) * sz;
+	m.m31 = (2 * (x * z - y * w)) * sx;     m.m32 = (2 * (y * z + x * w)) * sy;     m.m33 = (1 - 2 * (x * x + y * y)) * sz;
+	m.m14 = (float)t[0].Number(0);
+	m.m24 = (float)t[1].Number(0);
+	m.m34 = (float)t[2].Number(0);
+	return m;
+}
+
+static bool is_identity(const mat4f& m)
+{
+	for (unsigned i = 0; i < 16; i++)
+	{
+		if (m.array[i] != mat4f_identity.array[i])
+			return false;
+	}
+	return true;
+}
+
+static void collect_instances(const glb_document_t& doc, int node_index, const mat4f& parent, int depth, std::vector<glb_instance_t>& instances)
+{
+	const JsonValue& node = doc.json["nodes"][(size_t)node_index];
+	if (node.IsNull())
+		doc.Fail("missing node " + std::to_string(node_index));
+	if (depth > MaxNodeDepth)
+		doc.Fail("node hierarchy too deep or cyclic");
+
+	const mat4f transform = parent * node_transform(node);
+	const int mesh = node["mesh"].Int(-1);
+	if (mesh >= 0)
+		instances.push_back({ mesh, transform });
+
+	const JsonValue& children = node["children"];
+	for (size_t i = 0; i < children.Size(); i++)
+		collect_instances(doc, children[i].Int(), transform, depth + 1, instances);
+}
+
+//
+// Checks if the primitives can be drawn straight from the file and sets up their index ranges.
+// Indices and materials are validated like the conversion in GLBLoader::Load().
+//
+static bool get_in_place_ranges(
+	const glb_document_t& doc,
+	const std::vector<glb_instance_t>& instances,
+	const std::vector<int>& material_indices,
+	int default_material,
+	std::vector<IndexRange>& ranges,
+	int& vertex_view,
+	int& index_view,
+	size_t& index_size,
+	size_t& vertex_count)
+{
+	static const struct { const char* name; size_t offset; int components; } attributes[] = {
+		{ "POSITION", PositionOffset, 3 },
+		{ "NORMAL", NormalOffset, 3 },
+		{ "_TANGENT", TangentOffset, 3 },
+		{ "_BINORMAL", BinormalOffset, 3 },
+		{ "_TEXCOORD", TexCoordOffset, 2 },
+	};
+
+	vertex_view = index_view = -1;
+	index_size = 0;
+	vertex_count = 0;
+	std::vector<bool> meshUsed(doc.json["meshes"].Size());
+
+	for (const glb_instance_t& instance : instances)
+	{
+		if (!is_identity(instance.transform) || meshUsed[instance.mesh])
+			return false;
+		meshUsed[instance.mesh] = true;
+
+		const JsonValue& primitives = doc.json["meshes"][(size_t)instance.mesh]["primitives"];
+		for (size_t p = 0; p < primitives.Size(); p++)
+		{
+			const JsonValue& primitive = primitives[p];
+			if (primitive["mode"].Int(ModeTriangles) != ModeTriangles)
+				continue;
+			if (!primitive["targets"].IsNull())
+				return false;
+
+			// All attributes interleaved as a Vertex, in one view
+			size_t baseVertex = 0, count = 0;
+			for (size_t i = 0; i < sizeof(attributes) / sizeof(attributes[0]); i++)
+			{
+				const JsonValue& index = primitive["attributes"][attributes[i].name];
+				if (index.IsNull())
+					return false;
+				glb_accessor_t a = get_accessor(doc, index.Int());
+				if (a.component_type != ComponentFloat || a.normalized || a.components != attributes[i].components ||
+					a.stride != sizeof(Vertex) || a.offset < attributes[i].offset || (a.offset - attributes[i].offset) % sizeof(Vertex))
+					return false;
+				if (vertex_view < 0)
+					vertex_view = a.view;
+				if (a.view != vertex_view)
+					return false;
+
+				const size_t base = (a.offset - attributes[i].offset) / sizeof(Vertex);
+				if (i == 0)
+				{
+					baseVertex = base;
+					count = a.count;
+				}
+				else if (base != baseVertex || a.count != count)
+					return false;
+			}
+			vertex_count = (std::max)(vertex_count, baseVertex + count);
+
+			// Indices in one tightly packed view, all of the same size
+			const JsonValue& index = primitive["indices"];
+			if (index.IsNull())
+				return false;
+			glb_accessor_t a = get_accessor(doc, index.Int());
+			const size_t size = component_size(a.component_type);
+			if ((a.component_type != ComponentUnsignedShort && a.component_type != ComponentUnsignedInt) ||
+				a.components != 1 || doc.views[a.view].stride || a.offset % size)
+				return false;
+			if (index_view < 0)
+			{
+				index_view = a.view;
+				index_size = size;
+			}
+			if (a.view != index_view || size != index_size)
+				return false;
+
+			// The indices are drawn as they are, relative to the first vertex of the primitive
+			const size_t indexCount = a.count - a.count % 3;
+			for (size_t i = 0; i < indexCount; i++)
+			{
+				if (read_index(a, i) >= count)
+					doc.Fail("index out of range");
+			}
+
+			const int material = primitive["material"].Int(-1);
+			if (material >= (int)material_indices.size())
+				doc.Fail("missing material " + std::to_string(material));
+
+			IndexRange range;
+			range.Start = (unsigned)(a.offset / size);
+			range.Size = (unsigned)indexCount;
+			range.Offset = (unsigned)baseVertex;
+			range.MaterialIndex = material >= 0 ? material_indices[material] : default_material;
+			ranges.push_back(range);
+		}
+	}
+
+	// The arrays are used in place, so they have to be aligned
+	if (vertex_view < 0 || ((uintptr_t)doc.views[vertex_view].data % alignof(Vertex)) ||
+		((uintptr_t)doc.views[index_view].data % index_size) ||
+		vertex_count * sizeof(Vertex) > doc.views[vertex_view].size)
+		return false;
+
+	return true;
+}
+
+//
+// Reads the texture image of a material texture reference
+//
+static std::string get_texture_path(const glb_document_t& doc, const JsonValue& texture_info, const std::string& directory)
+{
+	const JsonValue& texture = doc.json["textures"][(size_t)texture_info["index"].Int(-1)];
+	const JsonValue& image = doc.json["images"][(size_t)texture["source"].Int(-1)];
+	if (image.IsNull())
+		return std::string();
+
+	const std::string& uri = image["uri"].String();
+	if (uri.empty() || uri.compare(0, 5, "data:") == 0)
+	{
+		printf("%s: embedded images are not supported, skipping texture\n", doc.filename.c_str());
+		return std::string();
+	}
+
+	std::string path = decode_uri(uri);
+	return is_absolute_path(path) ? path : directory + path;
+}
+
+void GLBLoader::Load(const std::string& filename)
+{
+	LoadTimer timer;
+
+	VertexStorage.clear();
+	IndexStorage.clear();
+	IndexRanges.clear();
+	Materials.clear();
+	HasTangents = false;
+	m_external.clear();
+	m_vertices = nullptr;
+	m_indices = nullptr;
+	m_vertex_count = m_index_count = m_index_size = 0;
+	Report = LoadReport();
+	Report.Filename = filename;
+
+	glb_document_t doc;
+	doc.filename = filename;
+
+	if (!m_file.Open(filename))
+		doc.Fail("could not open file");
+	const char* file = m_file.Data();
+	const size_t fileSize = m_file.Size();
+	Report.FileBytes = fileSize;
+
+	// Header, JSON chunk and optional BIN chunk
+	glb_header_t header;
+	if (fileSize < sizeof(header) + sizeof(glb_chunk_t))
+		doc.Fail("file too small");
+	memcpy(&header, file, sizeof(header));
+	if (header.magic != GLBMagic)
+		doc.Fail("not a binary glTF file");
+	if (header.version != GLBVersion)
+		doc.Fail("unsupported version " + std::to_string(header.version));
+	if (header.length > fileSize)
+		doc.Fail("file is truncated");
+
+	const char* json = nullptr;
+	const char* bin = nullptr;
+	size_t jsonSize = 0, binSize = 0;
+	for (size_t offset = sizeof(header); offset + sizeof(glb_chunk_t) <= header.length;)
+	{
+		glb_chunk_t chunk;
+		memcpy(&chunk, file + offset, sizeof(chunk));
+		offset += sizeof(chunk);
+		if (chunk.length > header.length - offset)
+			doc.Fail("chunk exceeds the file");
+
+		if (chunk.type == GLBChunkJSON && !json)
+		{
+			json = file + offset;
+			jsonSize = chunk.length;
+		}
+		else if (chunk.type == GLBChunkBIN && json && !bin)
+		{
+			bin = file + offset;
+			binSize = chunk.length;
+		}
+		// unknown chunks are skipped
+		offset += (chunk.length + 3) & ~3u;
+	}
+	if (!json)
+		doc.Fail("missing JSON chunk");
+
+	doc.json = JsonValue::Parse(json, json + jsonSize);
+	if (doc.json["asset"]["version"].String().compare(0, 2, "2.") != 0)
+		doc.Fail("unsupported glTF version");
+	if (doc.json["extensionsRequired"].Size())
+		doc.Fail("required extension " + doc.json["extensionsRequired"][(size_t)0].String() + " is not supported");
+
+	// Buffers: the BIN chunk or files next to the .glb
+	const std::string directory = get_parentdir(filename);
+	const JsonValue& buffers = doc.json["buffers"];
+	std::vector<std::pair<const char*, size_t>> bufferData;
+	for (size_t i = 0; i < buffers.Size(); i++)
+	{
+		const size_t length = (size_t)buffers[i]["byteLength"].Number(0);
+		const std::string& uri = buffers[i]["uri"].String();
+		if (uri.empty())
+		{
+			if (i != 0 || !bin || length > binSize)
+				doc.Fail("buffer " + std::to_string(i) + " is not in the BIN chunk");
+			bufferData.push_back({ bin, length });
+		}
+		else if (uri.compare(0, 5, "data:") == 0)
+			doc.Fail("data: URIs are not supported");
+		else
+		{
+			std::string path = decode_uri(uri);
+			m_external.emplace_back(new MappedFile());
+			if (!m_external.back()->Open(is_absolute_path(path) ? path : directory + path) || m_external.back()->Size() < length)
+				doc.Fail("could not read buffer " + path);
+			bufferData.push_back({ m_external.back()->Data(), length });
+		}
+	}
+
+	const JsonValue& views = doc.json["bufferViews"];
+	for (size_t i = 0; i < views.Size(); i++)
+	{
+		const size_t buffer = (size_t)views[i]["buffer"].Int(-1);
+		const size_t offset = (size_t)views[i]["byteOffset"].Number(0);
+		const size_t length = (size_t)views[i]["byteLength"].Number(0);
+		if (buffer >= bufferData.size() || offset > bufferData[buffer].second || length > bufferData[buffer].second - offset)
+			doc.Fail("buffer view " + std::to_string(i) + " exceeds its buffer");
+		doc.views.push_back({ bufferData[buffer].first + offset, length, (size_t)views[i]["byteStride"].Number(0) });
+	}
+
+	// Meshes of the default scene, or every mesh if there are no scenes
+	std::vector<glb_instance_t> instances;
+	const JsonValue& meshes = doc.json["meshes"];
+	const JsonValue& scenes = doc.json["scenes"];
+	if (scenes.Size())
+	{
+		const JsonValue& roots = scenes[(size_t)doc.json["scene"].Int(0)]["nodes"];
+		for (size_t i = 0; i < roots.Size(); i++)
+			collect_instances(doc, roots[i].Int(), mat4f_identity, 0, instances);
+	}
+	else
+	{
+		for (size_t i = 0; i < meshes.Size(); i++)
+			instances.push_back({ (int)i, mat4f_identity });
+	}
+	for (const glb_instance_t& instance : instances)
+	{
+		if ((size_t)instance.mesh >= meshes.Size())
+			doc.Fail("missing mesh " + std::to_string(instance.mesh));
+	}
+
+	// Materials, plus a default material for primitives without one
+	const JsonValue& materials = doc.json["materials"];
+	std::vector<int> materialIndices(materials.Size());
+	for (size_t i = 0; i < materials.Size(); i++)
+	{
+		const JsonValue& source = materials[i];
+		const JsonValue& pbr = source["pbrMetallicRoughness"];
+		const JsonValue& base = pbr["baseColorFactor"];
+		const JsonValue& ambient = source["extras"]["ambient"];
+		const JsonValue& specular = source["extras"]["specular"];
+
+		Material material;
+		material.Name = source["name"].String().size() ? source["name"].String() : "material" + std::to_string(i);
+		material.DiffuseColour = vec3f((float)base[0].Number(1), (float)base[1].Number(1), (float)base[2].Number(1));
+		material.AmbientColour = ambient.Size() == 3 ?
+			vec3f((float)ambient[0].Number(), (float)ambient[1].Number(), (float)ambient[2].Number()) :
+			material.DiffuseColour * 0.2f;
+		const float gloss = 1.0f - (float)pbr["roughnessFactor"].Number(1);
+		material.SpecularColour = specular.Size() == 3 ?
+			vec3f((float)specular[0].Number(), (float)specular[1].Number(), (float)specular[2].Number()) :
+			vec3f(gloss, gloss, gloss);
+		material.DiffuseTextureFilename = get_texture_path(doc, pbr["baseColorTexture"], directory);
+		material.NormalTextureFilename = get_texture_path(doc, source["normalTexture"], directory);
+
+		materialIndices[i] = (int)Materials.size();
+		Materials.push_back(material);
+	}
+	const int defaultMaterial = (int)Materials.size();
+	Materials.push_back(Material());
+	Materials.back().Name = "default";
+
+	Report.ParseTime = timer.Lap();
+
+	int vertexView, indexView;
+	size_t indexSize, vertexCount;
+	if (get_in_place_ranges(doc, instances, materialIndices, defaultMaterial, IndexRanges, vertexView, indexView, indexSize, vertexCount))
+	{
+		m_vertices = (const Vertex*)doc.views[vertexView].data;
+		m_vertex_count = vertexCount;
+		m_indices = doc.views[indexView].data;
+		m_index_count = doc.views[indexView].size / indexSize;
+		m_index_size = indexSize;
+		HasTangents = true;
+
+		for (const IndexRange& range : IndexRanges)
+		{
+			if (range.Start + range.Size > m_index_count)
+				doc.Fail("index range exceeds the index buffer");
+		}
+	}
+	else
+	{
+		// Convert into VertexStorage and IndexStorage, indices are absolute (IndexRange::Offset is 0)
+		IndexRanges.clear();
+		HasTangents = true;
+
+		for (const glb_instance_t& instance : instances)
+		{
+			const mat4f& m = instance.transform;
+			const vec3f c0 = m.col[0].xyz(), c1 = m.col[1].xyz(), c2 = m.col[2].xyz();
+			const float det = c0.dot(c1 % c2);
+			// Normals are transformed by the cofactor matrix, the inverse transpose scaled by det
+			const vec3f n0 = c1 % c2, n1 = c2 % c0, n2 = c0 % c1;
+			const float normalSign = det < 0 ? -1.0f : 1.0f;
+
+			const JsonValue& primitives = meshes[(size_t)instance.mesh]["primitives"];
+			for (size_t p = 0; p < primitives.Size(); p++)
+			{
+				const JsonValue& primitive = primitives[p];
+				if (primitive["mode"].Int(ModeTriangles) != ModeTriangles)
+					continue;
+
+				const JsonValue& attributes = primitive["attributes"];
+				if (attributes["POSITION"].IsNull())
+					doc.Fail("primitive without positions");
+				glb_accessor_t position = get_accessor(doc, attributes["POSITION"].Int());
+				const size_t base = VertexStorage.size();
+				const size_t count = position.count;
+				VertexStorage.resize(base + count, Vertex());
+				Vertex* vertices = VertexStorage.data() + base;
+
+				for (size_t i = 0; i < count; i++)
+				{
+					float v[3];
+					read_floats(position, i, v, 3);
+					vertices[i].Position = (m * vec4f(v[0], v[1], v[2], 1.0f)).xyz();
+				}
+
+				const bool hasNormals = !attributes["NORMAL"].IsNull();
+				if (hasNormals)
+				{
+					glb_accessor_t normal = get_accessor(doc, attributes["NORMAL"].Int());
+					for (size_t i = 0; i < count && i < normal.count; i++)
+					{
+						float v[3];
+						read_floats(normal, i, v, 3);
+						vertices[i].Normal = ((n0 * v[0] + n1 * v[1] + n2 * v[2]) * normalSign).normalize();
+					}
+				}
+
+				if (!attributes["_TANGENT"].IsNull() && !attributes["_BINORMAL"].IsNull())
+				{
+					glb_accessor_t tangent = get_accessor(doc, attributes["_TANGENT"].Int());
+					glb_accessor_t binormal = get_accessor(doc, attributes["_BINORMAL"].Int());
+					for (size_t i = 0; i < count && i < tangent.count && i < binormal.count; i++)
+					{
+						float t[3], b[3];
+						read_floats(tangent, i, t, 3);
+						read_floats(binormal, i, b, 3);
+						vertices[i].Tangent = (c0 * t[0] + c1 * t[1] + c2 * t[2]).normalize();
+						vertices[i].Binormal = (c0 * b[0] + c1 * b[1] + c2 * b[2]).normalize();
+					}
+				}
+				else
+					HasTangents = false;
+
+				// eduRend's texture coordinates have v pointing up, glTF's point down
+				const bool flipV = attributes["_TEXCOORD"].IsNull();
+				const JsonValue& texcoordIndex = flipV ? attributes["TEXCOORD_0"] : attributes["_TEXCOORD"];
+				if (!texcoordIndex.IsNull())
+				{
+					glb_accessor_t texcoord = get_accessor(doc, texcoordIndex.Int());
+					for (size_t i = 0; i < count && i < texcoord.count; i++)
+					{
+						float v[2];
+						read_floats(texcoord, i, v, 2);
+						vertices[i].TexCoord = vec2f(v[0], flipV ? 1.0f - v[1] : v[1]);
+					}
+				}
+
+				// Indices, or a triangle list over the vertices if there are none
+				const size_t start = IndexStorage.size();
+				if (!primitive["indices"].IsNull())
+				{
+					glb_accessor_t index = get_accessor(doc, primitive["indices"].Int());
+					if (index.components != 1 || (index.component_type != ComponentUnsignedByte &&
+						index.component_type != ComponentUnsignedShort && index.component_type != ComponentUnsignedInt))
+						doc.Fail("invalid index accessor");
+					const size_t indexCount = index.count - index.count % 3;
+					IndexStorage.resize(start + indexCount);
+					for (size_t i = 0; i < indexCount; i++)
+					{
+						const unsigned vertex = read_index(index, i);
+						if (vertex >= count)
+							doc.Fail("index out of range");
+						IndexStorage[start + i] = (unsigned)base + vertex;
+					}
+				}
+				else
+				{
+					const size_t indexCount = count - count % 3;
+					IndexStorage.resize(start + indexCount);
+					for (size_t i = 0; i < indexCount; i++)
+						IndexStorage[start + i] = (unsigned)(base + i);
+				}
+
+				// Mirroring transforms turn the triangles inside out
+				if (det < 0)
+				{
+					for (size_t i = start; i + 2 < IndexStorage.size(); i += 3)
+						std::swap(IndexStorage[i + 1], IndexStorage[i + 2]);
+				}
+
+				if (!hasNormals)
+				{
+					// Area weighted face normals
+					for (size_t i = start; i + 2 < IndexStorage.size(); i += 3)
+					{
+						Vertex& v0 = VertexStorage[IndexStorage[i]];
+						Vertex& v1 = VertexStorage[IndexStorage[i + 1]];
+						Vertex& v2 = VertexStorage[IndexStorage[i + 2]];
+						const vec3f normal = (v1.Position - v0.Position) % (v2.Position - v0.Position);
+						v0.Normal += normal;
+						v1.Normal += normal;
+						v2.Normal += normal;
+					}
+					for (size_t i = 0; i < count; i++)
+						vertices[i].Normal.normalize();
+				}
+
+				const int material = primitive["material"].Int(-1);
+				if (material >= (int)materialIndices.size())
+					doc.Fail("missing material " + std::to_string(material));
+
+				IndexRange range;
+				range.Start = (unsigned)start;
+				range.Size = (unsigned)(IndexStorage.size() - start);
+				range.Offset = 0;
+				range.MaterialIndex = material >= 0 ? materialIndices[material] : defaultMaterial;
+				IndexRanges.push_back(range);
+			}
+		}
+
+		m_vertices = VertexStorage.data();
+		m_vertex_count = VertexStorage.size();
+		m_indices = IndexStorage.data();
+		m_index_count = IndexStorage.size();
+		m_index_size = sizeof(unsigned);
+		if (!IndexRanges.size())
+			HasTangents = false;
+	}
+
+	// The default material is only kept if a primitive uses it
+	bool defaultUsed = false;
+	for (const IndexRange& range : IndexRanges)
+		defaultUsed |= range.MaterialIndex == defaultMaterial;
+	if (!defaultUsed)
+		Materials.pop_back();
+
+	Report.WeldTime = timer.Lap();
+	Report.Vertices = m_vertex_count;
+	Report.Triangles = 0;
+	for (const IndexRange& range : IndexRanges)
+		Report.Triangles += range.Size / 3;
+	Report.Drawcalls = Report.UnmergedDrawcalls = IndexRanges.size();
+	Report.Materials = Materials.size();
+}
+
+//
+// JSON output helpers for Save()
+//
+static void append_string(std::string& out, const std::string& str)
+{
+	out += '"';
+	for (char ch : str)
+	{
+		if (ch == '"' || ch == '\\')
+		{
+			out += '\\';
+			out += ch;
+		}
+		else if ((unsigned char)ch < 0x20)
+		{
+			char escape[8];
+			snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)ch);
+			out += escape;
+		}
+		else
+			out += ch;
+	}
+	out += '"';
+}
+
+static void append_floats(std::string& out, const float* values, int count)
+{
+	char number[32];
+	out += '[';
+	for (int i = 0; i < count; i++)
+	{
+		snprintf(number, sizeof(number), i ? ",%.9g" : "%.9g", values[i]);
+		out += number;
+	}
+	out += ']';
+}
+
+static void append_accessor(std::string& out, int view, size_t offset, int component_type, size_t count, const char* type)
+{
+	char accessor[160];
+	snprintf(accessor, sizeof(accessor), "%s{\"bufferView\":%d,\"byteOffset\":%zu,\"componentType\":%d,\"count\":%zu,\"type\":\"%s\"",
+		out.back() == '[' ? "" : ",", view, offset, component_type, count, type);
+	out += accessor;
+}
+
+bool GLBLoader::Save(
+	const std::string& filename,
+	const Vertex* vertices,
+	size_t vertex_count,
+	const void* indices,
+	size_t index_count,
+	size_t index_size,
+	const std::vector<IndexRange>& ranges,
+	const std::vector<Material>& materials)
+{
+	if (index_size != sizeof(uint16_t) && index_size != sizeof(uint32_t))
+		return false;
+	const int indexType = index_size == sizeof(uint16_t) ? ComponentUnsignedShort : ComponentUnsignedInt;
+
+	// BIN chunk: interleaved vertices, TEXCOORD_0 for other readers, indices
+	const size_t vertexBytes = vertex_count * sizeof(Vertex);
+	const size_t texcoordBytes = vertex_count * sizeof(vec2f);
+	const size_t indexBytes = index_count * index_size;
+	const size_t binSize = (vertexBytes + texcoordBytes + indexBytes + 3) & ~(size_t)3;
+
+	std::vector<vec2f> texcoords(vertex_count);
+	for (size_t i = 0; i < vertex_count; i++)
+		texcoords[i] = vec2f(vertices[i].TexCoord.x, 1.0f - vertices[i].TexCoord.y);
+
+	auto getIndex = [&](size_t i) -> unsigned
+	{
+		return index_size == sizeof(uint16_t) ? ((const uint16_t*)indices)[i] : ((const uint32_t*)indices)[i];
+	};
+
+	// Vertex accessors are shared by the ranges with the same base vertex and
+	// cover the vertices up to the highest index used, relative to the base vertex
+	std::map<unsigned, size_t> baseVertexCounts;
+	for (const IndexRange& range : ranges)
+	{
+		size_t& count = baseVertexCounts[range.Offset];
+		for (size_t i = range.Start; i < range.Start + range.Size && i < index_count; i++)
+			count = (std::max)(count, (size_t)getIndex(i) + 1);
+	}
+
+	std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"eduRend\"}";
+	char text[512];
+	snprintf(text, sizeof(text), ",\"buffers\":[{\"byteLength\":%zu}]"
+		",\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu,\"byteStride\":%zu,\"target\":34962}"
+		",{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34962}"
+		",{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34963}]",
+		binSize, vertexBytes, sizeof(Vertex), vertexBytes, texcoordBytes, vertexBytes + texcoordBytes, indexBytes);
+	json += text;
+
+	// Accessors: six per base vertex, then one per range
+	std::map<unsigned, int> baseVertexAccessors;
+	json += ",\"accessors\":[";
+	int accessorCount = 0;
+	for (const auto& base : baseVertexCounts)
+	{
+		const size_t first = base.first, count = (std::min)(base.second, vertex_count - first);
+		vec3f lo = vertices[first].Position, hi = lo;
+		for (size_t i = first; i < first + count; i++)
+		{
+			const vec3f& p = vertices[i].Position;
+			lo = vec3f((std::min)(lo.x, p.x), (std::min)(lo.y, p.y), (std::min)(lo.z, p.z));
+			hi = vec3f((std::max)(hi.x, p.x), (std::max)(hi.y, p.y), (std::max)(hi.z, p.z));
+		}
+
+		baseVertexAccessors[base.first] = accessorCount;
+		append_accessor(json, 0, first * sizeof(Vertex) + PositionOffset, ComponentFloat, count, "VEC3");
+		json += ",\"min\":";
+		append_floats(json, &lo.x, 3);
+		json += ",\"max\":";
+		append_floats(json, &hi.x, 3);
+		json += '}';
+		append_accessor(json, 0, first * sizeof(Vertex) + NormalOffset, ComponentFloat, count, "VEC3");
+		json += '}';
+		append_accessor(json, 0, first * sizeof(Vertex) + TangentOffset, ComponentFloat, count, "VEC3");
+		json += '}';
+		append_accessor(json, 0, first * sizeof(Vertex) + BinormalOffset, ComponentFloat, count, "VEC3");
+		json += '}';
+		append_accessor(json, 0, first * sizeof(Vertex) + TexCoordOffset, ComponentFloat, count, "VEC2");
+		json += '}';
+		append_accessor(json, 1, first * sizeof(vec2f), ComponentFloat, count, "VEC2");
+		json += '}';
+		accessorCount += 6;
+	}
+	for (const IndexRange& range : ranges)
+	{
+		append_accessor(json, 2, range.Start * index_size, indexType, range.Size, "SCALAR");
+		json += '}';
+	}
+	json += ']';
+
+	// One primitive per range
+	json += ",\"meshes\":[{\"primitives\":[";
+	for (size_t r = 0; r < ranges.size(); r++)
+	{
+		const int a = baseVertexAccessors[ranges[r].Offset];
+		snprintf(text, sizeof(text), "%s{\"attributes\":{\"POSITION\":%d,\"NORMAL\":%d,\"_TANGENT\":%d,\"_BINORMAL\":%d,\"_TEXCOORD\":%d,\"TEXCOORD_0\":%d}"
+			",\"indices\":%d,\"mode\":%d", r ? "," : "", a, a + 1, a + 2, a + 3, a + 4, a + 5, accessorCount + (int)r, ModeTriangles);
+		json += text;
+		if (ranges[r].MaterialIndex >= 0 && ranges[r].MaterialIndex < (int)materials.size())
+			json += ",\"material\":" + std::to_string(ranges[r].MaterialIndex);
+		json += '}';
+	}
+	json += "]}],\"nodes\":[{\"mesh\":0}],\"scenes\":[{\"nodes\":[0]}],\"scene\":0";
+
+	// Materials, with the Phong colours as extras. Textures refer to images by path.
+	const std::string directory = get_parentdir(filename);
+	std::vector<std::string> images;
+	auto getTexture = [&](const std::string& path) -> size_t
+	{
+		std::string uri = directory.size() && path.compare(0, directory.size(), directory) == 0 ? path.substr(directory.size()) : path;
+		uri = encode_uri(uri);
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			if (images[i] == uri)
+				return i;
+		}
+		images.push_back(uri);
+		return images.size() - 1;
+	};
+
+	if (materials.size())
+	{
+		json += ",\"materials\":[";
+		for (size_t i = 0; i < materials.size(); i++)
+		{
+			const Material& material = materials[i];
+			const float baseColor[4] = { material.DiffuseColour.x, material.DiffuseColour.y, material.DiffuseColour.z, 1.0f };
+			const float gloss = (material.SpecularColour.x + material.SpecularColour.y + material.SpecularColour.z) / 3.0f;
+
+			json += i ? ",{\"name\":" : "{\"name\":";
+			append_string(json, material.Name);
+			json += ",\"pbrMetallicRoughness\":{\"baseColorFactor\":";
+			append_floats(json, baseColor, 4);
+			snprintf(text, sizeof(text), ",\"metallicFactor\":0,\"roughnessFactor\":%.9g", (std::min)((std::max)(1.0f - gloss, 0.0f), 1.0f));
+			json += text;
+			if (material.DiffuseTextureFilename.size())
+				json += ",\"baseColorTexture\":{\"index\":" + std::to_string(getTexture(material.DiffuseTextureFilename)) + "}";
+			json += '}';
+			if (material.NormalTextureFilename.size())
+				json += ",\"normalTexture\":{\"index\":" + std::to_string(getTexture(material.NormalTextureFilename)) + "}";
+			json += ",\"extras\":{\"ambient\":";
+			append_floats(json, &material.AmbientColour.x, 3);
+			json += ",\"specular\":";
+			append_floats(json, &material.SpecularColour.x, 3);
+			json += "}}";
+		}
+		json += ']';
+	}
+
+	if (images.size())
+	{
+		json += ",\"images\":[";
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			json += i ? ",{\"uri\":" : "{\"uri\":";
+			append_string(json, images[i]);
+			json += '}';
+		}
+		json += "],\"textures\":[";
+		for (size_t i = 0; i < images.size(); i++)
+			json += (i ? ",{\"source\":" : "{\"source\":") + std::to_string(i) + "}";
+		json += ']';
+	}
+	json += '}';
+
+	// The JSON chunk is padded with spaces, the BIN chunk with zeros
+	while (json.size() % 4)
+		json += ' ';
+
+	glb_header_t header = { GLBMagic, GLBVersion, 0 };
+	glb_chunk_t jsonChunk = { (uint32_t)json.size(), GLBChunkJSON };
+	glb_chunk_t binChunk = { (uint32_t)binSize, GLBChunkBIN };
+	const size_t length = sizeof(header) + sizeof(jsonChunk) + json.size() + sizeof(binChunk) + binSize;
+	if (length > UINT32_MAX)
+		return false;
+	header.length = (uint32_t)length;
+
+	std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	static const char padding[4] = { 0 };
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)&jsonChunk, sizeof(jsonChunk));
+	out.write(json.data(), (std::streamsize)json.size());
+	out.write((const char*)&binChunk, sizeof(binChunk));
+	out.write((const char*)vertices, (std::streamsize)vertexBytes);
+	out.write((const char*)texcoords.data(), (std::streamsize)texcoordBytes);
+	out.write((const char*)indices, (std::streamsize)indexBytes);
+	out.write(padding, (std::streamsize)(binSize - vertexBytes - texcoordBytes - indexBytes));
+	return (bool)out;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file glbloader.h
+ * @brief glTF 2.0 binary (.glb) loader
+*/
+
+#pragma once
+#ifndef GLBLOADER_H
+#define GLBLOADER_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include "Drawcall.h"
+#include "mappedfile.h"
+#include "loadreport.h"
+
+/**
+ * @brief glTF 2.0 binary (.glb) loader.
+ * @details Reads the triangle primitives of the default scene into the same index buffer
+ * layout as OBJLoader with OBJOutput::IndexBuffer: one vertex array, one index buffer and an
+ * IndexRange per primitive, plus Materials.
+ *
+ * Files written by Save() are used without copying: the vertex and index arrays point straight
+ * into the memory mapped file, like MeshCache. Other files are converted into VertexStorage and
+ * IndexStorage. A file is used in place when
+ * - every primitive reads POSITION, NORMAL, _TANGENT, _BINORMAL and _TEXCOORD (float vec3/vec2)
+ *   from a single buffer view with a stride of sizeof(Vertex), at the offsets of the Vertex members,
+ * - every primitive reads 16- or 32-bit indices (the same size for all) from a single buffer view,
+ * - no node has a transform other than identity and no mesh is used by more than one node.
+ *
+ * _TANGENT, _BINORMAL and _TEXCOORD are application specific attributes in eduRend's conventions
+ * (_TEXCOORD has v pointing up, like OBJ). When they are missing, texture coordinates come from
+ * TEXCOORD_0 and the tangents are left for the caller to compute (HasTangents is false).
+ *
+ * Not supported: embedded images, data: URIs, sparse accessors, morph targets and skins.
+ * Primitives that are not triangle lists are skipped.
+*/
+class GLBLoader
+{
+public:
+	/**
+	 * @brief Loads a .glb file.
+	 * @param filename Path to the file.
+	 * @throw std::runtime_error if the file can not be read or is not a valid glTF 2.0 binary.
+	*/
+	void Load(const std::string& filename);
+
+	/**
+	 * @brief Writes a mesh as a .glb file that Load() can use in place.
+	 * @details Texture paths are stored relative to the directory of filename when they are
+	 * inside it. A standard TEXCOORD_0 is written next to _TEXCOORD for other glTF readers.
+	 * @param[in] filename Path of the .glb file.
+	 * @param[in] vertices Vertex array.
+	 * @param[in] vertex_count Number of vertices.
+	 * @param[in] indices Index buffer.
+	 * @param[in] index_count Number of indices.
+	 * @param[in] index_size Size of an index in bytes, 2 or 4.
+	 * @param[in] ranges Index ranges (drawcalls) within the index buffer, written as one primitive each.
+	 * @param[in] materials Materials referenced by the ranges.
+	 * @return True if the file was written.
+	*/
+	static bool Save(
+		const std::string& filename,
+		const Vertex* vertices,
+		size_t vertex_count,
+		const void* indices,
+		size_t index_count,
+		size_t index_size,
+		const std::vector<IndexRange>& ranges,
+		const std::vector<Material>& materials);
+
+	const Vertex* Vertices() const { return m_vertices; } //!< Vertex array, in the mapped file or in VertexStorage
+	size_t VertexCount() const { return m_vertex_count; } //!< Number of vertices
+	const void* Indices() const { return m_indices; } //!< Index buffer, in the mapped file or in IndexStorage
+	size_t IndexCount() const { return m_index_count; } //!< Number of indices
+	size_t IndexSize() const { return m_index_size; } //!< Size of an index in bytes, 2 or 4
+	bool IsMapped() const { return m_vertices && m_vertices != VertexStorage.data(); } //!< True if the arrays point into the file
+
+	std::vector<Vertex> VertexStorage; //!< Converted vertices, empty if the file is used in place
+	std::vector<unsigned> IndexStorage; //!< Converted indices, empty if the file is used in place
+	std::vector<IndexRange> IndexRanges; //!< Index ranges of the primitives
+	std::vector<Material> Materials; //!< Materials, without device textures
+	bool HasTangents = false; //!< True if the vertices have tangents and binormals
+
+	LoadReport Report; //!< Timings and sizes of the last Load()
+
+private:
+	MappedFile m_file;
+	std::vector<std::unique_ptr<MappedFile>> m_external; // buffers in separate files
+	const Vertex* m_vertices = nullptr;
+	size_t m_vertex_count = 0;
+	const void* m_indices = nullptr;
+	size_t m_index_count = 0;
+	size_t m_index_size = 0;
+};
+
+#endif
@@ -0,0 +1,308 @@
+//
+//  Minimal JSON reader
+//
+
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include "json.h"
+
+static const JsonValue NullValue;
+static const std::string EmptyString;
+
+// Deepest nesting accepted, keeps malformed input from exhausting the stack
+static const int MaxDepth = 256;
+
+/**
+ * @brief Recursive descent parser producing JsonValues.
+*/
+class JsonParser
+{
+public:
+	JsonParser(const char* begin, const char* end) : m_begin(begin), m_p(begin), m_end(end) {}
+
+	JsonValue ParseDocument()
+	{
+		JsonValue value;
+		ParseValue(value, 0);
+		SkipWhitespace();
+		if (m_p != m_end)
+			Fail("trailing characters");
+		return value;
+	}
+
+private:
+	const char* m_begin;
+	const char* m_p;
+	const char* m_end;
+
+	[[noreturn]] void Fail(const char* what)
+	{
+		throw std::runtime_error(std::string("JSON: ") + what + " at offset " + std::to_string(m_p - m_begin));
+	}
+
+	void SkipWhitespace()
+	{
+		while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r'))
+			m_p++;
+	}
+
+	bool Consume(char c)
+	{
+		SkipWhitespace();
+		if (m_p < m_end && *m_p == c)
+		{
+			m_p++;
+			return true;
+		}
+		return false;
+	}
+
+	void Expect(char c)
+	{
+		if (!Consume(c))
+		{
+			char what[] = "expected ' '";
+			what[10] = c;
+			Fail(what);
+		}
+	}
+
+	void ParseLiteral(const char* literal)
+	{
+		size_t length = strlen(literal);
+		if ((size_t)(m_end - m_p) < length || memcmp(m_p, literal, length))
+			Fail("invalid literal");
+		m_p += length;
+	}
+
+	void ParseValue(JsonValue& value, int depth)
+	{
+		if (depth > MaxDepth)
+			Fail("nesting too deep");
+
+		SkipWhitespace();
+		if (m_p >= m_end)
+			Fail("unexpected end");
+
+		switch (*m_p)
+		{
+		case '{':
+		{
+			m_p++;
+			value.m_type = JsonValue::Type::Object;
+			if (Consume('}'))
+				return;
+			do
+			{
+				SkipWhitespace();
+				if (m_p >= m_end || *m_p != '"')
+					Fail("expected member name");
+				value.m_keys.emplace_back();
+				ParseString(value.m_keys.back());
+				Expect(':');
+				value.m_elements.emplace_back();
+				ParseValue(value.m_elements.back(), depth + 1);
+			} while (Consume(','));
+			Expect('}');
+			return;
+		}
+		case '[':
+		{
+			m_p++;
+			value.m_type = JsonValue::Type::Array;
+			if (Consume(']'))
+				return;
+			do
+			{
+				value.m_elements.emplace_back();
+				ParseValue(value.m_elements.back(), depth + 1);
+			} while (Consume(','));
+			Expect(']');
+			return;
+		}
+		case '"':
+			value.m_type = JsonValue::Type::String;
+			ParseString(value.m_string);
+			return;
+		case 't':
+			ParseLiteral("true");
+			value.m_type = JsonValue::Type::Bool;
+			value.m_bool = true;
+			return;
+		case 'f':
+			ParseLiteral("false");
+			value.m_type = JsonValue::Type::Bool;
+			value.m_bool = false;
+			return;
+		case 'n':
+			ParseLiteral("null");
+			return;
+		default:
+			value.m_type = JsonValue::Type::Number;
+			value.m_number = ParseNumber();
+			return;
+		}
+	}
+
+	double ParseNumber()
+	{
+		const char* s = m_p;
+		bool negative = s < m_end && *s == '-';
+		if (negative)
+			s++;
+
+		// Integers, which is most of what glTF contains, are converted exactly here
+		const char* digits = s;
+		uint64_t integer = 0;
+		while (s < m_end && (unsigned)(*s - '0') <= 9 && s - digits < 18)
+			integer = integer * 10 + (*s++ - '0');
+		if (s == digits)
+			Fail("invalid value");
+		if (s >= m_end || (*s != '.' && *s != 'e' && *s != 'E' && (unsigned)(*s - '0') > 9))
+		{
+			m_p = s;
+			return negative ? -(double)integer : (double)integer;
+		}
+
+		// Anything else goes through strtod on a terminated copy of the token
+		s = m_p;
+		while (s < m_end && (strchr("+-.eE", *s) || (unsigned)(*s - '0') <= 9))
+			s++;
+		std::string token(m_p, s);
+		char* tokenEnd = nullptr;
+		double value = strtod(token.c_str(), &tokenEnd);
+		if (tokenEnd != token.c_str() + token.size())
+			Fail("invalid number");
+		m_p = s;
+		return value;
+	}
+
+	static void AppendUTF8(std::string& out, unsigned code)
+	{
+		if (code < 0x80)
+			out += (char)code;
+		else if (code < 0x800)
+		{
+			out += (char)(0xC0 | (code >> 6));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000)
+		{
+			out += (char)(0xE0 | (code >> 12));
+			out += (char)(0x80 | ((code >> 6) & 0x3F));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+		else
+		{
+			out += (char)(0xF0 | (code >> 18));
+			out += (char)(0x80 | ((code >> 12) & 0x3F));
+			out += (char)(0x80 | ((code >> 6) & 0x3F));
+			out += (char)(0x80 | (code & 0x3F));
+		}
+	}
+
+	unsigned ParseHex4()
+	{
+		if (m_end - m_p < 4)
+			Fail("invalid escape");
+		unsigned code = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			char c = *m_p++;
+			code <<= 4;
+			if (c >= '0' && c <= '9') code |= c - '0';
+			else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+			else Fail("invalid escape");
+		}
+		return code;
+	}
+
+	void ParseString(std::string& out)
+	{
+		m_p++; // opening quote
+		for (;;)
+		{
+			// copy runs without escapes in one go
+			const char* run = m_p;
+			while (m_p < m_end && *m_p != '"' && *m_p != '\\')
+				m_p++;
+			out.append(run, m_p);
+
+			if (m_p >= m_end)
+				Fail("unterminated string");
+			if (*m_p++ == '"')
+				return;
+
+			if (m_p >= m_end)
+				Fail("unterminated string");
+			switch (*m_p++)
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				unsigned code = ParseHex4();
+				// surrogate pair
+				if (code >= 0xD800 && code < 0xDC00 && m_end - m_p >= 6 && m_p[0] == '\\' && m_p[1] == 'u')
+				{
+					m_p += 2;
+					unsigned low = ParseHex4();
+					if (low >= 0xDC00 && low < 0xE000)
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				AppendUTF8(out, code);
+				break;
+			}
+			default:
+				Fail("invalid escape");
+			}
+		}
+	}
+};
+
+JsonValue JsonValue::Parse(const char* begin, const char* end)
+{
+	return JsonParser(begin, end).ParseDocument();
+}
+
+const std::string& JsonValue::String() const
+{
+	return m_type == Type::String ? m_string : EmptyString;
+}
+
+size_t JsonValue::Size() const
+{
+	return m_type == Type::Array || m_type == Type::Object ? m_elements.size() : 0;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	return (m_type == Type::Array || m_type == Type::Object) && index < m_elements.size() ? m_elements[index] : NullValue;
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+	if (m_type == Type::Object)
+	{
+		for (size_t i = 0; i < m_keys.size(); i++)
+		{
+			if (m_keys[i] == key)
+				return m_elements[i];
+		}
+	}
+	return NullValue;
+}
+
+const std::string& JsonValue::Key(size_t index) const
+{
+	return m_type == Type::Object && index < m_keys.size() ? m_keys[index] : EmptyString;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file json.h
+ * @brief Minimal JSON reader, enough for glTF
+*/
+
+#pragma once
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+/**
+ * @brief A parsed JSON value.
+ * @details Lookups never fail: a missing key or index, or a value of the wrong type, gives
+ * a null value and the accessors fall back to the supplied default. This keeps code reading
+ * optional fields (as most of glTF is) short.
+*/
+class JsonValue
+{
+public:
+	/**
+	 * @brief Type of a value
+	*/
+	enum class Type { Null, Bool, Number, String, Array, Object };
+
+	/**
+	 * @brief Parses a JSON document.
+	 * @param begin Start of the text, UTF-8.
+	 * @param end End of the text.
+	 * @return The root value.
+	 * @throw std::runtime_error with the byte offset if the text is not valid JSON.
+	*/
+	static JsonValue Parse(const char* begin, const char* end);
+
+	Type GetType() const { return m_type; } //!< Type of the value
+	bool IsNull() const { return m_type == Type::Null; } //!< True for null and missing values
+
+	double Number(double fallback = 0) const { return m_type == Type::Number ? m_number : fallback; } //!< Number, or fallback
+	int Int(int fallback = 0) const { return m_type == Type::Number ? (int)m_number : fallback; } //!< Number as int, or fallback
+	bool Bool(bool fallback = false) const { return m_type == Type::Bool ? m_bool : fallback; } //!< Boolean, or fallback
+	const std::string& String() const; //!< String, or "" if not a string
+
+	size_t Size() const; //!< Number of elements in an array or members in an object, 0 otherwise
+	const JsonValue& operator[](size_t index) const; //!< Array element, null if out of range
+	const JsonValue& operator[](int index) const { return (*this)[(size_t)index]; } //!< Array element, null if out of range or negative
+	const JsonValue& operator[](const char* key) const; //!< Object member, null if missing
+	const std::string& Key(size_t index) const; //!< Name of an object member, by index
+
+private:
+	Type m_type = Type::Null;
+	bool m_bool = false;
+	double m_number = 0;
+	std::string m_string;
+	std::vector<JsonValue> m_elements; // array elements or object member values
+	std::vector<std::string> m_keys; // object member names, parallel to m_elements
+
+	friend class JsonParser;
+};
+
+#endif
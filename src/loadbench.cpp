@@ -0,0 +1,243 @@
+//
+//  Load time benchmarks for the mesh loaders
+//
+
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include "loadbench.h"
+#include "OBJLoader.h"
+#include "OBJModel.h"
+#include "glbloader.h"
+#include "meshsplit.h"
+#include "meshgen.h"
+
+/**
+ * @brief Best and average time of repeated runs
+*/
+struct bench_result_t
+{
+	double best = 0;
+	double average = 0;
+};
+
+//
+// Times runs calls of load, which returns false on failure
+//
+static bool time_runs(int runs, const std::function<bool()>& load, bench_result_t& result)
+{
+	double total = 0;
+	for (int i = 0; i < runs; i++)
+	{
+		LoadTimer timer;
+		if (!load())
+			return false;
+		const double time = timer.Lap();
+		result.best = i ? (std::min)(result.best, time) : time;
+		total += time;
+	}
+	result.average = runs ? total / runs : 0;
+	return true;
+}
+
+bool BenchmarkGLB(const std::string& objfile, int runs)
+{
+	const std::string glbfile = objfile + ".glb";
+	std::vector<char> staging;
+
+	// Copies the final arrays, standing in for the buffer upload
+	auto stage = [&](const void* vertices, size_t vertex_bytes, const void* indices, size_t index_bytes)
+	{
+		staging.resize(vertex_bytes + index_bytes);
+		memcpy(staging.data(), vertices, vertex_bytes);
+		memcpy(staging.data() + vertex_bytes, indices, index_bytes);
+	};
+
+	try
+	{
+		// Convert the mesh the way OBJModel loads it
+		{
+			OBJLoader mesh;
+			mesh.Load(objfile, true, true, OBJOutput::IndexBuffer);
+			OBJModel::ComputeTangents(mesh.Vertices, mesh.Indices.data(), mesh.Indices.size());
+
+			std::vector<uint16_t> indices16;
+			const void* indices = mesh.Indices.data();
+			size_t indexSize = sizeof(unsigned);
+			size_t indexCount = mesh.Indices.size();
+#ifdef MESH_16BIT_INDICES
+			bool split = false;
+#ifdef MESH_SPLIT_FOR_16BIT_INDICES
+			split = true;
+#endif
+			if (MakeIndices16(mesh.Vertices, mesh.Indices, mesh.IndexRanges, indices16, split))
+			{
+				indices = indices16.data();
+				indexSize = sizeof(uint16_t);
+			}
+#endif
+			if (!GLBLoader::Save(glbfile, mesh.Vertices.data(), mesh.Vertices.size(),
+				indices, indexCount, indexSize, mesh.IndexRanges, mesh.Materials))
+			{
+				printf("Benchmark: failed to write %s\n", glbfile.c_str());
+				return false;
+			}
+		}
+
+		bench_result_t obj, glb;
+		LoadReport objReport, glbReport;
+		bool mapped = false;
+
+		time_runs(runs, [&]()
+		{
+			OBJLoader mesh;
+			mesh.Load(objfile, true, true, OBJOutput::IndexBuffer);
+			stage(mesh.Vertices.data(), mesh.Vertices.size() * sizeof(Vertex), mesh.Indices.data(), mesh.Indices.size() * sizeof(unsigned));
+			objReport = mesh.Report;
+			return true;
+		}, obj);
+
+		time_runs(runs, [&]()
+		{
+			GLBLoader mesh;
+			mesh.Load(glbfile);
+			stage(mesh.Vertices(), mesh.VertexCount() * sizeof(Vertex), mesh.Indices(), mesh.IndexCount() * mesh.IndexSize());
+			glbReport = mesh.Report;
+			mapped = mesh.IsMapped();
+			return true;
+		}, glb);
+
+		printf("Load benchmark, %d runs of each\n", runs);
+		printf("  %-40s %10s %10s %10s %10s\n", "file", "bytes", "vertices", "best (s)", "avg (s)");
+		printf("  %-40s %10zu %10zu %10.4f %10.4f\n", objfile.c_str(), objReport.FileBytes, objReport.Vertices, obj.best, obj.average);
+		printf("  %-40s %10zu %10zu %10.4f %10.4f\n", glbfile.c_str(), glbReport.FileBytes, glbReport.Vertices, glb.best, glb.average);
+		printf("  .glb is %.1fx faster%s\n", glb.best > 0 ? obj.best / glb.best : 0.0,
+			mapped ? ", arrays used in place" : ", arrays converted");
+		printf("  (the .obj times exclude tangents and 16-bit conversion, which the .glb already contains)\n");
+	}
+	catch (const std::exception& e)
+	{
+		printf("Benchmark failed: %s\n", e.what());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Best time of each load phase of one file
+*/
+struct scaling_result_t
+{
+	static const int PhaseCount = 6;
+
+	double phases[PhaseCount] = {}; // parse, materials, normals, weld, sort, tangents
+	double total = 0;
+	size_t triangles = 0;
+	size_t vertices = 0;
+	size_t bytes = 0;
+};
+
+static const char* const scaling_phase_names[scaling_result_t::PhaseCount] =
+{
+	"parse", "materials", "normals", "weld", "sort", "tangents"
+};
+
+//
+// Prints to stdout and to the csv file
+//
+static void csv_print(std::ostream& csv, const char* format, ...)
+{
+	char text[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	fputs(text, stdout);
+	csv << text;
+}
+
+bool BenchmarkScaling(const std::string& directory, size_t max_triangles, int runs)
+{
+	std::vector<std::string> files;
+	if (!GenerateMeshCorpus(directory, max_triangles, &files))
+		return false;
+	const std::vector<MeshGenParams> corpus = MeshGenCorpus(max_triangles);
+
+	const bool slash = !directory.empty() && (directory.back() == '/' || directory.back() == '\\');
+	std::ofstream csv(directory + (slash ? "" : "/") + "scaling.csv", std::ios::trunc);
+	csv_print(csv, "file,triangles,vertices,bytes");
+	for (const char* name : scaling_phase_names)
+		csv_print(csv, ",%s_s", name);
+	csv_print(csv, ",total_s,mb_per_s,ns_per_triangle\n");
+
+	std::vector<scaling_result_t> results(files.size());
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		scaling_result_t& result = results[i];
+		try
+		{
+			for (int run = 0; run < runs; run++)
+			{
+				LoadTimer timer;
+				OBJLoader mesh;
+				mesh.Verbose = false;
+				mesh.Load(files[i], true, true, OBJOutput::IndexBuffer);
+				timer.Lap();
+				OBJModel::ComputeTangents(mesh.Vertices, mesh.Indices.data(), mesh.Indices.size());
+
+				const LoadReport& report = mesh.Report;
+				const double phases[scaling_result_t::PhaseCount] =
+				{
+					report.ParseTime, report.MaterialTime, report.NormalTime,
+					report.WeldTime, report.CCWTime + report.SortTime, timer.Lap()
+				};
+				double total = 0;
+				for (int p = 0; p < scaling_result_t::PhaseCount; p++)
+				{
+					result.phases[p] = run ? (std::min)(result.phases[p], phases[p]) : phases[p];
+					total += phases[p];
+				}
+				result.total = run ? (std::min)(result.total, total) : total;
+				result.triangles = report.Triangles;
+				result.vertices = report.Vertices;
+				result.bytes = report.FileBytes;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			csv_print(csv, "# %s failed: %s\n", files[i].c_str(), e.what());
+			return false;
+		}
+
+		csv_print(csv, "%s,%zu,%zu,%zu", MeshGenName(corpus[i]).c_str(), result.triangles, result.vertices, result.bytes);
+		for (double phase : result.phases)
+			csv_print(csv, ",%.6f", phase);
+		csv_print(csv, ",%.6f,%.1f,%.2f\n", result.total,
+			result.total > 0 ? result.bytes / result.total / (1 << 20) : 0.0,
+			result.triangles ? result.total * 1e9 / result.triangles : 0.0);
+
+		// Compare with the next smaller mesh of the same variant
+		MeshGenParams previous = i ? corpus[i - 1] : corpus[i];
+		previous.Triangles = corpus[i].Triangles;
+		const bool sameVariant = i && MeshGenName(previous) == MeshGenName(corpus[i]);
+		if (!sameVariant || results[i - 1].triangles < 100000)
+			continue;
+
+		const scaling_result_t& smaller = results[i - 1];
+		for (int p = 0; p < scaling_result_t::PhaseCount; p++)
+		{
+			const double before = smaller.phases[p] * 1e9 / smaller.triangles;
+			const double after = result.phases[p] * 1e9 / result.triangles;
+			if (after > 1.5 * before && after > 1.0)
+			{
+				csv_print(csv, "# super-linear %s: %.2f ns/triangle at %zu triangles, %.2f at %zu\n",
+					scaling_phase_names[p], before, smaller.triangles, after, result.triangles);
+			}
+		}
+	}
+	return true;
+}
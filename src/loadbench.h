@@ -0,0 +1,40 @@
+/**
+ * @file loadbench.h
+ * @brief Load time benchmarks for the mesh loaders
+*/
+
+#pragma once
+#ifndef LOADBENCH_H
+#define LOADBENCH_H
+
+#include <string>
+
+/**
+ * @brief Compares loading a mesh from .obj with OBJLoader and from .glb with GLBLoader.
+ * @details Loads objfile the way OBJModel does (index buffer, tangents, 16-bit indices) and
+ * writes it to objfile + ".glb" with GLBLoader::Save(). Then times both loaders, each followed
+ * by a copy of the vertex and index arrays to a staging buffer as the device upload would do,
+ * and prints the best and average times. The .glb file is left in place.
+ * @param objfile Path to the .obj file.
+ * @param runs Number of timed loads of each file.
+ * @return False if the mesh could not be loaded or written.
+*/
+bool BenchmarkGLB(const std::string& objfile, int runs = 5);
+
+/**
+ * @brief Measures how the OBJLoader phases scale with the size and shape of the mesh.
+ * @details Generates the corpus of GenerateMeshCorpus() into directory (files already there
+ * are reused), loads each file the way OBJModel does (index buffer, generated normals, tangents)
+ * and prints one CSV line per file with the best time of each phase, the throughput in MB/s of
+ * .obj text and the time per triangle. Lines starting with # are comments. The CSV is also written
+ * to scaling.csv in the directory. A phase whose time
+ * per triangle grows by more than half from one size to the next of the same variant is reported
+ * as super-linear, for meshes of 100K triangles and more where timer noise is small.
+ * @param directory Corpus directory.
+ * @param max_triangles Largest mesh size, up to 50M.
+ * @param runs Number of timed loads of each file.
+ * @return False if the corpus could not be written or a mesh could not be loaded.
+*/
+bool BenchmarkScaling(const std::string& directory, size_t max_triangles = 1000000, int runs = 3);
+
+#endif
@@ -0,0 +1,123 @@
+/**
+ * @file loadreport.h
+ * @brief Per-phase timings and sizes recorded while loading a model
+*/
+
+#pragma once
+#ifndef LOADREPORT_H
+#define LOADREPORT_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+/**
+ * @brief Where the time went when loading a model, and how much data it produced.
+ * @details OBJLoader fills in the loader phases, OBJModel adds the rest.
+ * Times are in seconds, phases that did not run are 0.
+*/
+struct LoadReport
+{
+	std::string Filename; //!< Source file of the model
+	bool FromCache = false; //!< True if the mesh was read from the binary mesh cache
+	bool CCWInWeld = false; //!< True if triangles were made counter-clockwise while welding (OBJOutput::IndexBuffer), so WeldTime includes it
+
+	// OBJLoader phases
+	double ParseTime = 0; //!< Reading and parsing the .obj file, merging parse chunks
+	double MaterialTime = 0; //!< Reading the .mtl files
+	double NormalTime = 0; //!< Generating normals
+	double WeldTime = 0; //!< Welding the vertex array
+	double CCWTime = 0; //!< Forcing counter-clockwise triangles (Drawcalls output, index buffers are fixed while welding)
+	double SortTime = 0; //!< Sorting and merging drawcalls
+
+	// OBJModel phases
+	double CacheReadTime = 0; //!< Reading the mesh cache
+	double TangentTime = 0; //!< Computing tangents and binormals
+	double OptimizeTime = 0; //!< Reordering triangles for the vertex cache and overdraw, including measuring it before and after
+	double FetchTime = 0; //!< Reordering vertices for vertex fetch, including measuring it before and after
+	double LodTime = 0; //!< Generating the levels of detail
+	double IndexTime = 0; //!< Converting to 16-bit indices
+	double CompactTime = 0; //!< Encoding the vertices as CompactVertex
+	double CacheWriteTime = 0; //!< Writing the mesh cache
+	double BufferTime = 0; //!< Creating the vertex and index buffers
+	double TotalTime = 0; //!< Whole load, including textures
+
+	/**
+	 * @brief A texture loaded by the model
+	*/
+	struct TextureLoad
+	{
+		std::string Filename; //!< Texture file
+		double Time; //!< Decoding and uploading the texture
+		bool Succeeded; //!< False if loading failed
+	};
+	std::vector<TextureLoad> Textures; //!< Textures in load order
+
+	// Sizes
+	size_t FileBytes = 0; //!< Size of the .obj file
+	size_t FilePositions = 0; //!< Positions (v) in the file
+	size_t FileNormals = 0; //!< Normals (vn) in the file, or generated
+	size_t FileTexcoords = 0; //!< Texture coordinates (vt) in the file
+	size_t Vertices = 0; //!< Vertices after welding
+	size_t Triangles = 0; //!< Triangles after triangulation
+	size_t Drawcalls = 0; //!< Drawcalls (index ranges) that are rendered
+	size_t UnmergedDrawcalls = 0; //!< Drawcalls before merging same-material drawcalls
+	size_t Materials = 0; //!< Materials used by the model
+	size_t VertexBytes = 0; //!< Size of the vertex buffer
+	size_t IndexBytes = 0; //!< Size of the index buffer
+	size_t TempBytes = 0; //!< Temporary memory used by the loader, from its LoadArena
+
+	// Post-transform vertex cache, see AnalyzeVertexCache(). 0 if the mesh was not optimized.
+	float ACMRBefore = 0; //!< Vertex shader invocations per triangle in file order
+	float ACMRAfter = 0; //!< Vertex shader invocations per triangle after OptimizeVertexCache() and OptimizeOverdraw()
+	float ATVRBefore = 0; //!< Vertex shader invocations per vertex in file order
+	float ATVRAfter = 0; //!< Vertex shader invocations per vertex after OptimizeVertexCache() and OptimizeOverdraw()
+
+	// Vertex fetch, see AnalyzeVertexFetch(). 0 if the vertices were not reordered.
+	float OverfetchBefore = 0; //!< Bytes fetched per vertex byte in weld order
+	float OverfetchAfter = 0; //!< Bytes fetched per vertex byte after OptimizeVertexFetch()
+
+	/**
+	 * @brief A level of detail of the mesh, see GenerateLods()
+	*/
+	struct LodLevel
+	{
+		size_t Triangles; //!< Triangles drawn at this level
+		float Error; //!< Geometric error in model units
+	};
+	std::vector<LodLevel> Lods; //!< Levels of detail, from the most to the least detailed
+
+	/**
+	 * @brief Time spent on textures.
+	*/
+	double TextureTime() const
+	{
+		double time = 0;
+		for (auto& texture : Textures)
+			time += texture.Time;
+		return time;
+	}
+};
+
+/**
+ * @brief Measures the time since construction or the last Lap().
+*/
+class LoadTimer
+{
+public:
+	/**
+	 * @brief Returns the seconds since the last call (or construction) and restarts the timer.
+	*/
+	double Lap()
+	{
+		auto now = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration<double>(now - m_start).count();
+		m_start = now;
+		return seconds;
+	}
+
+private:
+	std::chrono::high_resolution_clock::time_point m_start = std::chrono::high_resolution_clock::now();
+};
+
+#endif
@@ -30,6 +30,12 @@
 #include "imgui.h"
 #include "imgui_impl_win32.h"
 #include "imgui_impl_dx11.h"
+#include "loadbench.h"
+#include "meshgen.h"
+#include "meshoptimize.h"
+#include "meshcompact.h"
+#include "objmodel.h"
+#include <shellapi.h>
 
 #ifdef FORCE_DGPU
 #include "dgpuforcer.h"
@@ -48,6 +54,7 @@ static ID3D11DeviceContext*		deviceContext		= nullptr;
 static ID3D11RasterizerState*	rasterState			= nullptr;
 
 static shader_data*				vertexShader		= nullptr;
+static shader_data*				compactVertexShader	= nullptr;
 static shader_data*				pixelShader			= nullptr;
 
 #ifdef _DEBUG
@@ -76,6 +83,7 @@ void				SetViewport(int width, int height);
 void				Release();
 void				WinResize();
 void				ShowMetrics(bool* p_open);
+bool				RunCommandLineBenchmark();
 
 //--------------------------------------------------------------------------------------
 // Entry point to the program. Initializes everything and goes into a message processing 
@@ -96,6 +104,10 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE, _In_ LPWSTR, _I
 		freopen_s(&fpstderr, "conout$", "w", stderr);
 	}
 #endif
+
+	// Benchmarks run without a window and exit
+	if (RunCommandLineBenchmark())
+		return 0;
 	
 	// Init the win32 window
 	window.Init(initialWinWidth, initialWinHeight);
@@ -144,6 +156,25 @@ int WINAPI wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE, _In_ LPWSTR, _I
 				// Can't continue the program if the shader fails to load.
 				return -1;
 			}
+
+#ifdef MESH_QUANTIZE_POSITIONS
+			const DXGI_FORMAT compactPositionFormat = DXGI_FORMAT_R16G16B16A16_UNORM;
+#else
+			const DXGI_FORMAT compactPositionFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;
+#endif
+			const D3D11_INPUT_ELEMENT_DESC compactInputDesc[3] = {
+					{ "POSITION", 0, compactPositionFormat, 0, offsetof(CompactVertex, Position), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+					{ "FRAME", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, offsetof(CompactVertex, Frame), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+					{ "TEX", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(CompactVertex, TexCoord), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			};
+
+			if(FAILED(create_shader(device, "shaders/vertex_shader.hlsl", "VS_compact", SHADER_VERTEX, &compactInputDesc[0], 3, &compactVertexShader)))
+			{
+				// Can't continue the program if the shader fails to load.
+				return -1;
+			}
+			OBJModel::SetVertexShaders(vertexShader, compactVertexShader);
+
 			if(FAILED(create_shader(device, "shaders/pixel_shader.hlsl", "PS_main", SHADER_PIXEL, nullptr, 0, &pixelShader)))
 			{
 				// Can't continue the program if the shader fails to load.
@@ -449,7 +480,8 @@ HRESULT Render(float deltaTime)
 	// Set topology
 	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		
-	// Bind shaders
+	// Bind shaders, the compact vertex shader is only reloaded if its file changed, OBJModel binds it itself
+	reload_shader(device, compactVertexShader);
 	bind_shader(device, deviceContext, vertexShader);
 	bind_shader(device, deviceContext, pixelShader);
 
@@ -517,6 +549,74 @@ void ShowMetrics(bool* p_open) {
 
 		// show fps
 		ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+
+		// show background loading progress
+		if (scene && scene->PendingLoads())
+			ImGui::Text("Loading %d assets...", (int)scene->PendingLoads());
+
+		// show per-phase load times of the scene's models
+		std::vector<const LoadReport*> reports;
+		if (scene)
+			scene->GetLoadReports(reports);
+		if (reports.size() && ImGui::CollapsingHeader("Model loading"))
+		{
+			for (size_t i = 0; i < reports.size(); i++)
+			{
+				const LoadReport& report = *reports[i];
+				ImGui::PushID((int)i);
+				if (ImGui::TreeNode("report", "%s (%.1f ms%s)", report.Filename.c_str(), report.TotalTime * 1000.0, report.FromCache ? ", cached" : ""))
+				{
+					if (report.FromCache)
+						ImGui::Text("Cache read:   %8.2f ms", report.CacheReadTime * 1000.0);
+					else
+					{
+						ImGui::Text("Parse:        %8.2f ms  (%.1f MB)", report.ParseTime * 1000.0, report.FileBytes / (1024.0 * 1024.0));
+						ImGui::Text("Materials:    %8.2f ms", report.MaterialTime * 1000.0);
+						ImGui::Text("Normals:      %8.2f ms", report.NormalTime * 1000.0);
+						if (report.CCWInWeld)
+							ImGui::Text("Weld + CCW:   %8.2f ms", report.WeldTime * 1000.0);
+						else
+						{
+							ImGui::Text("Weld:         %8.2f ms", report.WeldTime * 1000.0);
+							ImGui::Text("CCW fixup:    %8.2f ms", report.CCWTime * 1000.0);
+						}
+						ImGui::Text("Sort/merge:   %8.2f ms", report.SortTime * 1000.0);
+						ImGui::Text("Tangents:     %8.2f ms", report.TangentTime * 1000.0);
+						ImGui::Text("Vertex cache: %8.2f ms", report.OptimizeTime * 1000.0);
+						ImGui::Text("Vertex fetch: %8.2f ms", report.FetchTime * 1000.0);
+						ImGui::Text("LODs:         %8.2f ms", report.LodTime * 1000.0);
+						ImGui::Text("16-bit index: %8.2f ms", report.IndexTime * 1000.0);
+						ImGui::Text("Compact:      %8.2f ms", report.CompactTime * 1000.0);
+						ImGui::Text("Cache write:  %8.2f ms", report.CacheWriteTime * 1000.0);
+					}
+					ImGui::Text("Buffers:      %8.2f ms", report.BufferTime * 1000.0);
+					ImGui::Text("Textures:     %8.2f ms", report.TextureTime() * 1000.0);
+					for (auto& texture : report.Textures)
+						ImGui::BulletText("%.2f ms %s%s", texture.Time * 1000.0, texture.Filename.c_str(), texture.Succeeded ? "" : " (failed)");
+
+					ImGui::Separator();
+					if (!report.FromCache)
+					{
+						ImGui::Text("File: %zu v, %zu vn, %zu vt", report.FilePositions, report.FileNormals, report.FileTexcoords);
+						ImGui::Text("Loader temporaries %.2f MB", report.TempBytes / (1024.0 * 1024.0));
+						if (report.ACMRBefore > 0)
+						{
+							ImGui::Text("ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (FIFO %d)",
+								report.ACMRBefore, report.ACMRAfter, report.ATVRBefore, report.ATVRAfter, MESH_VERTEX_CACHE_SIZE);
+						}
+						if (report.OverfetchBefore > 0)
+							ImGui::Text("Vertex overfetch %.3f -> %.3f", report.OverfetchBefore, report.OverfetchAfter);
+					}
+					ImGui::Text("%zu vertices, %zu triangles, %zu materials", report.Vertices, report.Triangles, report.Materials);
+					ImGui::Text("%zu drawcalls (%zu before merge)", report.Drawcalls, report.UnmergedDrawcalls);
+					ImGui::Text("Vertex buffer %.2f MB, index buffer %.2f MB", report.VertexBytes / (1024.0 * 1024.0), report.IndexBytes / (1024.0 * 1024.0));
+					for (auto& lod : report.Lods)
+						ImGui::BulletText("LOD %zu triangles, error %g", lod.Triangles, lod.Error);
+					ImGui::TreePop();
+				}
+				ImGui::PopID();
+			}
+		}
 		
 		ImGui::End();
 	}
@@ -531,6 +631,7 @@ void Release()
 	SAFE_RELEASE(scene);
 
 	delete_shader(vertexShader);
+	delete_shader(compactVertexShader);
 	delete_shader(pixelShader);
 
 	SAFE_RELEASE(swapChain);
@@ -550,4 +651,57 @@ void Release()
 
 	inputHandler.Shutdown();
 	window.Shutdown();
-}
\ No newline at end of file
+}
+//--------------------------------------------------------------------------------------
+// Runs a benchmark if one is requested on the command line:
+//   --bench-glb <file.obj> [runs]   compare loading the .obj and a .glb version of it
+//   --gen-corpus <dir> [max_triangles]   write the synthetic .obj corpus (default up to 1M triangles)
+//   --bench-scaling <dir> [max_triangles] [runs]   time the loader phases on the corpus, as CSV
+// Returns true if a benchmark was run and the program should exit.
+//--------------------------------------------------------------------------------------
+bool RunCommandLineBenchmark()
+{
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (!argv)
+		return false;
+
+	bool ran = false;
+	for (int i = 1; i + 1 < argc && !ran; i++)
+	{
+		const bool glb = wcscmp(argv[i], L"--bench-glb") == 0;
+		const bool corpus = wcscmp(argv[i], L"--gen-corpus") == 0;
+		const bool scaling = wcscmp(argv[i], L"--bench-scaling") == 0;
+		if (!glb && !corpus && !scaling)
+			continue;
+
+		char path[MAX_PATH] = { 0 };
+		WideCharToMultiByte(CP_ACP, 0, argv[i + 1], -1, path, MAX_PATH, nullptr, nullptr);
+		if (glb)
+		{
+			const int runs = i + 2 < argc ? _wtoi(argv[i + 2]) : 0;
+			BenchmarkGLB(path, runs > 0 ? runs : 5);
+		}
+		else
+		{
+			const long long triangles = i + 2 < argc ? _wtoi64(argv[i + 2]) : 0;
+			const size_t maxTriangles = triangles > 0 ? (size_t)triangles : 1000000;
+			const int runs = i + 3 < argc ? _wtoi(argv[i + 3]) : 0;
+			if (corpus)
+				GenerateMeshCorpus(path, maxTriangles);
+			else
+				BenchmarkScaling(path, maxTriangles, runs > 0 ? runs : 3);
+		}
+		ran = true;
+	}
+	LocalFree(argv);
+
+#ifdef USECONSOLE
+	if (ran)
+	{
+		printf("Press Enter to exit\n");
+		getchar();
+	}
+#endif
+	return ran;
+}
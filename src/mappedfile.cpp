@@ -0,0 +1,126 @@
+//
+//  Read-only memory mapped file
+//
+
+#include "mappedfile.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	HANDLE file = CreateFileA(
+		filename.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	m_file = file;
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size))
+	{
+		Close();
+		return false;
+	}
+
+	// Empty files can't be mapped, but are still valid
+	m_size = (size_t)size.QuadPart;
+	if (!m_size)
+		return true;
+
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping)
+	{
+		Close();
+		return false;
+	}
+
+	m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!m_data)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file)
+		CloseHandle(m_file);
+
+	m_data = nullptr;
+	m_size = 0;
+	m_file = nullptr;
+	m_mapping = nullptr;
+}
+
+#else
+
+// The descriptor is closed as soon as the file is mapped, the mapping keeps the file open
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	const int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// Empty files can't be mapped, but are still valid
+	m_size = (size_t)info.st_size;
+	if (!m_size)
+	{
+		close(fd);
+		return true;
+	}
+
+	void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		m_size = 0;
+		return false;
+	}
+	madvise(data, m_size, MADV_SEQUENTIAL);
+	m_data = (const char*)data;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_data)
+		munmap((void*)m_data, m_size);
+
+	m_data = nullptr;
+	m_size = 0;
+	m_file = nullptr;
+	m_mapping = nullptr;
+}
+
+#endif
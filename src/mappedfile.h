@@ -0,0 +1,59 @@
+/**
+ * @file mappedfile.h
+ * @brief Read-only memory mapped file
+*/
+
+#pragma once
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+
+/**
+ * @brief Maps a whole file into memory for reading.
+ * @details Uses file mappings on Windows and mmap() elsewhere.
+ * The mapping stays valid until Close() is called or the object is destroyed.
+ * The data is not null-terminated, use Size() to find the end.
+*/
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	 * @brief Unmaps the file.
+	*/
+	~MappedFile() { Close(); }
+
+	/**
+	 * @brief Opens and maps a file. Any previously mapped file is closed first.
+	 * @param[in] filename Path to the file.
+	 * @return True if the file was mapped, False otherwise.
+	*/
+	bool Open(const std::string& filename);
+
+	/**
+	 * @brief Unmaps the file and releases all handles.
+	*/
+	void Close();
+
+	/**
+	 * @brief Pointer to the first byte of the file, nullptr if the file is empty or not open.
+	*/
+	const char* Data() const { return m_data; }
+
+	/**
+	 * @brief Size of the file in bytes.
+	*/
+	size_t Size() const { return m_size; }
+
+private:
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+	void* m_file = nullptr; // file and mapping handles, Windows only
+	void* m_mapping = nullptr;
+};
+
+#endif
@@ -0,0 +1,128 @@
+//
+//  Global table of shared materials
+//
+
+#include <mutex>
+#include <vector>
+#include <cstring>
+#include <iterator>
+#include <algorithm>
+#include <unordered_map>
+#include "materialtable.h"
+
+// Materials in use by content hash, held weakly. Different materials with the same hash share a bucket.
+static std::mutex s_mutex;
+static std::unordered_map<uint64_t, std::vector<std::weak_ptr<SharedMaterial>>> s_materials;
+static size_t s_sweepAt = 64; // bucket count at which Acquire() next sweeps the table
+
+// Drops released materials and the buckets they leave empty, s_mutex must be held
+static void sweep()
+{
+	for (auto bucket = s_materials.begin(); bucket != s_materials.end(); )
+	{
+		std::vector<std::weak_ptr<SharedMaterial>>& entries = bucket->second;
+		for (size_t i = 0; i < entries.size(); )
+		{
+			if (entries[i].expired())
+			{
+				entries[i] = entries.back();
+				entries.pop_back();
+			}
+			else
+				i++;
+		}
+		bucket = entries.empty() ? s_materials.erase(bucket) : std::next(bucket);
+	}
+	s_sweepAt = (std::max)((size_t)64, 2 * s_materials.size());
+}
+
+// FNV-1a of the colours and texture files
+static uint64_t content_hash(const Material& material)
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&](const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+	};
+	auto mixString = [&](const std::string& str) { mix(str.c_str(), str.size() + 1); };
+
+	mix(&material.AmbientColour, sizeof(vec3f));
+	mix(&material.DiffuseColour, sizeof(vec3f));
+	mix(&material.SpecularColour, sizeof(vec3f));
+	mixString(material.DiffuseTextureFilename);
+	mixString(material.SpecularTextureFilename);
+	mixString(material.NormalTextureFilename);
+	return hash;
+}
+
+static bool same_content(const Material& a, const Material& b)
+{
+	return !memcmp(&a.AmbientColour, &b.AmbientColour, sizeof(vec3f)) &&
+		!memcmp(&a.DiffuseColour, &b.DiffuseColour, sizeof(vec3f)) &&
+		!memcmp(&a.SpecularColour, &b.SpecularColour, sizeof(vec3f)) &&
+		a.DiffuseTextureFilename == b.DiffuseTextureFilename &&
+		a.SpecularTextureFilename == b.SpecularTextureFilename &&
+		a.NormalTextureFilename == b.NormalTextureFilename;
+}
+
+SharedMaterial::SharedMaterial(const Material& material)
+	: Material(material)
+{
+	DiffuseTexture = Texture();
+	NormalTexture = Texture();
+}
+
+SharedMaterial::~SharedMaterial()
+{
+	SAFE_RELEASE(DiffuseTexture.TextureView);
+	SAFE_RELEASE(NormalTexture.TextureView);
+
+	// Release other used textures ...
+}
+
+MaterialHandle MaterialTable::Acquire(const Material& material)
+{
+	const uint64_t hash = content_hash(material);
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	// Buckets of hashes that are not acquired again are only found by a sweep, which runs
+	// whenever the table has doubled since the last one
+	if (s_materials.size() >= s_sweepAt)
+		sweep();
+	std::vector<std::weak_ptr<SharedMaterial>>& bucket = s_materials[hash];
+
+	MaterialHandle shared;
+	for (size_t i = 0; i < bucket.size(); )
+	{
+		MaterialHandle candidate = bucket[i].lock();
+		if (!candidate)
+		{
+			// released, drop the entry
+			bucket[i] = bucket.back();
+			bucket.pop_back();
+			continue;
+		}
+		if (!shared && same_content(*candidate, material))
+			shared = candidate;
+		i++;
+	}
+
+	if (!shared)
+	{
+		shared = std::make_shared<SharedMaterial>(material);
+		bucket.push_back(shared);
+	}
+	return shared;
+}
+
+size_t MaterialTable::Size()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	sweep();
+	size_t size = 0;
+	for (auto& bucket : s_materials)
+		size += bucket.second.size();
+	return size;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file materialtable.h
+ * @brief Global table of materials, shared by all meshes that use identical materials
+*/
+
+#pragma once
+#ifndef MATERIALTABLE_H
+#define MATERIALTABLE_H
+
+#include <memory>
+#include "Drawcall.h"
+
+//! Let meshes reference one shared copy (and one set of textures) of identical materials
+#define MESH_SHARE_MATERIALS
+
+/**
+ * @brief A material in the MaterialTable, together with its device textures.
+ * @details Releases the textures when the last mesh using it is released.
+*/
+struct SharedMaterial : Material
+{
+	bool TexturesRequested = false; //!< True once the textures have been loaded or requested, render thread only
+
+	/**
+	 * @brief Copies a material as read by a loader, without its device textures.
+	*/
+	explicit SharedMaterial(const Material& material);
+
+	/**
+	 * @brief Releases the textures.
+	*/
+	~SharedMaterial();
+
+	SharedMaterial(const SharedMaterial&) = delete;
+	SharedMaterial& operator=(const SharedMaterial&) = delete;
+};
+
+typedef std::shared_ptr<SharedMaterial> MaterialHandle; //!< Reference to a material in the MaterialTable
+
+/**
+ * @brief Deduplicates materials across all loaded meshes.
+ * @details Materials are keyed by a hash of their content: the colours and texture files.
+ * The name is not part of the content, so identical materials from different .mtl files
+ * (or under different names) are shared. Like the MeshAsset registry the table only holds
+ * weak references, a material is released with the last mesh using it. Entries of released
+ * materials are swept out as the table grows.
+*/
+class MaterialTable
+{
+public:
+	/**
+	 * @brief Returns the shared material with the same content, creating it if there is none.
+	 * @details Safe to call from several threads.
+	 * @param material Material from a loader.
+	 * @return Handle of the shared material.
+	*/
+	static MaterialHandle Acquire(const Material& material);
+
+	/**
+	 * @brief Number of distinct materials in use.
+	 * @details Also drops released materials and their empty buckets from the table.
+	*/
+	static size_t Size();
+};
+
+#endif
@@ -0,0 +1,62 @@
+//
+//  Registry of loaded mesh assets
+//
+
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <cctype>
+#include "meshasset.h"
+
+// Registry of assets in use, held weakly
+static std::mutex s_mutex;
+static std::unordered_map<std::string, std::weak_ptr<MeshAsset>> s_assets;
+
+// Full, lower case path used as the registry key
+static std::string asset_key(const std::string& filename)
+{
+	char fullPath[MAX_PATH];
+	DWORD length = GetFullPathNameA(filename.c_str(), MAX_PATH, fullPath, nullptr);
+	std::string key = (length && length < MAX_PATH) ? std::string(fullPath, length) : filename;
+	std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return key;
+}
+
+MeshAsset::~MeshAsset()
+{
+	ReleaseChunks();
+	SAFE_RELEASE(VertexBuffer);
+	SAFE_RELEASE(IndexBuffer);
+	SAFE_RELEASE(DecodeBuffer);
+	SAFE_RELEASE(FallbackDiffuseTexture.TextureView);
+	SAFE_RELEASE(FallbackNormalTexture.TextureView);
+
+	// material textures are released by the materials, together with the last mesh using them
+}
+
+void MeshAsset::ReleaseChunks()
+{
+	for (auto& chunk : Chunks)
+	{
+		SAFE_RELEASE(chunk.VertexBuffer);
+		SAFE_RELEASE(chunk.IndexBuffer);
+	}
+	std::vector<MeshChunk>().swap(Chunks);
+	SAFE_RELEASE(ChunkNormalTexture.TextureView);
+}
+
+std::shared_ptr<MeshAsset> MeshAsset::Acquire(const std::string& filename, bool& created)
+{
+	const std::string key = asset_key(filename);
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	std::weak_ptr<MeshAsset>& slot = s_assets[key];
+	std::shared_ptr<MeshAsset> asset = slot.lock();
+	created = !asset;
+	if (created)
+	{
+		asset.reset(new MeshAsset());
+		slot = asset;
+	}
+	return asset;
+}
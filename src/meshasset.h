@@ -0,0 +1,121 @@
+/**
+ * @file meshasset.h
+ * @brief GPU resources of a loaded mesh, shared between models loaded from the same file
+*/
+
+#pragma once
+#ifndef MESHASSET_H
+#define MESHASSET_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <atomic>
+#include "stdafx.h"
+#include "Drawcall.h"
+#include "loadreport.h"
+#include "materialtable.h"
+#include "meshlod.h"
+
+//! Let models loaded from the same file share one set of buffers, index ranges and textures
+#define MESH_SHARE_ASSETS
+
+/**
+ * @brief A drawcall uploaded on its own while the rest of its mesh is still loading.
+*/
+struct MeshChunk
+{
+	ID3D11Buffer* VertexBuffer = nullptr; //!< Vertices of the drawcall
+	ID3D11Buffer* IndexBuffer = nullptr; //!< Triangle list of the drawcall
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R32_UINT; //!< R16_UINT or R32_UINT
+	UINT IndexCount = 0; //!< Number of indices
+	vec4f Ambient, Diffuse, Specular; //!< Material colours, textures are not loaded yet
+};
+
+/**
+ * @brief Vertex and index buffers, index ranges and materials (with device textures) of a mesh.
+ * @details Owns its resources and releases them when destroyed. Assets are immutable once
+ * ready, apart from material textures loaded on first use with MESH_LAZY_TEXTURES.
+ * Everything that may differ between models using the same mesh (transform, cube
+ * map mode, ...) belongs in the model.
+*/
+struct MeshAsset
+{
+	ID3D11Buffer* VertexBuffer = nullptr; //!< Vertex buffer
+	ID3D11Buffer* IndexBuffer = nullptr; //!< Index buffer
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R32_UINT; //!< R16_UINT or R32_UINT
+	UINT VertexStride = sizeof(Vertex); //!< sizeof(Vertex), or sizeof(CompactVertex) with MESH_COMPACT_VERTICES
+	ID3D11Buffer* DecodeBuffer = nullptr; //!< CompactVertexDecode constants of the vertex buffer, with MESH_COMPACT_VERTICES
+	std::vector<IndexRange> IndexRanges; //!< Index ranges, one per drawcall
+	std::vector<MeshLod> Lods; //!< Levels of detail, drawn with the same buffers and materials as IndexRanges
+	vec4f Bounds = { 0.0f, 0.0f, 0.0f, 0.0f }; //!< Bounding sphere of the vertices, centre (xyz) and radius (w)
+	std::vector<MaterialHandle> Materials; //!< Materials referenced by IndexRanges, with MESH_SHARE_MATERIALS shared with other meshes
+	LoadReport Report; //!< Timings and sizes of the load
+
+	std::vector<MeshChunk> Chunks; //!< Drawcalls streamed in so far, rendered until the asset is ready
+	Texture ChunkNormalTexture; //!< Flat normal map used when rendering Chunks
+
+	// Bound while lazily loaded textures are on their way, see SharedMaterial::TexturesRequested
+	Texture FallbackDiffuseTexture; //!< White, bound until a requested diffuse texture has been uploaded
+	Texture FallbackNormalTexture; //!< Flat normal map, bound until a requested normal map has been uploaded
+
+	MeshAsset() = default;
+	MeshAsset(const MeshAsset&) = delete;
+	MeshAsset& operator=(const MeshAsset&) = delete;
+
+	/**
+	 * @brief Releases the buffers and textures.
+	*/
+	~MeshAsset();
+
+	/**
+	 * @brief Releases the streamed drawcalls, once the complete buffers are in place.
+	*/
+	void ReleaseChunks();
+
+	/**
+	 * @brief True once the buffers and textures have been created and the asset can be rendered.
+	 * @details False while the asset is loading and if its load failed, see IsFailed().
+	*/
+	bool IsReady() const { return m_state.load(std::memory_order_acquire) == Ready; }
+
+	/**
+	 * @brief True if the asset could not be loaded. It is never ready then, and is not rendered.
+	*/
+	bool IsFailed() const { return m_state.load(std::memory_order_acquire) == Failed; }
+
+	/**
+	 * @brief Publishes the asset to other users after it has been loaded.
+	*/
+	void SetReady() { m_state.store(Ready, std::memory_order_release); }
+
+	/**
+	 * @brief Tells other users that the asset will not be loaded, and releases the streamed drawcalls.
+	 * @details Call on the render thread, like ReleaseChunks().
+	*/
+	void SetFailed()
+	{
+		ReleaseChunks();
+		m_state.store(Failed, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Returns the shared asset for a file, creating an empty one if no one holds it.
+	 * @details Assets are keyed by full path, so different spellings of the same path
+	 * share the asset. The registry only keeps weak references: the asset is released
+	 * together with the last model using it, and created again if requested after that.
+	 * Safe to call from several threads. Exactly one caller gets created set and is
+	 * responsible for loading the asset (now or in the background) and calling SetReady(), or
+	 * SetFailed() if the load fails; everyone else shares the asset and renders it once it is ready.
+	 * @param[in] filename Path of the source file.
+	 * @param[out] created True if the asset is new and must be loaded by the caller.
+	 * @return The shared asset.
+	*/
+	static std::shared_ptr<MeshAsset> Acquire(const std::string& filename, bool& created);
+
+private:
+	enum State { Loading, Ready, Failed };
+	std::atomic<int> m_state{ Loading };
+};
+
+#endif
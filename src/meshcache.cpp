@@ -0,0 +1,343 @@
+//
+//  Binary cache for processed OBJ meshes
+//
+
+#include <algorithm>
+#include <fstream>
+#include "meshcache.h"
+#include "OBJLoader.h"
+#include "meshsplit.h"
+#include "meshoptimize.h"
+
+// Bump when the file layout or the Vertex struct changes
+static const uint32_t MeshCacheVersion = 3;
+static const char MeshCacheMagic[4] = { 'E', 'R', 'M', 'C' };
+
+// Loader settings that change the cached result
+static const uint32_t MeshCacheConfig = 0
+#ifdef MESH_FORCE_CCW
+	| 1
+#endif
+#ifdef MESH_SORT_DRAWCALLS
+	| 2
+#endif
+#ifdef MESH_MERGE_DRAWCALLS
+	| 4
+#endif
+#ifdef MESH_16BIT_INDICES
+	| 8
+#endif
+#ifdef MESH_SPLIT_FOR_16BIT_INDICES
+	| 16
+#endif
+#ifdef MESH_OPTIMIZE_VERTEX_CACHE
+	| 32
+#endif
+#ifdef MESH_OPTIMIZE_OVERDRAW
+	| 64
+#endif
+#ifdef MESH_OPTIMIZE_VERTEX_FETCH
+	| 128
+#endif
+#ifdef MESH_GENERATE_LODS
+	| 256
+#endif
+	;
+
+struct cache_header_t
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t config;
+	uint32_t vertex_size;
+	uint32_t index_size;
+
+	uint32_t source_count;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t range_count;
+	uint32_t lod_count;
+	uint32_t material_count;
+	uint32_t string_size;
+
+	uint64_t source_offset;
+	uint64_t vertex_offset;
+	uint64_t index_offset;
+	uint64_t range_offset;
+	uint64_t lod_offset;
+	uint64_t material_offset;
+	uint64_t string_offset;
+};
+
+struct cache_string_t { uint32_t offset, size; };
+
+struct cache_source_t
+{
+	cache_string_t path;
+	uint32_t pad;
+	uint64_t modified;
+	uint64_t size;
+};
+
+// A level of detail, its ranges follow those of the level before it in the range block
+struct cache_lod_t
+{
+	uint32_t range_count;
+	float error;
+};
+
+struct cache_material_t
+{
+	vec3f ambient, diffuse, specular;
+	cache_string_t name, diffuse_texture, specular_texture, normal_texture;
+};
+
+//
+// Last write time and size of a file
+//
+static bool get_file_stamp(const std::string& path, uint64_t& modified, uint64_t& size)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data))
+		return false;
+
+	modified = (uint64_t)data.ftLastWriteTime.dwHighDateTime << 32 | data.ftLastWriteTime.dwLowDateTime;
+	size = (uint64_t)data.nFileSizeHigh << 32 | data.nFileSizeLow;
+	return true;
+}
+
+static uint64_t align_up(uint64_t offset, uint64_t alignment)
+{
+	return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+bool MeshCache::Load(const std::string& source_file)
+{
+	if (!m_file.Open(source_file + MESH_CACHE_SUFFIX))
+		return false;
+
+	const char* data = m_file.Data();
+	const size_t size = m_file.Size();
+
+	cache_header_t header;
+	if (size < sizeof(header))
+		return false;
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, MeshCacheMagic, 4) ||
+		header.version != MeshCacheVersion ||
+		header.config != MeshCacheConfig ||
+		header.vertex_size != sizeof(Vertex) ||
+		(header.index_size != 2 && header.index_size != 4))
+		return false;
+
+	// every block has to be inside the file
+	auto inside = [size](uint64_t offset, uint64_t count, uint64_t element_size)
+	{
+		return offset <= size && count * element_size <= size - offset;
+	};
+	if (!inside(header.source_offset, header.source_count, sizeof(cache_source_t)) ||
+		!inside(header.vertex_offset, header.vertex_count, sizeof(Vertex)) ||
+		!inside(header.index_offset, header.index_count, header.index_size) ||
+		!inside(header.range_offset, header.range_count, sizeof(IndexRange)) ||
+		!inside(header.lod_offset, header.lod_count, sizeof(cache_lod_t)) ||
+		!inside(header.material_offset, header.material_count, sizeof(cache_material_t)) ||
+		!inside(header.string_offset, header.string_size, 1))
+		return false;
+
+	const char* strings = data + header.string_offset;
+	auto get_string = [&](const cache_string_t& s)
+	{
+		if ((uint64_t)s.offset + s.size > header.string_size)
+			throw std::runtime_error("Corrupt mesh cache string");
+		return std::string(strings + s.offset, s.size);
+	};
+
+	try
+	{
+		// all sources must be unchanged
+		const cache_source_t* sources = (const cache_source_t*)(data + header.source_offset);
+		for (uint32_t i = 0; i < header.source_count; i++)
+		{
+			uint64_t modified, file_size;
+			if (!get_file_stamp(get_string(sources[i].path), modified, file_size) ||
+				modified != sources[i].modified ||
+				file_size != sources[i].size)
+				return false;
+		}
+
+		const cache_material_t* materials = (const cache_material_t*)(data + header.material_offset);
+		Materials.resize(header.material_count);
+		for (uint32_t i = 0; i < header.material_count; i++)
+		{
+			Material& material = Materials[i];
+			material.AmbientColour = materials[i].ambient;
+			material.DiffuseColour = materials[i].diffuse;
+			material.SpecularColour = materials[i].specular;
+			material.Name = get_string(materials[i].name);
+			material.DiffuseTextureFilename = get_string(materials[i].diffuse_texture);
+			material.SpecularTextureFilename = get_string(materials[i].specular_texture);
+			material.NormalTextureFilename = get_string(materials[i].normal_texture);
+		}
+	}
+	catch (const std::runtime_error&)
+	{
+		return false;
+	}
+
+	// the mesh has the ranges that are left after the levels of detail
+	const cache_lod_t* lods = (const cache_lod_t*)(data + header.lod_offset);
+	uint64_t lodRanges = 0;
+	for (uint32_t i = 0; i < header.lod_count; i++)
+		lodRanges += lods[i].range_count;
+	if (lodRanges > header.range_count)
+		return false;
+
+	// ranges of the mesh and its levels of detail must stay inside the buffers and the materials
+	const char* indices = data + header.index_offset;
+	auto range_valid = [&](const IndexRange& range)
+	{
+		if ((uint64_t)range.Start + range.Size > header.index_count ||
+			range.MaterialIndex < -1 || range.MaterialIndex >= (int64_t)header.material_count)
+			return false;
+		uint32_t maxIndex = 0;
+		if (header.index_size == 2)
+		{
+			const uint16_t* first = (const uint16_t*)indices + range.Start;
+			for (const uint16_t* index = first; index < first + range.Size; index++)
+				maxIndex = (std::max)(maxIndex, (uint32_t)*index);
+		}
+		else
+		{
+			const uint32_t* first = (const uint32_t*)indices + range.Start;
+			for (const uint32_t* index = first; index < first + range.Size; index++)
+				maxIndex = (std::max)(maxIndex, *index);
+		}
+		return !range.Size || (uint64_t)maxIndex + range.Offset < header.vertex_count;
+	};
+
+	const IndexRange* ranges = (const IndexRange*)(data + header.range_offset);
+	for (uint32_t i = 0; i < header.range_count; i++)
+		if (!range_valid(ranges[i]))
+			return false;
+
+	const uint32_t meshRanges = header.range_count - (uint32_t)lodRanges;
+	IndexRanges.assign(ranges, ranges + meshRanges);
+	ranges += meshRanges;
+	Lods.resize(header.lod_count);
+	for (uint32_t i = 0; i < header.lod_count; i++)
+	{
+		Lods[i].IndexRanges.assign(ranges, ranges + lods[i].range_count);
+		Lods[i].Error = lods[i].error;
+		ranges += lods[i].range_count;
+	}
+
+	m_vertices = (const Vertex*)(data + header.vertex_offset);
+	m_vertex_count = header.vertex_count;
+	m_indices = indices;
+	m_index_count = header.index_count;
+	m_index_size = header.index_size;
+	return true;
+}
+
+bool MeshCache::Save(
+	const std::string& source_file,
+	const std::vector<std::string>& dependencies,
+	const Vertex* vertices,
+	size_t vertex_count,
+	const void* indices,
+	size_t index_count,
+	size_t index_size,
+	const std::vector<IndexRange>& ranges,
+	const std::vector<MeshLod>& lods,
+	const std::vector<Material>& materials)
+{
+	std::string strings;
+	auto add_string = [&strings](const std::string& s)
+	{
+		cache_string_t res = { (uint32_t)strings.size(), (uint32_t)s.size() };
+		strings += s;
+		return res;
+	};
+
+	std::vector<cache_source_t> sources;
+	for (auto& dependency : dependencies)
+	{
+		cache_source_t source{};
+		if (!get_file_stamp(dependency, source.modified, source.size))
+			return false;
+		source.path = add_string(dependency);
+		sources.push_back(source);
+	}
+
+	std::vector<cache_material_t> cache_materials;
+	for (auto& material : materials)
+	{
+		cache_material_t cm;
+		cm.ambient = material.AmbientColour;
+		cm.diffuse = material.DiffuseColour;
+		cm.specular = material.SpecularColour;
+		cm.name = add_string(material.Name);
+		cm.diffuse_texture = add_string(material.DiffuseTextureFilename);
+		cm.specular_texture = add_string(material.SpecularTextureFilename);
+		cm.normal_texture = add_string(material.NormalTextureFilename);
+		cache_materials.push_back(cm);
+	}
+
+	std::vector<IndexRange> allRanges = ranges;
+	std::vector<cache_lod_t> cache_lods;
+	for (auto& lod : lods)
+	{
+		allRanges.insert(allRanges.end(), lod.IndexRanges.begin(), lod.IndexRanges.end());
+		cache_lods.push_back({ (uint32_t)lod.IndexRanges.size(), lod.Error });
+	}
+
+	cache_header_t header{};
+	header.version = MeshCacheVersion;
+	header.config = MeshCacheConfig;
+	header.vertex_size = sizeof(Vertex);
+	header.index_size = (uint32_t)index_size;
+	header.source_count = (uint32_t)sources.size();
+	header.vertex_count = (uint32_t)vertex_count;
+	header.index_count = (uint32_t)index_count;
+	header.range_count = (uint32_t)allRanges.size();
+	header.lod_count = (uint32_t)cache_lods.size();
+	header.material_count = (uint32_t)cache_materials.size();
+	header.string_size = (uint32_t)strings.size();
+
+	// blocks are 16-byte aligned so the arrays can be used in place
+	header.source_offset = align_up(sizeof(header), 16);
+	header.vertex_offset = align_up(header.source_offset + sources.size() * sizeof(cache_source_t), 16);
+	header.index_offset = align_up(header.vertex_offset + vertex_count * sizeof(Vertex), 16);
+	header.range_offset = align_up(header.index_offset + index_count * index_size, 16);
+	header.lod_offset = align_up(header.range_offset + allRanges.size() * sizeof(IndexRange), 16);
+	header.material_offset = align_up(header.lod_offset + cache_lods.size() * sizeof(cache_lod_t), 16);
+	header.string_offset = align_up(header.material_offset + cache_materials.size() * sizeof(cache_material_t), 16);
+
+	std::ofstream out(source_file + MESH_CACHE_SUFFIX, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	auto write_at = [&out](uint64_t offset, const void* block, size_t size)
+	{
+		out.seekp((std::streamoff)offset);
+		out.write((const char*)block, (std::streamsize)size);
+	};
+
+	// The header is written last, with the magic, so an interrupted write leaves an invalid file
+	write_at(0, &header, sizeof(header));
+	write_at(header.source_offset, sources.data(), sources.size() * sizeof(cache_source_t));
+	write_at(header.vertex_offset, vertices, vertex_count * sizeof(Vertex));
+	write_at(header.index_offset, indices, index_count * index_size);
+	write_at(header.range_offset, allRanges.data(), allRanges.size() * sizeof(IndexRange));
+	write_at(header.lod_offset, cache_lods.data(), cache_lods.size() * sizeof(cache_lod_t));
+	write_at(header.material_offset, cache_materials.data(), cache_materials.size() * sizeof(cache_material_t));
+	write_at(header.string_offset, strings.data(), strings.size());
+	out.flush();
+
+	memcpy(header.magic, MeshCacheMagic, 4);
+	write_at(0, &header, sizeof(header));
+	out.close();
+
+	return (bool)out;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file meshcache.h
+ * @brief Binary cache for processed OBJ meshes
+*/
+
+#pragma once
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <vector>
+#include <string>
+#include "Drawcall.h"
+#include "mappedfile.h"
+#include "meshlod.h"
+
+//! Store processed models in a binary file next to the source (e.g. sponza.obj.erm) and load from it when the sources are unchanged
+#define MESH_BINARY_CACHE
+
+//! File suffix appended to the source path for cache files
+#define MESH_CACHE_SUFFIX ".erm"
+
+/**
+ * @brief Binary mesh cache file.
+ * @details The cache holds the final vertex array (with tangents), the index buffer,
+ * the index ranges, levels of detail and materials of a model, along with the modification time and
+ * size of every source file (.obj and .mtl) it was built from. The vertex and index
+ * arrays are used straight from the memory mapped file.
+ *
+ * Layout: header, source file records, vertices, indices, index ranges (of the
+ * mesh, then of each level of detail), level of detail records, material records
+ * and a string table. All offsets are from the start of the file.
+*/
+class MeshCache
+{
+public:
+	/**
+	 * @brief Maps the cache file for a source file and validates it.
+	 * @details Fails if the file is missing, was written by another format version or
+	 * build configuration, if any of the recorded source files has changed, or if an index
+	 * range (of the mesh or a level of detail) reaches outside the indices, vertices or materials.
+	 * @param[in] source_file Path of the .obj file, the cache is source_file + MESH_CACHE_SUFFIX.
+	 * @return True if the cache is valid and can be used.
+	*/
+	bool Load(const std::string& source_file);
+
+	/**
+	 * @brief Writes a cache file for a processed mesh.
+	 * @param[in] source_file Path of the .obj file.
+	 * @param[in] dependencies All files the mesh was built from, including source_file.
+	 * @param[in] vertices Final vertex array.
+	 * @param[in] vertex_count Number of vertices.
+	 * @param[in] indices Index buffer.
+	 * @param[in] index_count Number of indices.
+	 * @param[in] index_size Size of an index in bytes, 2 or 4.
+	 * @param[in] ranges Index ranges (drawcalls) within the index buffer.
+	 * @param[in] lods Levels of detail, their ranges are within the same index buffer.
+	 * @param[in] materials Materials referenced by the ranges.
+	 * @return True if the file was written.
+	*/
+	static bool Save(
+		const std::string& source_file,
+		const std::vector<std::string>& dependencies,
+		const Vertex* vertices,
+		size_t vertex_count,
+		const void* indices,
+		size_t index_count,
+		size_t index_size,
+		const std::vector<IndexRange>& ranges,
+		const std::vector<MeshLod>& lods,
+		const std::vector<Material>& materials);
+
+	const Vertex* Vertices() const { return m_vertices; } //!< Vertex array, points into the mapped file
+	size_t VertexCount() const { return m_vertex_count; } //!< Number of vertices
+	const void* Indices() const { return m_indices; } //!< Index buffer, points into the mapped file
+	size_t IndexCount() const { return m_index_count; } //!< Number of indices
+	size_t IndexSize() const { return m_index_size; } //!< Size of an index in bytes, 2 or 4
+
+	std::vector<IndexRange> IndexRanges; //!< Index ranges read from the cache
+	std::vector<MeshLod> Lods; //!< Levels of detail read from the cache
+	std::vector<Material> Materials; //!< Materials read from the cache, without device textures
+
+private:
+	MappedFile m_file;
+	const Vertex* m_vertices = nullptr;
+	size_t m_vertex_count = 0;
+	const void* m_indices = nullptr;
+	size_t m_index_count = 0;
+	size_t m_index_size = 0;
+};
+
+#endif
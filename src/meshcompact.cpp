@@ -0,0 +1,187 @@
+//
+//  Compact vertex format
+//
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "meshcompact.h"
+#include "threadpool.h"
+
+namespace {
+
+int16_t to_snorm16(float value)
+{
+	return (int16_t)std::lround((std::max)(-1.0f, (std::min)(1.0f, value)) * 32767.0f);
+}
+
+#ifdef MESH_QUANTIZE_POSITIONS
+uint16_t to_unorm16(float value)
+{
+	return (uint16_t)std::lround((std::max)(0.0f, (std::min)(65535.0f, value)));
+}
+#endif
+
+float from_snorm16(int16_t value)
+{
+	return (std::max)(-1.0f, value / 32767.0f);
+}
+
+//
+// Octahedral encoding of a direction, the zero vector encodes as +z
+//
+void oct_encode(const vec3f& v, int16_t* out)
+{
+	const float sum = std::fabs(v.x) + std::fabs(v.y) + std::fabs(v.z);
+	float x = sum > 0 ? v.x / sum : 0.0f;
+	float y = sum > 0 ? v.y / sum : 0.0f;
+	if (v.z < 0)
+	{
+		// Fold the lower hemisphere over the diagonals
+		const float fx = (1.0f - std::fabs(y)) * (x >= 0 ? 1.0f : -1.0f);
+		const float fy = (1.0f - std::fabs(x)) * (y >= 0 ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	out[0] = to_snorm16(x);
+	out[1] = to_snorm16(y);
+}
+
+vec3f oct_decode(const int16_t* in)
+{
+	vec3f v(from_snorm16(in[0]), from_snorm16(in[1]), 0.0f);
+	v.z = 1.0f - std::fabs(v.x) - std::fabs(v.y);
+	const float t = (std::max)(-v.z, 0.0f);
+	v.x += v.x >= 0 ? -t : t;
+	v.y += v.y >= 0 ? -t : t;
+	return linalg::normalize(v);
+}
+
+//
+// IEEE 754 half floats, rounded to nearest even
+//
+uint16_t to_half(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const uint32_t magnitude = bits & 0x7fffffff;
+
+	if (magnitude >= 0x7f800000)
+		return (uint16_t)(sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0)); // inf or nan
+	if (magnitude >= 0x477ff000)
+		return (uint16_t)(sign | 0x7c00); // rounds to more than 65504
+	if (magnitude < 0x38800000)
+	{
+		// Subnormal half, the implicit one is shifted in with the mantissa
+		if (magnitude < 0x33000000)
+			return (uint16_t)sign;
+		const uint32_t shift = 113 - (magnitude >> 23);
+		const uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+		uint32_t half = mantissa >> (shift + 13);
+		const uint32_t rest = mantissa & ((1u << (shift + 13)) - 1);
+		const uint32_t halfway = 1u << (shift + 12);
+		if (rest > halfway || (rest == halfway && (half & 1)))
+			half++;
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t half = (magnitude - 0x38000000) >> 13;
+	const uint32_t rest = magnitude & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++;
+	return (uint16_t)(sign | half);
+}
+
+float from_half(uint16_t half)
+{
+	const uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1f;
+	const uint32_t mantissa = half & 0x3ff;
+
+	if (!exponent)
+	{
+		const float value = mantissa * (1.0f / (1 << 24));
+		return sign ? -value : value;
+	}
+	const uint32_t bits = sign | (exponent == 31 ? 0x7f800000 | (mantissa << 13) : ((exponent + 112) << 23) | (mantissa << 13));
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+} // namespace
+
+CompactVertexDecode CompressVertices(const Vertex* vertices, size_t vertex_count, CompactVertex* output)
+{
+	CompactVertexDecode decode;
+	const size_t BlockSize = 1 << 14;
+	const size_t blocks = (vertex_count + BlockSize - 1) / BlockSize;
+
+#ifdef MESH_QUANTIZE_POSITIONS
+	// 65535 steps across the bounding box on each axis, UNORM reads them back as [0, 1]
+	vec3f lo = vertex_count ? vertices[0].Position : vec3f_zero;
+	vec3f hi = lo;
+	for (size_t i = 1; i < vertex_count; i++)
+	{
+		const vec3f& p = vertices[i].Position;
+		lo = vec3f((std::min)(lo.x, p.x), (std::min)(lo.y, p.y), (std::min)(lo.z, p.z));
+		hi = vec3f((std::max)(hi.x, p.x), (std::max)(hi.y, p.y), (std::max)(hi.z, p.z));
+	}
+	const vec3f extent = hi - lo;
+	const vec3f scale(extent.x > 0 ? 65535.0f / extent.x : 0.0f, extent.y > 0 ? 65535.0f / extent.y : 0.0f, extent.z > 0 ? 65535.0f / extent.z : 0.0f);
+	decode.PositionScale = vec4f(extent.x, extent.y, extent.z, 2.0f);
+	decode.PositionOffset = vec4f(lo.x, lo.y, lo.z, -1.0f);
+#endif
+
+	ThreadPool::Global().ParallelFor(blocks, [&](size_t block)
+	{
+		const size_t last = (std::min)(vertex_count, (block + 1) * BlockSize);
+		for (size_t i = block * BlockSize; i < last; i++)
+		{
+			const Vertex& v = vertices[i];
+			CompactVertex& c = output[i];
+			const bool rightHanded = dot(v.Normal % v.Tangent, v.Binormal) >= 0;
+
+#ifdef MESH_QUANTIZE_POSITIONS
+			const vec3f q = v.Position - lo;
+			c.Position[0] = to_unorm16(q.x * scale.x);
+			c.Position[1] = to_unorm16(q.y * scale.y);
+			c.Position[2] = to_unorm16(q.z * scale.z);
+			c.Position[3] = rightHanded ? 65535 : 0;
+#else
+			c.Position[0] = v.Position.x;
+			c.Position[1] = v.Position.y;
+			c.Position[2] = v.Position.z;
+			c.Position[3] = rightHanded ? 1.0f : -1.0f;
+#endif
+			oct_encode(v.Normal, c.Frame);
+			oct_encode(v.Tangent, c.Frame + 2);
+			c.TexCoord[0] = to_half(v.TexCoord.x);
+			c.TexCoord[1] = to_half(v.TexCoord.y);
+		}
+	});
+	return decode;
+}
+
+Vertex DecompressVertex(const CompactVertex& vertex, const CompactVertexDecode& decode)
+{
+#ifdef MESH_QUANTIZE_POSITIONS
+	const float unorm = 1.0f / 65535.0f;
+	const vec4f position(vertex.Position[0] * unorm, vertex.Position[1] * unorm, vertex.Position[2] * unorm, vertex.Position[3] * unorm);
+#else
+	const vec4f position(vertex.Position[0], vertex.Position[1], vertex.Position[2], vertex.Position[3]);
+#endif
+	const float handedness = position.w * decode.PositionScale.w + decode.PositionOffset.w;
+
+	Vertex v;
+	v.Position = vec3f(
+		position.x * decode.PositionScale.x + decode.PositionOffset.x,
+		position.y * decode.PositionScale.y + decode.PositionOffset.y,
+		position.z * decode.PositionScale.z + decode.PositionOffset.z);
+	v.Normal = oct_decode(vertex.Frame);
+	v.Tangent = oct_decode(vertex.Frame + 2);
+	v.Binormal = (v.Normal % v.Tangent) * handedness;
+	v.TexCoord = vec2f(from_half(vertex.TexCoord[0]), from_half(vertex.TexCoord[1]));
+	return v;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file meshcompact.h
+ * @brief Compact vertex format for vertex buffers, decoded by VS_compact in vertex_shader.hlsl
+*/
+
+#pragma once
+#ifndef MESHCOMPACT_H
+#define MESHCOMPACT_H
+
+#include <cstddef>
+#include <cstdint>
+#include "drawcall.h"
+
+//! Upload OBJModel vertex buffers as CompactVertex instead of Vertex
+#define MESH_COMPACT_VERTICES
+
+//! Store CompactVertex positions as 16-bit fixed point within the bounding box of the mesh (opt-in, large meshes lose precision)
+//#define MESH_QUANTIZE_POSITIONS
+
+/**
+ * @brief Vertex with a compressed tangent frame and texture coordinates.
+ * @details 20 bytes with MESH_QUANTIZE_POSITIONS, 28 bytes without, instead of the 56 of Vertex.
+ * The normal and tangent are octahedral encoded (Cigolle et al., "A Survey of Efficient
+ * Representations for Independent Unit Vectors") and the binormal is rebuilt from them and
+ * the handedness of the frame. The input layout is created in main.cpp.
+*/
+struct CompactVertex
+{
+#ifdef MESH_QUANTIZE_POSITIONS
+	uint16_t Position[4]; //!< Position within the bounds (R16G16B16A16_UNORM), w is the handedness (0 for -1, 65535 for +1)
+#else
+	float Position[4]; //!< Position (R32G32B32A32_FLOAT), w is the handedness (-1 or +1)
+#endif
+	int16_t Frame[4]; //!< Octahedral normal (xy) and tangent (zw) (R16G16B16A16_SNORM)
+	uint16_t TexCoord[2]; //!< Texture coordinate (R16G16_FLOAT)
+};
+
+//! Size of a vertex in the vertex buffers OBJModel uploads, the stride vertex fetch is optimized for
+#ifdef MESH_COMPACT_VERTICES
+const size_t UploadVertexSize = sizeof(CompactVertex);
+#else
+const size_t UploadVertexSize = sizeof(Vertex);
+#endif
+
+/**
+ * @brief Constants that turn CompactVertex::Position into the position and handedness.
+ * @details position = Position * PositionScale + PositionOffset, after the input assembler has
+ * converted Position to float. Bound as a constant buffer of VS_compact.
+*/
+struct CompactVertexDecode
+{
+	vec4f PositionScale = { 1.0f, 1.0f, 1.0f, 1.0f }; //!< Scale of the decoded Position
+	vec4f PositionOffset = { 0.0f, 0.0f, 0.0f, 0.0f }; //!< Offset of the decoded Position
+};
+
+/**
+ * @brief Encodes vertices as CompactVertex.
+ * @details The handedness is the sign of dot(Normal x Tangent, Binormal). Runs in parallel on
+ * ThreadPool::Global().
+ * @param vertices Vertices to encode.
+ * @param vertex_count Number of vertices.
+ * @param[out] output Array of vertex_count compact vertices.
+ * @return The decode constants of the vertices.
+*/
+CompactVertexDecode CompressVertices(const Vertex* vertices, size_t vertex_count, CompactVertex* output);
+
+/**
+ * @brief Decodes a compact vertex on the CPU, as VS_compact does.
+ * @param vertex Encoded vertex.
+ * @param decode Decode constants returned by CompressVertices().
+ * @return The vertex, with a unit normal, tangent and binormal.
+*/
+Vertex DecompressVertex(const CompactVertex& vertex, const CompactVertexDecode& decode);
+
+#endif
@@ -0,0 +1,399 @@
+//
+//  Generator of synthetic .obj files for load benchmarks
+//
+
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+#include "meshgen.h"
+
+namespace {
+
+const float RippleHeight = 0.05f;
+const float RippleFrequency = 8.0f;
+
+//
+// Buffered writer with fixed-format number output, so files are the same on every run
+//
+class obj_writer_t
+{
+public:
+	explicit obj_writer_t(std::ostream& out) : m_out(out) { m_buffer.reserve(BufferSize + 256); }
+	~obj_writer_t() { Flush(); }
+
+	bool Flush()
+	{
+		if (!m_buffer.empty())
+			m_out.write(m_buffer.data(), m_buffer.size());
+		m_buffer.clear();
+		return !m_out.fail();
+	}
+
+	void Text(const char* text)
+	{
+		while (*text)
+			m_buffer.push_back(*text++);
+	}
+
+	void Char(char c) { m_buffer.push_back(c); }
+
+	void Uint(uint64_t value)
+	{
+		char digits[24];
+		int n = 0;
+		do
+		{
+			digits[n++] = char('0' + value % 10);
+			value /= 10;
+		} while (value);
+		while (n)
+			m_buffer.push_back(digits[--n]);
+	}
+
+	// Six decimals, trailing zeros removed
+	void Float(float value)
+	{
+		if (value < 0)
+		{
+			m_buffer.push_back('-');
+			value = -value;
+		}
+		const uint64_t scaled = (uint64_t)std::llround((double)value * 1000000.0);
+		Uint(scaled / 1000000);
+		uint64_t fraction = scaled % 1000000;
+		if (!fraction)
+			return;
+		m_buffer.push_back('.');
+		int digits = 6;
+		while (fraction % 10 == 0)
+		{
+			fraction /= 10;
+			digits--;
+		}
+		char text[6];
+		for (int i = digits - 1; i >= 0; i--, fraction /= 10)
+			text[i] = char('0' + fraction % 10);
+		m_buffer.insert(m_buffer.end(), text, text + digits);
+	}
+
+	// Ends a line, flushing the buffer when it is full
+	void EndLine()
+	{
+		m_buffer.push_back('\n');
+		if (m_buffer.size() >= BufferSize)
+			Flush();
+	}
+
+private:
+	static const size_t BufferSize = 1 << 20;
+
+	std::ostream& m_out;
+	std::vector<char> m_buffer;
+};
+
+//
+// Layout of the grid and its patches
+//
+struct grid_t
+{
+	uint64_t width, height; // quads
+	uint64_t patch; // quads per side of a patch
+	uint64_t patchesX, patchesY;
+
+	explicit grid_t(const MeshGenParams& params)
+	{
+		const uint64_t quads = (std::max)((uint64_t)1, ((uint64_t)params.Triangles + 1) / 2);
+		width = (uint64_t)std::ceil(std::sqrt((double)quads));
+		height = (quads + width - 1) / width;
+		patch = params.PatchSize ? params.PatchSize : (std::max)(width, height);
+		patchesX = (width + patch - 1) / patch;
+		patchesY = (height + patch - 1) / patch;
+	}
+
+	// Quads per side of patch column px or row py, only the last may be smaller
+	uint64_t PatchWidth(uint64_t px) const { return (std::min)(patch, width - px * patch); }
+	uint64_t PatchHeight(uint64_t py) const { return (std::min)(patch, height - py * patch); }
+
+	// 1-based index of grid corner (x, y) in patch (px, py). All rows of patches but the last
+	// are full height and all patches in a row but the last are full width, so the vertices
+	// before a patch can be counted without storing a table of patch offsets.
+	uint64_t Vertex(uint64_t px, uint64_t py, uint64_t x, uint64_t y) const
+	{
+		const uint64_t rowStart = py * (patch + 1) * (width + patchesX);
+		const uint64_t patchStart = rowStart + px * (patch + 1) * (PatchHeight(py) + 1);
+		return patchStart + (y - py * patch) * (PatchWidth(px) + 1) + (x - px * patch) + 1;
+	}
+
+	// Calls corner(x, y) for every vertex, in file order
+	template<class Corner>
+	void ForEachVertex(const Corner& corner) const
+	{
+		for (uint64_t py = 0; py < patchesY; py++)
+			for (uint64_t px = 0; px < patchesX; px++)
+				for (uint64_t y = py * patch; y <= py * patch + PatchHeight(py); y++)
+					for (uint64_t x = px * patch; x <= px * patch + PatchWidth(px); x++)
+						corner(x, y);
+	}
+};
+
+bool file_exists(const std::string& filename)
+{
+	return std::ifstream(filename, std::ios::binary).is_open();
+}
+
+bool write_mtl(const std::string& filename, unsigned materials)
+{
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	obj_writer_t out(file);
+	for (unsigned i = 0; i < materials; i++)
+	{
+		// Spread the diffuse colours around the hue circle
+		const float hue = 6.2831853f * i / materials;
+		out.Text("newmtl mat"); out.Uint(i); out.EndLine();
+		out.Text("Ka 0 0 0"); out.EndLine();
+		out.Text("Kd ");
+		out.Float(0.5f + 0.4f * std::cos(hue)); out.Char(' ');
+		out.Float(0.5f + 0.4f * std::cos(hue - 2.0943951f)); out.Char(' ');
+		out.Float(0.5f + 0.4f * std::cos(hue + 2.0943951f)); out.EndLine();
+		out.Text("Ks 0.2 0.2 0.2"); out.EndLine();
+		out.Text("Ns 32"); out.EndLine();
+		out.EndLine();
+	}
+	return out.Flush();
+}
+
+std::string directory_of(const std::string& filename)
+{
+	const size_t slash = filename.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : filename.substr(0, slash + 1);
+}
+
+} // namespace
+
+std::string MeshGenName(const MeshGenParams& params)
+{
+	char name[128];
+	snprintf(name, sizeof(name), "t%zu_%s%s%s_m%u_g%u_p%u",
+		params.Triangles,
+		params.Quads ? "quad" : "tri",
+		params.Normals ? "_n" : "",
+		params.Texcoords ? "_uv" : "",
+		(std::max)(params.Materials, 1u),
+		(std::max)(params.Groups, 1u),
+		params.PatchSize);
+	std::string result = name;
+	if (params.Texcoords && params.UvIslandSize)
+	{
+		snprintf(name, sizeof(name), "_s%u", params.UvIslandSize);
+		result += name;
+	}
+	return result + ".obj";
+}
+
+bool GenerateMesh(const std::string& objfile, const MeshGenParams& params)
+{
+	const grid_t grid(params);
+
+	// Texture coordinates are laid out like positions, with islands in place of patches
+	MeshGenParams islands = params;
+	islands.PatchSize = params.UvIslandSize;
+	const grid_t uvGrid(islands);
+	const bool seams = params.Texcoords && params.UvIslandSize;
+	const unsigned materials = (std::max)(params.Materials, 1u);
+	const unsigned groups = (std::max)(params.Groups, 1u);
+
+	char mtlname[32];
+	snprintf(mtlname, sizeof(mtlname), "mat%u.mtl", materials);
+	const std::string mtlfile = directory_of(objfile) + mtlname;
+	if (!file_exists(mtlfile) && !write_mtl(mtlfile, materials))
+		return false;
+
+	std::ofstream file(objfile, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	obj_writer_t out(file);
+	out.Text("# "); out.Text(MeshGenName(params).c_str()); out.EndLine();
+	out.Text("mtllib "); out.Text(mtlname); out.EndLine();
+
+	// Rippled grid spanning x in [-1, 1], with z running from +aspect to -aspect along the rows
+	// so that the faces below are counter-clockwise seen from above
+	const float aspect = (float)grid.height / grid.width;
+	auto position = [&](uint64_t x, uint64_t y, float& px, float& pz)
+	{
+		px = 2.0f * x / grid.width - 1.0f;
+		pz = aspect * (1.0f - 2.0f * y / grid.height);
+	};
+
+	grid.ForEachVertex([&](uint64_t x, uint64_t y)
+	{
+		float px, pz;
+		position(x, y, px, pz);
+		out.Text("v "); out.Float(px);
+		out.Char(' '); out.Float(RippleHeight * std::sin(RippleFrequency * px) * std::cos(RippleFrequency * pz));
+		out.Char(' '); out.Float(pz);
+		out.EndLine();
+	});
+	if (params.Texcoords)
+	{
+		(seams ? uvGrid : grid).ForEachVertex([&](uint64_t x, uint64_t y)
+		{
+			out.Text("vt "); out.Float((float)x / grid.width);
+			out.Char(' '); out.Float((float)y / grid.height);
+			out.EndLine();
+		});
+	}
+	if (params.Normals)
+	{
+		grid.ForEachVertex([&](uint64_t x, uint64_t y)
+		{
+			float px, pz;
+			position(x, y, px, pz);
+			const float k = RippleHeight * RippleFrequency;
+			const float dx = k * std::cos(RippleFrequency * px) * std::cos(RippleFrequency * pz);
+			const float dz = -k * std::sin(RippleFrequency * px) * std::sin(RippleFrequency * pz);
+			const float scale = 1.0f / std::sqrt(dx * dx + 1.0f + dz * dz);
+			out.Text("vn "); out.Float(-dx * scale);
+			out.Char(' '); out.Float(scale);
+			out.Char(' '); out.Float(-dz * scale);
+			out.EndLine();
+		});
+	}
+
+	// Positions, uvs and normals are written in the same order, so without texture islands
+	// a corner uses one index for all
+	auto corner = [&](uint64_t index, uint64_t uv_index)
+	{
+		out.Char(' ');
+		out.Uint(index);
+		if (params.Texcoords || params.Normals)
+		{
+			out.Char('/');
+			if (params.Texcoords)
+				out.Uint(seams ? uv_index : index);
+			if (params.Normals)
+			{
+				out.Char('/');
+				out.Uint(index);
+			}
+		}
+	};
+
+	unsigned group = ~0u, material = ~0u;
+	for (uint64_t y = 0; y < grid.height; y++)
+	{
+		const unsigned rowGroup = (unsigned)(y * groups / grid.height);
+		const unsigned rowMaterial = (unsigned)(y * materials / grid.height);
+		if (rowGroup != group)
+		{
+			out.Text("g group"); out.Uint(rowGroup); out.EndLine();
+			material = ~0u;
+		}
+		if (rowMaterial != material)
+		{
+			out.Text("usemtl mat"); out.Uint(rowMaterial); out.EndLine();
+		}
+		group = rowGroup;
+		material = rowMaterial;
+
+		const uint64_t py = y / grid.patch;
+		const uint64_t uy = y / uvGrid.patch;
+		for (uint64_t x = 0; x < grid.width; x++)
+		{
+			const uint64_t px = x / grid.patch;
+			const uint64_t i00 = grid.Vertex(px, py, x, y);
+			const uint64_t i10 = grid.Vertex(px, py, x + 1, y);
+			const uint64_t i01 = grid.Vertex(px, py, x, y + 1);
+			const uint64_t i11 = grid.Vertex(px, py, x + 1, y + 1);
+			const uint64_t ux = x / uvGrid.patch;
+			const uint64_t t00 = uvGrid.Vertex(ux, uy, x, y);
+			const uint64_t t10 = uvGrid.Vertex(ux, uy, x + 1, y);
+			const uint64_t t01 = uvGrid.Vertex(ux, uy, x, y + 1);
+			const uint64_t t11 = uvGrid.Vertex(ux, uy, x + 1, y + 1);
+			if (params.Quads)
+			{
+				out.Char('f'); corner(i00, t00); corner(i10, t10); corner(i11, t11); corner(i01, t01); out.EndLine();
+			}
+			else
+			{
+				out.Char('f'); corner(i00, t00); corner(i10, t10); corner(i11, t11); out.EndLine();
+				out.Char('f'); corner(i00, t00); corner(i11, t11); corner(i01, t01); out.EndLine();
+			}
+		}
+	}
+
+	if (out.Flush())
+		return true;
+	file.close();
+	remove(objfile.c_str());
+	return false;
+}
+
+std::vector<MeshGenParams> MeshGenCorpus(size_t max_triangles)
+{
+	static const size_t sizes[] = { 1000, 10000, 100000, 1000000, 10000000, 50000000 };
+
+	// Each variant changes one parameter of the baseline
+	std::vector<MeshGenParams> variants(9);
+	variants[1].Normals = false;
+	variants[2].Texcoords = false;
+	variants[3].Quads = true;
+	variants[4].Materials = 16;
+	variants[5].Groups = 256;
+	variants[6].PatchSize = 8;
+	variants[7].PatchSize = 1;
+	variants[8].UvIslandSize = 1;
+
+	std::vector<MeshGenParams> corpus;
+	for (auto& variant : variants)
+	{
+		for (size_t size : sizes)
+		{
+			if (size > max_triangles)
+				break;
+			corpus.push_back(variant);
+			corpus.back().Triangles = size;
+		}
+	}
+	return corpus;
+}
+
+bool GenerateMeshCorpus(const std::string& directory, size_t max_triangles, std::vector<std::string>* files)
+{
+	std::string path = directory;
+	if (!path.empty() && path.back() != '/' && path.back() != '\\')
+		path += '/';
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+
+	for (auto& params : MeshGenCorpus(max_triangles))
+	{
+		const std::string objfile = path + MeshGenName(params);
+		if (!file_exists(objfile))
+		{
+			printf("Generating %s\n", objfile.c_str());
+			if (!GenerateMesh(objfile, params))
+			{
+				printf("Failed to write %s\n", objfile.c_str());
+				return false;
+			}
+		}
+		if (files)
+			files->push_back(objfile);
+	}
+	return true;
+}
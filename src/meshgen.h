@@ -0,0 +1,78 @@
+/**
+ * @file meshgen.h
+ * @brief Generator of synthetic .obj files for load benchmarks
+*/
+
+#pragma once
+#ifndef MESHGEN_H
+#define MESHGEN_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Shape and contents of a generated mesh.
+ * @details The mesh is a rippled grid of quads in the xz-plane, roughly square. The file
+ * contents depend only on these parameters, so a corpus generated twice is byte identical.
+*/
+struct MeshGenParams
+{
+	size_t Triangles = 100000; //!< Triangles after triangulation, rounded up to fill the last grid row
+	bool Normals = true; //!< Write vn, otherwise the loader has to generate them
+	bool Texcoords = true; //!< Write vt
+	bool Quads = false; //!< Write quads instead of triangle pairs
+	unsigned Materials = 1; //!< Materials, used by consecutive bands of grid rows
+	unsigned Groups = 1; //!< Groups (g), also bands of rows, each restarting its material
+	/**
+	 * Quads per side of the patches the grid is built from. Each patch has its own vertices, so
+	 * 1 gives every quad separate corners (a soup, each position referenced by 1-2 triangles) and
+	 * 0 makes the whole grid one patch (each position referenced by up to 6 triangles).
+	*/
+	unsigned PatchSize = 0;
+	/**
+	 * Quads per side of the texture islands, within which texture coordinates are shared. Positions
+	 * on the border of an island get one texture coordinate per island, so 1 gives every quad its
+	 * own (up to 4 per position, heavy UV seams as in a flattened atlas) and 0 makes the whole
+	 * grid one island. Needs Texcoords.
+	*/
+	unsigned UvIslandSize = 0;
+};
+
+/**
+ * @brief File name describing the parameters, e.g. "t100000_tri_n_uv_m1_g1_p0.obj".
+ * @details Texture islands add their size, e.g. "t100000_tri_n_uv_m1_g1_p0_s1.obj".
+ * @param params Mesh parameters.
+*/
+std::string MeshGenName(const MeshGenParams& params);
+
+/**
+ * @brief Writes a generated mesh.
+ * @details With more than one material, the .mtl file "mat<N>.mtl" is written next to the
+ * .obj file (if it does not exist yet), with untextured materials named mat0, mat1, ...
+ * @param objfile Path of the .obj file to write.
+ * @param params Mesh parameters.
+ * @return False if a file could not be written.
+*/
+bool GenerateMesh(const std::string& objfile, const MeshGenParams& params);
+
+/**
+ * @brief Parameter sets of the benchmark corpus.
+ * @details For each size from 1K to 50M triangles up to max_triangles, a baseline mesh
+ * (triangles with normals and uvs, one material and group, fully shared vertices) and variants
+ * changing one parameter each: no normals, no uvs, quads, 16 materials, 256 groups, 8x8 patches,
+ * unshared quads and a UV seam on every quad edge. The entries of one variant are in order of size.
+ * @param max_triangles Largest mesh size to include.
+*/
+std::vector<MeshGenParams> MeshGenCorpus(size_t max_triangles);
+
+/**
+ * @brief Generates the benchmark corpus into a directory.
+ * @details Files that already exist are not written again.
+ * @param directory Output directory, created if it does not exist.
+ * @param max_triangles Largest mesh size to include, see MeshGenCorpus().
+ * @param[out] files If not nullptr, receives the paths of the .obj files in corpus order.
+ * @return False if a file could not be written.
+*/
+bool GenerateMeshCorpus(const std::string& directory, size_t max_triangles, std::vector<std::string>* files = nullptr);
+
+#endif
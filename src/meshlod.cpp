@@ -0,0 +1,612 @@
+//
+//  Levels of detail by quadric error mesh simplification
+//
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "meshlod.h"
+#include "meshoptimize.h"
+#include "threadpool.h"
+#include "arena.h"
+
+namespace {
+
+// Kinds of vertices, see classify_vertices()
+const unsigned char KindManifold = 0;
+const unsigned char KindBorder = 1;
+const unsigned char KindLocked = 2;
+
+// Weight of the quadrics that keep open borders in place, relative to the surface
+const float BorderWeight = 10.0f;
+
+// Smallest cosine between a triangle's normal before and after a collapse
+const float FlipThreshold = 0.25f;
+
+// Passes of collapses a simplification makes at most
+const unsigned MaxPasses = 100;
+
+//
+// Symmetric 4x4 matrix of a sum of squared distances to planes, with the weight of the planes
+//
+struct quadric_t
+{
+	float a00, a11, a22, a10, a20, a21;
+	float b0, b1, b2, c;
+	float w;
+
+	void add_plane(const vec3f& n, float d, float weight)
+	{
+		a00 += weight * n.x * n.x;
+		a11 += weight * n.y * n.y;
+		a22 += weight * n.z * n.z;
+		a10 += weight * n.y * n.x;
+		a20 += weight * n.z * n.x;
+		a21 += weight * n.z * n.y;
+		b0 += weight * n.x * d;
+		b1 += weight * n.y * d;
+		b2 += weight * n.z * d;
+		c += weight * d * d;
+		w += weight;
+	}
+
+	void add(const quadric_t& q)
+	{
+		a00 += q.a00; a11 += q.a11; a22 += q.a22;
+		a10 += q.a10; a20 += q.a20; a21 += q.a21;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		w += q.w;
+	}
+
+	// Mean squared distance of p to the planes
+	float error(const vec3f& p) const
+	{
+		const float rx = a00 * p.x + a10 * p.y + a20 * p.z + 2 * b0;
+		const float ry = a10 * p.x + a11 * p.y + a21 * p.z + 2 * b1;
+		const float rz = a20 * p.x + a21 * p.y + a22 * p.z + 2 * b2;
+		const float e = rx * p.x + ry * p.y + rz * p.z + c;
+		return w > 0 ? (std::max)(0.0f, e / w) : 0.0f;
+	}
+};
+
+struct collapse_t
+{
+	unsigned from;
+	unsigned to;
+	float error;
+};
+
+//
+// Vertex to triangle adjacency, in compressed rows
+//
+struct adjacency_t
+{
+	ArenaVector<unsigned> offsets;
+	ArenaVector<unsigned> triangles;
+
+	adjacency_t(size_t vertex_count, size_t triangle_count, LoadArena& arena)
+		: offsets(vertex_count + 1, 0u, &arena), triangles(triangle_count * 3, 0u, &arena)
+	{
+	}
+
+	void build(const unsigned* tris, size_t triangle_count)
+	{
+		std::fill(offsets.begin(), offsets.end(), 0u);
+		for (size_t i = 0; i < triangle_count * 3; i++)
+			offsets[tris[i] + 1]++;
+		for (size_t v = 1; v < offsets.size(); v++)
+			offsets[v] += offsets[v - 1];
+		for (size_t t = 0; t < triangle_count; t++)
+			for (int k = 0; k < 3; k++)
+				triangles[offsets[tris[t * 3 + k]]++] = (unsigned)t;
+		// Filling moved each offset to the start of the next row
+		for (size_t v = offsets.size() - 1; v > 0; v--)
+			offsets[v] = offsets[v - 1];
+		offsets[0] = 0;
+	}
+
+	const unsigned* begin(unsigned v) const { return triangles.data() + offsets[v]; }
+	const unsigned* end(unsigned v) const { return triangles.data() + offsets[v + 1]; }
+};
+
+//
+// Counts the triangles around a that have the directed edge from -> to
+//
+unsigned count_edge(const adjacency_t& adjacency, const unsigned* tris, unsigned a, unsigned from, unsigned to)
+{
+	unsigned count = 0;
+	for (const unsigned* t = adjacency.begin(a); t != adjacency.end(a); t++)
+	{
+		const unsigned* tri = tris + *t * 3;
+		for (int k = 0; k < 3; k++)
+			count += tri[k] == from && tri[(k + 1) % 3] == to;
+	}
+	return count;
+}
+
+//
+// Finds open border and non-manifold vertices. Vertices on exactly one open loop
+// may slide along it, all others on open or non-manifold edges are locked.
+//
+void classify_vertices(const adjacency_t& adjacency, const unsigned* tris, ArenaVector<unsigned char>& kinds, LoadArena& arena)
+{
+	// Each triangle around a vertex has an edge leaving it and an edge coming back to it
+	ArenaVector<unsigned> leaving(&arena), returning(&arena);
+	for (unsigned v = 0; v < (unsigned)kinds.size(); v++)
+	{
+		leaving.clear();
+		returning.clear();
+		for (const unsigned* t = adjacency.begin(v); t != adjacency.end(v); t++)
+		{
+			const unsigned* tri = tris + *t * 3;
+			const int k = tri[0] == v ? 0 : tri[1] == v ? 1 : 2;
+			leaving.push_back(tri[(k + 1) % 3]);
+			returning.push_back(tri[(k + 2) % 3]);
+		}
+
+		// An edge is open if no other triangle has it the other way round
+		unsigned openEdges = 0;
+		bool manifold = true;
+		for (size_t i = 0; i < leaving.size(); i++)
+		{
+			const unsigned next = leaving[i], previous = returning[i];
+			unsigned leavingCount = 0, leavingTwins = 0, returningCount = 0, returningTwins = 0;
+			for (size_t j = 0; j < leaving.size(); j++)
+			{
+				leavingCount += leaving[j] == next;
+				leavingTwins += returning[j] == next;
+				returningCount += returning[j] == previous;
+				returningTwins += leaving[j] == previous;
+			}
+			manifold &= leavingCount == 1 && returningCount == 1 && leavingTwins <= 1 && returningTwins <= 1;
+			openEdges += !leavingTwins + !returningTwins;
+		}
+
+		if (!manifold)
+			kinds[v] = KindLocked;
+		else if (kinds[v] != KindLocked && openEdges)
+			kinds[v] = openEdges == 2 ? KindBorder : KindLocked;
+	}
+}
+
+//
+// Whether collapsing a onto b keeps the surface manifold and the triangles around a from
+// flipping or degenerating, adds the triangles that would be removed to removed.
+// marks holds a stamp per vertex, stamp is advanced by two.
+//
+bool collapse_valid(const adjacency_t& adjacency, const unsigned* tris, const vec3f* positions, unsigned a, unsigned b,
+	unsigned* marks, unsigned& stamp, size_t& removed)
+{
+	size_t shared = 0;
+	for (const unsigned* t = adjacency.begin(a); t != adjacency.end(a); t++)
+	{
+		const unsigned* tri = tris + *t * 3;
+		if (tri[0] == b || tri[1] == b || tri[2] == b)
+		{
+			// Keep the third vertex if this is its last triangle
+			const unsigned c = tri[0] ^ tri[1] ^ tri[2] ^ a ^ b;
+			if (adjacency.end(c) - adjacency.begin(c) == 1)
+				return false;
+			shared++;
+			continue;
+		}
+
+		// Rotate a to the front
+		const int k = tri[0] == a ? 0 : tri[1] == a ? 1 : 2;
+		const vec3f& p1 = positions[tri[(k + 1) % 3]];
+		const vec3f& p2 = positions[tri[(k + 2) % 3]];
+		const vec3f before = (p1 - positions[a]) % (p2 - positions[a]);
+		const vec3f after = (p1 - positions[b]) % (p2 - positions[b]);
+		const float d = dot(before, after);
+		if (d <= 0 || d * d < FlipThreshold * FlipThreshold * before.length_squared() * after.length_squared())
+			return false;
+	}
+
+	// Link condition: a and b may only have the neighbours in common that the triangles
+	// they share give them, or the collapse would fold the surface onto itself
+	const unsigned mark = stamp + 1, counted = stamp + 2;
+	stamp += 2;
+	for (const unsigned* t = adjacency.begin(a); t != adjacency.end(a); t++)
+		for (int k = 0; k < 3; k++)
+			marks[tris[*t * 3 + k]] = mark;
+	size_t common = 0;
+	for (const unsigned* t = adjacency.begin(b); t != adjacency.end(b); t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			const unsigned v = tris[*t * 3 + k];
+			if (v != a && v != b && marks[v] == mark)
+			{
+				marks[v] = counted;
+				common++;
+			}
+		}
+	}
+	if (common != shared)
+		return false;
+
+	removed += shared;
+	return true;
+}
+
+//
+// Orders collapses by error, approximately: a counting sort by the exponent and top three
+// mantissa bits, whose bits are ordered like the errors as these are not negative
+//
+void sort_collapses(const ArenaVector<collapse_t>& collapses, ArenaVector<unsigned>& order)
+{
+	const unsigned Buckets = 1 << 11;
+	auto bucket = [](float error)
+	{
+		unsigned bits;
+		memcpy(&bits, &error, sizeof(bits));
+		return (bits >> 20) & (Buckets - 1);
+	};
+
+	unsigned starts[Buckets + 1] = {};
+	for (const collapse_t& c : collapses)
+		starts[bucket(c.error) + 1]++;
+	for (unsigned i = 1; i <= Buckets; i++)
+		starts[i] += starts[i - 1];
+
+	order.resize(collapses.size());
+	for (size_t i = 0; i < collapses.size(); i++)
+		order[starts[bucket(collapses[i].error)]++] = (unsigned)i;
+}
+
+//
+// Simplifies a triangle list, see SimplifyMesh()
+//
+size_t simplify(const Vertex* vertices, const unsigned char* seams, const unsigned* indices, size_t index_count,
+	unsigned* destination, size_t target_index_count, float* result_error, LoadArena& arena)
+{
+	*result_error = 0;
+	if (!index_count)
+		return 0;
+
+	// Local vertex numbers, the span of the indices
+	unsigned first = indices[0], last = indices[0];
+	for (size_t i = 1; i < index_count; i++)
+	{
+		first = (std::min)(first, indices[i]);
+		last = (std::max)(last, indices[i]);
+	}
+	const size_t vertexCount = (size_t)last - first + 1;
+	size_t triangleCount = index_count / 3;
+
+	ArenaVector<unsigned> tris(triangleCount * 3, 0u, &arena);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		tris[i] = indices[i] - first;
+
+	// Positions within the unit cube, so errors do not depend on the size of the mesh
+	vec3f lo = vertices[indices[0]].Position, hi = lo;
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		const vec3f& p = vertices[indices[i]].Position;
+		lo = vec3f((std::min)(lo.x, p.x), (std::min)(lo.y, p.y), (std::min)(lo.z, p.z));
+		hi = vec3f((std::max)(hi.x, p.x), (std::max)(hi.y, p.y), (std::max)(hi.z, p.z));
+	}
+	const float extent = (std::max)(hi.x - lo.x, (std::max)(hi.y - lo.y, hi.z - lo.z));
+	const float scale = extent > 0 ? 1.0f / extent : 0.0f;
+	ArenaVector<vec3f> positions(vertexCount, vec3f_zero, &arena);
+	for (size_t v = 0; v < vertexCount; v++)
+		positions[v] = (vertices[first + v].Position - lo) * scale;
+
+	adjacency_t adjacency(vertexCount, triangleCount, arena);
+	adjacency.build(tris.data(), triangleCount);
+
+	ArenaVector<unsigned char> kinds(vertexCount, KindManifold, &arena);
+	for (size_t v = 0; v < vertexCount; v++)
+		if (seams[first + v])
+			kinds[v] = KindLocked;
+	classify_vertices(adjacency, tris.data(), kinds, arena);
+
+	// Area weighted planes of the triangles, and planes through open edges at right angles to them
+	ArenaVector<quadric_t> quadrics(vertexCount, quadric_t(), &arena);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const unsigned* tri = tris.data() + t * 3;
+		const vec3f& p0 = positions[tri[0]];
+		const vec3f normal = (positions[tri[1]] - p0) % (positions[tri[2]] - p0);
+		const float length = normal.length();
+		if (length <= 0)
+			continue;
+		const vec3f n = normal * (1.0f / length);
+		for (int k = 0; k < 3; k++)
+			quadrics[tri[k]].add_plane(n, -dot(n, p0), length * 0.5f);
+
+		for (int k = 0; k < 3; k++)
+		{
+			const unsigned a = tri[k], b = tri[(k + 1) % 3];
+			if (kinds[a] == KindManifold || kinds[b] == KindManifold || count_edge(adjacency, tris.data(), a, b, a))
+				continue;
+			const vec3f edge = positions[b] - positions[a];
+			const vec3f side = edge % n;
+			const float sideLength = side.length();
+			if (sideLength <= 0)
+				continue;
+			const vec3f s = side * (1.0f / sideLength);
+			const float weight = BorderWeight * edge.length_squared();
+			quadrics[a].add_plane(s, -dot(s, positions[a]), weight);
+			quadrics[b].add_plane(s, -dot(s, positions[a]), weight);
+		}
+	}
+
+	ArenaVector<collapse_t> collapses(&arena);
+	collapses.reserve(triangleCount * 3);
+	ArenaVector<unsigned> order(&arena);
+	order.reserve(triangleCount * 3);
+	ArenaVector<unsigned> remap(vertexCount, 0u, &arena);
+	ArenaVector<unsigned char> touched(vertexCount, 0, &arena);
+	ArenaVector<unsigned> marks(vertexCount, 0u, &arena);
+	unsigned stamp = 0;
+	const size_t targetTriangles = target_index_count / 3;
+	float maxError = 0;
+
+	for (unsigned pass = 0; pass < MaxPasses && triangleCount > targetTriangles; pass++)
+	{
+		// The cheaper direction of each edge that may collapse, edges shared by two triangles once
+		collapses.clear();
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				const unsigned a = tris[t * 3 + k], b = tris[t * 3 + (k + 1) % 3];
+				const bool bothOnBorder = kinds[a] != KindManifold && kinds[b] != KindManifold;
+				const bool open = bothOnBorder && !count_edge(adjacency, tris.data(), a, b, a);
+				if (a > b && !open)
+					continue;
+				if (bothOnBorder && !open && kinds[a] == KindBorder && kinds[b] == KindBorder)
+					continue; // would pinch the surface between two borders
+
+				const bool ab = kinds[a] == KindManifold || (kinds[a] == KindBorder && open);
+				const bool ba = kinds[b] == KindManifold || (kinds[b] == KindBorder && open);
+				const float eab = ab ? quadrics[a].error(positions[b]) : 0.0f;
+				const float eba = ba ? quadrics[b].error(positions[a]) : 0.0f;
+				if (ab && (!ba || eab <= eba))
+					collapses.push_back({ a, b, eab });
+				else if (ba)
+					collapses.push_back({ b, a, eba });
+			}
+		}
+		if (collapses.empty())
+			break;
+		sort_collapses(collapses, order);
+
+		// Independent collapses in order of error, until enough triangles are gone
+		for (size_t v = 0; v < vertexCount; v++)
+			remap[v] = (unsigned)v;
+		std::fill(touched.begin(), touched.end(), (unsigned char)0);
+		const size_t toRemove = triangleCount - targetTriangles;
+		size_t removed = 0;
+		for (unsigned i : order)
+		{
+			const collapse_t& c = collapses[i];
+			if (removed >= toRemove)
+				break;
+			if (touched[c.from] || touched[c.to])
+				continue;
+			if (!collapse_valid(adjacency, tris.data(), positions.data(), c.from, c.to, marks.data(), stamp, removed))
+				continue;
+
+			remap[c.from] = c.to;
+			quadrics[c.to].add(quadrics[c.from]);
+			maxError = (std::max)(maxError, c.error);
+			for (const unsigned* t = adjacency.begin(c.from); t != adjacency.end(c.from); t++)
+				for (int k = 0; k < 3; k++)
+					touched[tris[*t * 3 + k]] = 1;
+		}
+		if (!removed)
+			break;
+
+		// Apply the collapses and drop the triangles they degenerated
+		size_t kept = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			const unsigned a = remap[tris[t * 3 + 0]], b = remap[tris[t * 3 + 1]], c = remap[tris[t * 3 + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+			tris[kept * 3 + 0] = a;
+			tris[kept * 3 + 1] = b;
+			tris[kept * 3 + 2] = c;
+			kept++;
+		}
+		triangleCount = kept;
+		adjacency.build(tris.data(), triangleCount);
+	}
+
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		destination[i] = tris[i] + first;
+	*result_error = std::sqrt(maxError) * extent;
+	return triangleCount * 3;
+}
+
+} // namespace
+
+void FindSeamVertices(const Vertex* vertices, size_t vertex_count, unsigned char* seams)
+{
+	LoadArena& arena = LoadArena::ForThread();
+	LoadArena::Scope arenaScope(arena);
+
+	// Open addressing hash of the positions, exact matches only
+	size_t tableSize = 1;
+	while (tableSize < vertex_count * 2)
+		tableSize *= 2;
+	ArenaVector<unsigned> table(tableSize, ~0u, &arena);
+
+	auto hash = [](const vec3f& p)
+	{
+		// + 0.0f makes -0 and +0 hash the same, as they compare equal
+		const float xyz[3] = { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f };
+		unsigned bits[3];
+		memcpy(bits, xyz, sizeof(bits));
+		return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+	};
+
+	for (size_t v = 0; v < vertex_count; v++)
+	{
+		const vec3f& p = vertices[v].Position;
+		seams[v] = 0;
+		for (size_t slot = hash(p) & (tableSize - 1);; slot = (slot + 1) & (tableSize - 1))
+		{
+			const unsigned other = table[slot];
+			if (other == ~0u)
+			{
+				table[slot] = (unsigned)v;
+				break;
+			}
+			const vec3f& q = vertices[other].Position;
+			if (p.x == q.x && p.y == q.y && p.z == q.z)
+			{
+				seams[v] = 1;
+				seams[other] = 1;
+				break;
+			}
+		}
+	}
+}
+
+size_t SimplifyMesh(const Vertex* vertices, const unsigned char* seams, const unsigned* indices, size_t index_count,
+	unsigned* destination, size_t target_index_count, float* result_error)
+{
+	LoadArena& arena = LoadArena::ForThread();
+	LoadArena::Scope arenaScope(arena);
+	return simplify(vertices, seams, indices, index_count, destination, target_index_count, result_error, arena);
+}
+
+std::vector<MeshLod> GenerateLods(const Vertex* vertices, size_t vertex_count, std::vector<unsigned>& indices,
+	const std::vector<IndexRange>& ranges, unsigned max_levels, float ratio)
+{
+	std::vector<MeshLod> lods;
+	std::vector<unsigned char> seams(vertex_count);
+	FindSeamVertices(vertices, vertex_count, seams.data());
+
+	const std::vector<IndexRange>* previous = &ranges;
+	size_t previousTriangles = 0;
+	for (const IndexRange& range : ranges)
+		previousTriangles += range.Size / 3;
+	float previousError = 0;
+
+	for (unsigned level = 0; level < max_levels; level++)
+	{
+		const std::vector<IndexRange>& source = *previous;
+		MeshLod lod;
+		std::vector<size_t> sizes(source.size());
+		std::vector<float> errors(source.size());
+		{
+			// The workers allocate from the caller's arena, which is reset after each level
+			LoadArena& arena = LoadArena::ForThread();
+			LoadArena::Scope arenaScope(arena);
+
+			// Each range simplifies into its own part of the scratch buffer
+			std::vector<size_t> starts(source.size() + 1, 0);
+			for (size_t r = 0; r < source.size(); r++)
+				starts[r + 1] = starts[r] + source[r].Size;
+			ArenaVector<unsigned> scratch(starts.back(), 0u, &arena);
+
+			// Largest ranges first, so a big one does not start last and run alone
+			std::vector<size_t> order(source.size());
+			for (size_t i = 0; i < order.size(); i++)
+				order[i] = i;
+			std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return source[a].Size > source[b].Size; });
+
+			ThreadPool::Global().ParallelFor(order.size(), [&](size_t i)
+			{
+				const size_t r = order[i];
+				const IndexRange& range = source[r];
+				const size_t target = (size_t)(range.Size / 3 * ratio) * 3;
+				sizes[r] = simplify(vertices + range.Offset, seams.data() + range.Offset, indices.data() + range.Start, range.Size,
+					scratch.data() + starts[r], target, &errors[r], arena);
+			});
+
+			for (size_t r = 0; r < source.size(); r++)
+			{
+				if (!sizes[r])
+					continue;
+				lod.IndexRanges.push_back({ (unsigned)indices.size(), (unsigned)sizes[r], source[r].Offset, source[r].MaterialIndex });
+				indices.insert(indices.end(), scratch.begin() + starts[r], scratch.begin() + starts[r] + sizes[r]);
+			}
+		}
+
+		size_t triangles = 0;
+		float error = 0;
+		for (size_t r = 0; r < source.size(); r++)
+		{
+			triangles += sizes[r] / 3;
+			error = (std::max)(error, errors[r]);
+		}
+
+		// Stop when the mesh hardly simplifies any more
+		if (!triangles || triangles > previousTriangles * 0.9f)
+		{
+			indices.resize(lod.IndexRanges.empty() ? indices.size() : lod.IndexRanges.front().Start);
+			break;
+		}
+
+#ifdef MESH_OPTIMIZE_VERTEX_CACHE
+		OptimizeVertexCache(indices.data(), lod.IndexRanges);
+#endif
+		// Errors of the levels add up, each one is measured against the level before it
+		lod.Error = previousError + error;
+		previousError = lod.Error;
+		previousTriangles = triangles;
+		lods.push_back(std::move(lod));
+		previous = &lods.back().IndexRanges;
+	}
+	return lods;
+}
+
+vec4f BoundingSphere(const Vertex* vertices, size_t vertex_count)
+{
+	if (!vertex_count)
+		return vec4f(0.0f, 0.0f, 0.0f, 0.0f);
+
+	vec3f lo = vertices[0].Position, hi = lo;
+	for (size_t i = 1; i < vertex_count; i++)
+	{
+		const vec3f& p = vertices[i].Position;
+		lo = vec3f((std::min)(lo.x, p.x), (std::min)(lo.y, p.y), (std::min)(lo.z, p.z));
+		hi = vec3f((std::max)(hi.x, p.x), (std::max)(hi.y, p.y), (std::max)(hi.z, p.z));
+	}
+	const vec3f centre = (lo + hi) * 0.5f;
+	float radius = 0;
+	for (size_t i = 0; i < vertex_count; i++)
+		radius = (std::max)(radius, (vertices[i].Position - centre).length_squared());
+	return vec4f(centre, std::sqrt(radius));
+}
+
+std::vector<IndexRange> GatherLodRanges(const std::vector<IndexRange>& ranges, const std::vector<MeshLod>& lods)
+{
+	std::vector<IndexRange> all = ranges;
+	for (const MeshLod& lod : lods)
+		all.insert(all.end(), lod.IndexRanges.begin(), lod.IndexRanges.end());
+	return all;
+}
+
+void ScatterLodRanges(const std::vector<IndexRange>& all, size_t mesh_index_count, std::vector<IndexRange>& ranges, std::vector<MeshLod>& lods)
+{
+	// Where the indices of each level start
+	std::vector<size_t> starts;
+	size_t start = mesh_index_count;
+	for (const MeshLod& lod : lods)
+	{
+		starts.push_back(start);
+		for (const IndexRange& range : lod.IndexRanges)
+			start += range.Size;
+	}
+
+	ranges.clear();
+	for (MeshLod& lod : lods)
+		lod.IndexRanges.clear();
+	for (const IndexRange& range : all)
+	{
+		if (range.Start < mesh_index_count)
+		{
+			ranges.push_back(range);
+			continue;
+		}
+		const size_t level = std::upper_bound(starts.begin(), starts.end(), (size_t)range.Start) - starts.begin() - 1;
+		lods[level].IndexRanges.push_back(range);
+	}
+}
@@ -0,0 +1,112 @@
+/**
+ * @file meshlod.h
+ * @brief Levels of detail generated by quadric error mesh simplification
+*/
+
+#pragma once
+#ifndef MESHLOD_H
+#define MESHLOD_H
+
+#include <vector>
+#include <cstddef>
+#include "drawcall.h"
+
+//! Generate levels of detail for each drawcall when a mesh is loaded (and store them in the mesh cache)
+#define MESH_GENERATE_LODS
+
+//! Most levels of detail generated per mesh
+#ifndef MESH_LOD_LEVELS
+#define MESH_LOD_LEVELS 4
+#endif
+
+//! Triangles of each level of detail relative to the level before it
+#ifndef MESH_LOD_RATIO
+#define MESH_LOD_RATIO 0.5f
+#endif
+
+//! Largest error in pixels of the level of detail OBJModel::SelectLod() picks
+#ifndef MESH_LOD_PIXEL_ERROR
+#define MESH_LOD_PIXEL_ERROR 1.0f
+#endif
+
+/**
+ * @brief A level of detail of a mesh: simplified index ranges into the mesh's own buffers.
+*/
+struct MeshLod
+{
+	std::vector<IndexRange> IndexRanges; //!< Ranges drawn instead of the mesh's ranges, with the same materials
+	float Error = 0; //!< Geometric error in model units, how far the simplified surface may be from the full one
+};
+
+/**
+ * @brief Simplifies a triangle list by collapsing edges onto existing vertices.
+ * @details Collapses are made in order of quadric error (Garland and Heckbert, "Surface
+ * Simplification Using Quadric Error Metrics"), in passes of independent collapses that are
+ * checked for flipped triangles. Vertices that share their position with another vertex
+ * (texture or normal seams, and the edges between drawcalls) are never moved, so seams and
+ * material boundaries stay intact. Vertices on open borders only slide along the border.
+ * The result only refers to vertices of the input, so it can share its vertex buffer.
+ * @param vertices Vertex array the indices refer to.
+ * @param seams One flag per vertex, nonzero for vertices that must not move, see FindSeamVertices().
+ * @param indices Triangle list.
+ * @param index_count Number of indices.
+ * @param[out] destination At least index_count indices.
+ * @param target_index_count Number of indices to simplify to, if possible.
+ * @param[out] result_error Largest error of a collapse made, in model units.
+ * @return Number of indices written to destination.
+*/
+size_t SimplifyMesh(const Vertex* vertices, const unsigned char* seams, const unsigned* indices, size_t index_count,
+	unsigned* destination, size_t target_index_count, float* result_error);
+
+/**
+ * @brief Flags vertices that share their position with another vertex.
+ * @param vertices Vertex array.
+ * @param vertex_count Number of vertices.
+ * @param[out] seams One flag per vertex, set to 1 or 0.
+*/
+void FindSeamVertices(const Vertex* vertices, size_t vertex_count, unsigned char* seams);
+
+/**
+ * @brief Generates a chain of levels of detail for every index range of a mesh.
+ * @details Each level simplifies the level before it to ratio of its triangles, until
+ * max_levels or until simplification stops making progress (for example when most vertices are
+ * on seams). The indices of the levels are appended to indices, and are vertex cache optimized
+ * with MESH_OPTIMIZE_VERTEX_CACHE. Ranges are simplified in parallel on ThreadPool::Global().
+ * @param vertices Vertex array the indices refer to.
+ * @param vertex_count Number of vertices.
+ * @param[in,out] indices Triangle index buffer, the levels are added at the end.
+ * @param ranges Index ranges (drawcalls) of the full mesh.
+ * @param max_levels Most levels to generate.
+ * @param ratio Triangles of a level relative to the one before it.
+ * @return The levels, from the most to the least detailed, with increasing Error.
+*/
+std::vector<MeshLod> GenerateLods(const Vertex* vertices, size_t vertex_count, std::vector<unsigned>& indices,
+	const std::vector<IndexRange>& ranges, unsigned max_levels = MESH_LOD_LEVELS, float ratio = MESH_LOD_RATIO);
+
+/**
+ * @brief Bounding sphere of a vertex array, centred on its bounding box.
+ * @param vertices Vertex array.
+ * @param vertex_count Number of vertices.
+ * @return Centre (xyz) and radius (w), all 0 if there are no vertices.
+*/
+vec4f BoundingSphere(const Vertex* vertices, size_t vertex_count);
+
+/**
+ * @brief The index ranges of a mesh followed by those of its levels of detail, e.g. for MakeIndices16().
+ * @param ranges Index ranges of the full mesh.
+ * @param lods Levels of detail.
+*/
+std::vector<IndexRange> GatherLodRanges(const std::vector<IndexRange>& ranges, const std::vector<MeshLod>& lods);
+
+/**
+ * @brief Hands ranges from GatherLodRanges() back to the mesh and its levels of detail.
+ * @details Ranges may have been split in the meantime: each one goes to the mesh or level
+ * whose indices it starts in. The indices of a level follow those of the level before it.
+ * @param all Ranges of the mesh and its levels.
+ * @param mesh_index_count Number of indices of the full mesh, where the levels start.
+ * @param[out] ranges Index ranges of the full mesh.
+ * @param[in,out] lods Levels of detail, their IndexRanges are replaced.
+*/
+void ScatterLodRanges(const std::vector<IndexRange>& all, size_t mesh_index_count, std::vector<IndexRange>& ranges, std::vector<MeshLod>& lods);
+
+#endif
@@ -0,0 +1,723 @@
+//
+//  Index buffer optimizations for the GPU's vertex caches
+//
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include "meshoptimize.h"
+#include "threadpool.h"
+#include "arena.h"
+
+namespace {
+
+// Parameters of the Forsyth score function, from the paper
+const unsigned ForsythCacheSize = 32;
+const float CacheDecayPower = 1.5f;
+const float LastTriangleScore = 0.75f;
+const float ValenceBoostScale = 2.0f;
+const float ValenceBoostPower = 0.5f;
+const unsigned ValenceTableSize = 32;
+
+//
+// Precomputed parts of the vertex score
+//
+struct forsyth_scores_t
+{
+	float cache[ForsythCacheSize];
+	float valence[ValenceTableSize];
+
+	forsyth_scores_t()
+	{
+		// The vertices of the last triangle get a fixed score, so that the next triangle
+		// does not simply reuse its edge and make a strip, which a larger cache does not need
+		for (unsigned i = 0; i < ForsythCacheSize; i++)
+		{
+			cache[i] = i < 3 ? LastTriangleScore :
+				std::pow(1.0f - (float)(i - 3) / (ForsythCacheSize - 3), CacheDecayPower);
+		}
+		valence[0] = 0;
+		for (unsigned i = 1; i < ValenceTableSize; i++)
+			valence[i] = ValenceBoostScale * std::pow((float)i, -ValenceBoostPower);
+	}
+
+	// Score of a vertex at cache_position (-1 if not in the cache) with remaining triangles still to draw
+	float Vertex(int cache_position, unsigned remaining) const
+	{
+		if (!remaining)
+			return -1.0f;
+		float score = cache_position < 0 ? 0.0f : cache[cache_position];
+		score += remaining < ValenceTableSize ? valence[remaining] :
+			ValenceBoostScale * std::pow((float)remaining, -ValenceBoostPower);
+		return score;
+	}
+};
+
+//
+// Smallest index and the number of vertices from there to the largest index of a range
+//
+void index_span(const unsigned* indices, size_t count, unsigned& first, size_t& span)
+{
+	unsigned lo = ~0u, hi = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		lo = (std::min)(lo, indices[i]);
+		hi = (std::max)(hi, indices[i]);
+	}
+	first = count ? lo : 0;
+	span = count ? (size_t)(hi - lo) + 1 : 0;
+}
+
+//
+// Adds the triangles, vertices and transforms of a range drawn with an empty FIFO cache to stats.
+// timestamps has an entry per vertex from first on, all 0.
+//
+void simulate_cache(const unsigned* indices, size_t count, unsigned first, unsigned cache_size, unsigned* timestamps, VertexCacheStats& stats)
+{
+	// A vertex is in the FIFO if fewer than cache_size misses happened since it was loaded
+	unsigned timestamp = cache_size + 1;
+	for (size_t i = 0; i < count; i++)
+	{
+		unsigned& loaded = timestamps[indices[i] - first];
+		if (!loaded)
+			stats.Vertices++;
+		if (timestamp - loaded > cache_size)
+		{
+			loaded = timestamp++;
+			stats.Transforms++;
+		}
+	}
+	stats.Triangles += count / 3;
+}
+
+void optimize_range(unsigned* indices, size_t index_count, const forsyth_scores_t& scores, LoadArena& arena)
+{
+	const size_t triangleCount = index_count / 3;
+	if (triangleCount < 3)
+		return;
+
+	unsigned first;
+	size_t span;
+	index_span(indices, triangleCount * 3, first, span);
+
+	// Triangles using each vertex. The first remaining[v] entries of a vertex's list are the
+	// triangles it still has to draw.
+	ArenaVector<unsigned> remaining(span, 0u, &arena);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		remaining[indices[i] - first]++;
+
+	ArenaVector<size_t> adjacencyStart(span + 1, 0, &arena);
+	for (size_t v = 0; v < span; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+
+	ArenaVector<unsigned> adjacency(triangleCount * 3, 0u, &arena);
+	{
+		ArenaVector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1, &arena);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			adjacency[fill[indices[i] - first]++] = (unsigned)(i / 3);
+	}
+
+	ArenaVector<int> cachePosition(span, -1, &arena);
+	ArenaVector<float> vertexScore(span, 0.0f, &arena);
+	for (size_t v = 0; v < span; v++)
+		vertexScore[v] = scores.Vertex(-1, remaining[v]);
+
+	ArenaVector<float> triangleScore(triangleCount, 0.0f, &arena);
+	ArenaVector<char> emitted(triangleCount, 0, &arena);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int k = 0; k < 3; k++)
+			triangleScore[t] += vertexScore[indices[t * 3 + k] - first];
+	}
+
+	ArenaVector<unsigned> output(triangleCount * 3, 0u, &arena);
+	unsigned cache[ForsythCacheSize + 3], newCache[ForsythCacheSize + 3];
+	unsigned cacheCount = 0;
+	size_t nextUnemitted = 0;
+
+	// Start with the best triangle overall, later ones are taken from the neighbourhood of the cache
+	size_t best = 0;
+	for (size_t t = 1; t < triangleCount; t++)
+	{
+		if (triangleScore[t] > triangleScore[best])
+			best = t;
+	}
+
+	for (size_t n = 0; n < triangleCount; n++)
+	{
+		// Nothing left around the cache: continue with the next triangle in the original order
+		if (best == (size_t)-1)
+		{
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			best = nextUnemitted;
+		}
+
+		const unsigned* triangle = indices + best * 3;
+		emitted[best] = 1;
+		output[n * 3 + 0] = triangle[0];
+		output[n * 3 + 1] = triangle[1];
+		output[n * 3 + 2] = triangle[2];
+
+		// Remove the triangle from the lists of its vertices and put them first in the cache
+		unsigned newCount = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			const unsigned v = triangle[k] - first;
+			unsigned* live = &adjacency[adjacencyStart[v]];
+			for (unsigned i = 0; i < remaining[v]; i++)
+			{
+				if (live[i] == best)
+				{
+					live[i] = live[remaining[v] - 1];
+					live[remaining[v] - 1] = (unsigned)best;
+					remaining[v]--;
+					break;
+				}
+			}
+			if (std::find(newCache, newCache + newCount, v) == newCache + newCount)
+				newCache[newCount++] = v;
+		}
+		const unsigned triangleVertices = newCount;
+		for (unsigned i = 0; i < cacheCount; i++)
+		{
+			if (std::find(newCache, newCache + triangleVertices, cache[i]) == newCache + triangleVertices)
+				newCache[newCount++] = cache[i];
+		}
+
+		// Rescore the vertices that moved in the cache or fell out of it, and their triangles
+		for (unsigned i = 0; i < newCount; i++)
+		{
+			const unsigned v = newCache[i];
+			cachePosition[v] = i < ForsythCacheSize ? (int)i : -1;
+			const float score = scores.Vertex(cachePosition[v], remaining[v]);
+			const float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			const unsigned* live = &adjacency[adjacencyStart[v]];
+			for (unsigned j = 0; j < remaining[v]; j++)
+				triangleScore[live[j]] += delta;
+		}
+		cacheCount = (std::min)(newCount, ForsythCacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		// The next triangle is the best one using a cached vertex
+		best = (size_t)-1;
+		float bestScore = -1.0f;
+		for (unsigned i = 0; i < cacheCount; i++)
+		{
+			const unsigned v = cache[i];
+			const unsigned* live = &adjacency[adjacencyStart[v]];
+			for (unsigned j = 0; j < remaining[v]; j++)
+			{
+				if (triangleScore[live[j]] > bestScore)
+				{
+					bestScore = triangleScore[live[j]];
+					best = live[j];
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+} // namespace
+
+VertexCacheStats AnalyzeVertexCache(const unsigned* indices, const std::vector<IndexRange>& ranges, unsigned cache_size)
+{
+	LoadArena& arena = LoadArena::ForThread();
+	LoadArena::Scope arenaScope(arena);
+
+	VertexCacheStats stats;
+	ArenaVector<unsigned> timestamps(&arena);
+	for (const IndexRange& range : ranges)
+	{
+		const unsigned* rangeIndices = indices + range.Start;
+		const size_t count = range.Size / 3 * 3;
+		unsigned first;
+		size_t span;
+		index_span(rangeIndices, count, first, span);
+
+		timestamps.assign(span, 0u);
+		simulate_cache(rangeIndices, count, first, cache_size, timestamps.data(), stats);
+	}
+	return stats;
+}
+
+void OptimizeVertexCache(unsigned* indices, const std::vector<IndexRange>& ranges)
+{
+	static const forsyth_scores_t scores;
+
+	// The workers allocate from the caller's arena, which is reset when all ranges are done
+	LoadArena& arena = LoadArena::ForThread();
+	LoadArena::Scope arenaScope(arena);
+
+	// Largest ranges first, so a big one does not start last and run alone
+	std::vector<size_t> order(ranges.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return ranges[a].Size > ranges[b].Size; });
+
+	ThreadPool::Global().ParallelFor(order.size(), [&](size_t i)
+	{
+		const IndexRange& range = ranges[order[i]];
+		optimize_range(indices + range.Start, range.Size, scores, arena);
+	});
+}
+
+namespace {
+
+// Views of AnalyzeOverdraw(), along the axes and the diagonals
+const size_t OverdrawViews = 14;
+const float OverdrawDirections[OverdrawViews][3] =
+{
+	{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+	{ 1, 1, 1 }, { 1, 1, -1 }, { 1, -1, 1 }, { 1, -1, -1 },
+	{ -1, 1, 1 }, { -1, 1, -1 }, { -1, -1, 1 }, { -1, -1, -1 },
+};
+
+// Resolution of the views OptimizeOverdraw() checks its result with, and about how many triangles it draws
+const unsigned OverdrawCheckResolution = 32;
+const size_t OverdrawCheckTriangles = 4096;
+
+//
+// Orthographic view along a direction, with x to the right and y up on screen
+//
+struct raster_view_t
+{
+	vec3f right, up, forward;
+
+	explicit raster_view_t(const vec3f& direction)
+	{
+		forward = linalg::normalize(direction);
+		const vec3f helper = std::fabs(forward.y) < 0.9f ? vec3f(0, 1, 0) : vec3f(1, 0, 0);
+		right = linalg::normalize(forward % helper);
+		up = right % forward;
+	}
+};
+
+//
+// Draws the ranges into a depth buffer, returns the shaded and covered pixels
+//
+OverdrawStats rasterize_view(const raster_view_t& view, const vec3f& centre, float radius,
+	const Vertex* vertices, const unsigned* indices, const std::vector<IndexRange>& ranges, unsigned resolution)
+{
+	std::vector<float> depth((size_t)resolution * resolution, FLT_MAX);
+	const float scale = 0.5f * resolution / radius;
+	OverdrawStats stats;
+
+	for (const IndexRange& range : ranges)
+	{
+		const Vertex* base = vertices + range.Offset;
+		for (size_t i = range.Start; i + 2 < (size_t)range.Start + range.Size; i += 3)
+		{
+			float x[3], y[3], z[3];
+			for (int k = 0; k < 3; k++)
+			{
+				const vec3f p = base[indices[i + k]].Position - centre;
+				x[k] = dot(p, view.right) * scale + 0.5f * resolution;
+				y[k] = dot(p, view.up) * scale + 0.5f * resolution;
+				z[k] = dot(p, view.forward);
+			}
+
+			// Counter-clockwise on screen is front facing, the rest is culled
+			const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+			if (!(area > 0))
+				continue;
+
+			const int minX = (std::max)(0, (int)std::floor((std::min)({ x[0], x[1], x[2] })));
+			const int maxX = (std::min)((int)resolution - 1, (int)std::ceil((std::max)({ x[0], x[1], x[2] })));
+			const int minY = (std::max)(0, (int)std::floor((std::min)({ y[0], y[1], y[2] })));
+			const int maxY = (std::min)((int)resolution - 1, (int)std::ceil((std::max)({ y[0], y[1], y[2] })));
+			for (int py = minY; py <= maxY; py++)
+			{
+				const float sy = py + 0.5f;
+				for (int px = minX; px <= maxX; px++)
+				{
+					// Edge functions at the pixel centre are the barycentric weights times area
+					const float sx = px + 0.5f;
+					const float w0 = (x[2] - x[1]) * (sy - y[1]) - (y[2] - y[1]) * (sx - x[1]);
+					const float w1 = (x[0] - x[2]) * (sy - y[2]) - (y[0] - y[2]) * (sx - x[2]);
+					const float w2 = (x[1] - x[0]) * (sy - y[0]) - (y[1] - y[0]) * (sx - x[0]);
+					if (w0 < 0 || w1 < 0 || w2 < 0)
+						continue;
+
+					const float d = (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area;
+					float& stored = depth[(size_t)py * resolution + px];
+					if (d < stored)
+					{
+						stored = d;
+						stats.Shaded++;
+					}
+				}
+			}
+		}
+	}
+
+	for (float d : depth)
+		stats.Covered += d != FLT_MAX;
+	return stats;
+}
+
+//
+// Checks that drawing the clusters of a range in order does not shade more pixels than drawing
+// them as they are, from the views of AnalyzeOverdraw() at OverdrawCheckResolution. Large ranges
+// are checked with a sample of about OverdrawCheckTriangles triangles in whole clusters.
+//
+bool overdraw_reduced(const Vertex* vertices, const unsigned* indices, const ArenaVector<size_t>& clusters, const ArenaVector<size_t>& order, LoadArena& arena)
+{
+	const size_t clusterCount = clusters.size() - 1;
+	const size_t triangleCount = clusters.back();
+	const size_t step = (std::max)((size_t)1, (std::min)(clusterCount / 2, triangleCount / OverdrawCheckTriangles));
+
+	ArenaVector<unsigned> before(&arena), after(&arena);
+	for (size_t c = 0; c < clusterCount; c += step)
+		before.insert(before.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+	for (size_t c : order)
+	{
+		if (c % step == 0)
+			after.insert(after.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+	}
+
+	// Bounding sphere of the vertices drawn, around the centre of their bounding box
+	vec3f lo = vertices[before[0]].Position, hi = lo;
+	for (unsigned index : before)
+	{
+		const vec3f& p = vertices[index].Position;
+		lo = vec3f((std::min)(lo.x, p.x), (std::min)(lo.y, p.y), (std::min)(lo.z, p.z));
+		hi = vec3f((std::max)(hi.x, p.x), (std::max)(hi.y, p.y), (std::max)(hi.z, p.z));
+	}
+	const vec3f centre = (lo + hi) * 0.5f;
+	float radius = 0;
+	for (unsigned index : before)
+		radius = (std::max)(radius, (vertices[index].Position - centre).length());
+	if (!(radius > 0))
+		return true;
+
+	const std::vector<IndexRange> ranges = { { 0, (unsigned)before.size(), 0, 0 } };
+	const unsigned* orders[2] = { before.data(), after.data() };
+	size_t shaded[2][OverdrawViews];
+	ThreadPool::Global().ParallelFor(2 * OverdrawViews, [&](size_t i)
+	{
+		const size_t o = i / OverdrawViews, v = i % OverdrawViews;
+		const raster_view_t view(vec3f(OverdrawDirections[v][0], OverdrawDirections[v][1], OverdrawDirections[v][2]));
+		shaded[o][v] = rasterize_view(view, centre, radius, vertices, orders[o], ranges, OverdrawCheckResolution).Shaded;
+	});
+
+	size_t totals[2] = { 0, 0 };
+	for (size_t v = 0; v < OverdrawViews; v++)
+	{
+		totals[0] += shaded[0][v];
+		totals[1] += shaded[1][v];
+	}
+	return totals[1] <= totals[0];
+}
+
+//
+// Cuts a range in vertex cache order into clusters, see OptimizeOverdraw().
+// Appends the first triangle of each cluster and then triangle_count to clusters.
+//
+void cluster_range(const unsigned* indices, size_t triangle_count, float threshold, LoadArena& arena, ArenaVector<size_t>& clusters)
+{
+	unsigned first;
+	size_t span;
+	index_span(indices, triangle_count * 3, first, span);
+
+	// FIFO cache as in AnalyzeVertexCache(), flush() empties it
+	const unsigned cacheSize = MESH_VERTEX_CACHE_SIZE;
+	ArenaVector<unsigned> timestamps(span, 0u, &arena);
+	unsigned timestamp = cacheSize + 1;
+	auto misses = [&](size_t t)
+	{
+		unsigned count = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned& loaded = timestamps[indices[t * 3 + k] - first];
+			if (timestamp - loaded > cacheSize)
+			{
+				loaded = timestamp++;
+				count++;
+			}
+		}
+		return count;
+	};
+	auto flush = [&]() { timestamp += cacheSize + 1; };
+
+	// Runs start where the vertex cache order restarts, at a triangle with three new vertices
+	ArenaVector<size_t> runs(&arena);
+	for (size_t t = 0; t < triangle_count; t++)
+	{
+		if (misses(t) == 3 || t == 0)
+			runs.push_back(t);
+	}
+	runs.push_back(triangle_count);
+
+	// Cut runs where the clusters so far are about as cache efficient as the whole run,
+	// drawing each cluster with an empty cache as it may end up anywhere
+	ArenaVector<size_t> closedMisses(&arena);
+	for (size_t r = 0; r + 1 < runs.size(); r++)
+	{
+		const size_t start = runs[r], end = runs[r + 1];
+		flush();
+		size_t runMisses = 0;
+		for (size_t t = start; t < end; t++)
+			runMisses += misses(t);
+		const float limit = (float)runMisses / (end - start) * threshold;
+
+		flush();
+		const size_t runClusters = clusters.size();
+		clusters.push_back(start);
+		closedMisses.clear();
+		size_t clusterMisses = 0, clusterTriangles = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			clusterMisses += misses(t);
+			clusterTriangles++;
+			if (t + 1 < end && clusterMisses <= limit * clusterTriangles)
+			{
+				clusters.push_back(t + 1);
+				closedMisses.push_back(clusterMisses);
+				flush();
+				clusterMisses = clusterTriangles = 0;
+			}
+		}
+
+		// The last cluster of the run has to be within the limit too, it is merged with the
+		// clusters before it until it is. Their misses overestimate those of the merged cluster,
+		// which has a warm cache, and the whole run is within the limit.
+		while (clusters.size() - 1 > runClusters && clusterMisses > limit * clusterTriangles)
+		{
+			clusterTriangles += clusters.back() - clusters[clusters.size() - 2];
+			clusterMisses += closedMisses.back();
+			clusters.pop_back();
+			closedMisses.pop_back();
+		}
+	}
+	clusters.push_back(triangle_count);
+}
+
+void optimize_overdraw_range(const Vertex* vertices, unsigned* indices, size_t index_count, float threshold, LoadArena& arena)
+{
+	const size_t triangleCount = index_count / 3;
+	if (triangleCount < 3)
+		return;
+
+	ArenaVector<size_t> clusters(&arena);
+	cluster_range(indices, triangleCount, threshold, arena, clusters);
+	const size_t clusterCount = clusters.size() - 1;
+	if (clusterCount < 2)
+		return;
+
+	// Area weighted centroid and normal of each cluster, and the centroid of the range
+	ArenaVector<vec3f> centroids(clusterCount, vec3f_zero, &arena);
+	ArenaVector<vec3f> normals(clusterCount, vec3f_zero, &arena);
+	vec3f rangeCentroid = vec3f_zero;
+	float rangeArea = 0;
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float area = 0;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			const vec3f& p0 = vertices[indices[t * 3 + 0]].Position;
+			const vec3f& p1 = vertices[indices[t * 3 + 1]].Position;
+			const vec3f& p2 = vertices[indices[t * 3 + 2]].Position;
+			const vec3f normal = (p1 - p0) % (p2 - p0);
+			const float triangleArea = normal.length();
+			centroids[c] += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normals[c] += normal;
+			area += triangleArea;
+		}
+		rangeCentroid += centroids[c];
+		rangeArea += area;
+		if (area > 0)
+			centroids[c] = centroids[c] / area;
+	}
+	if (rangeArea > 0)
+		rangeCentroid = rangeCentroid / rangeArea;
+
+	// Clusters far out and facing outwards are likely to hide others, draw them first
+	ArenaVector<float> occlusion(clusterCount, 0.0f, &arena);
+	ArenaVector<size_t> order(clusterCount, 0, &arena);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		order[c] = c;
+		if (normals[c].length_squared() > 0)
+			occlusion[c] = dot(centroids[c] - rangeCentroid, linalg::normalize(normals[c]));
+	}
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return occlusion[a] > occlusion[b]; });
+
+	ArenaVector<unsigned> output(&arena);
+	output.reserve(triangleCount * 3);
+	for (size_t c : order)
+		output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+
+	// Keep the vertex cache order if the clusters cost more than threshold in ACMR, or if they
+	// do not reduce the overdraw after all
+	unsigned first;
+	size_t span;
+	index_span(indices, triangleCount * 3, first, span);
+	ArenaVector<unsigned> timestamps(span, 0u, &arena);
+	VertexCacheStats before, after;
+	simulate_cache(indices, triangleCount * 3, first, MESH_VERTEX_CACHE_SIZE, timestamps.data(), before);
+	std::fill(timestamps.begin(), timestamps.end(), 0u);
+	simulate_cache(output.data(), triangleCount * 3, first, MESH_VERTEX_CACHE_SIZE, timestamps.data(), after);
+	if (after.Transforms > before.Transforms * threshold)
+		return;
+	if (!overdraw_reduced(vertices, indices, clusters, order, arena))
+		return;
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+} // namespace
+
+void OptimizeOverdraw(const Vertex* vertices, unsigned* indices, const std::vector<IndexRange>& ranges, float threshold)
+{
+	LoadArena& arena = LoadArena::ForThread();
+	LoadArena::Scope arenaScope(arena);
+
+	ThreadPool::Global().ParallelFor(ranges.size(), [&](size_t i)
+	{
+		const IndexRange& range = ranges[i];
+		optimize_overdraw_range(vertices + range.Offset, indices + range.Start, range.Size, threshold, arena);
+	});
+}
+
+OverdrawStats AnalyzeOverdraw(const Vertex* vertices, size_t vertex_count, const unsigned* indices, const std::vector<IndexRange>& ranges, unsigned resolution)
+{
+	OverdrawStats total;
+	if (!vertex_count || !resolution)
+		return total;
+
+	// Bounding sphere around the centre of the bounding box
+	vec3f lo = vertices[0].Position, hi = vertices[0].Position;
+	for (size_t i = 1; i < vertex_count; i++)
+	{
+		const vec3f& p = vertices[i].Position;
+		lo = vec3f((std::min)(lo.x, p.x), (std::min)(lo.y, p.y), (std::min)(lo.z, p.z));
+		hi = vec3f((std::max)(hi.x, p.x), (std::max)(hi.y, p.y), (std::max)(hi.z, p.z));
+	}
+	const vec3f centre = (lo + hi) * 0.5f;
+	float radius = 0;
+	for (size_t i = 0; i < vertex_count; i++)
+		radius = (std::max)(radius, (vertices[i].Position - centre).length());
+	if (!(radius > 0))
+		return total;
+
+	std::vector<OverdrawStats> views(OverdrawViews);
+	ThreadPool::Global().ParallelFor(views.size(), [&](size_t i)
+	{
+		const raster_view_t view(vec3f(OverdrawDirections[i][0], OverdrawDirections[i][1], OverdrawDirections[i][2]));
+		views[i] = rasterize_view(view, centre, radius, vertices, indices, ranges, resolution);
+	});
+
+	for (const OverdrawStats& view : views)
+	{
+		total.Covered += view.Covered;
+		total.Shaded += view.Shaded;
+	}
+	return total;
+}
+
+namespace {
+
+//
+// AnalyzeVertexFetch() with the vertices stored in the order given by position(vertex)
+//
+template<class Position>
+VertexFetchStats analyze_fetch(const unsigned* indices, const std::vector<IndexRange>& ranges, size_t vertex_count, size_t vertex_size, const Position& position)
+{
+	const size_t LineSize = 64;
+	const size_t LineCount = 16384 / LineSize;
+	const unsigned cacheSize = MESH_VERTEX_CACHE_SIZE;
+
+	LoadArena& arena = LoadArena::ForThread();
+	LoadArena::Scope arenaScope(arena);
+
+	// Post-transform cache as in AnalyzeVertexCache(), 0 for vertices not referenced yet
+	ArenaVector<unsigned> timestamps(vertex_count, 0u, &arena);
+	unsigned timestamp = cacheSize + 1;
+
+	// Line address held by each cache line, ~0 if empty
+	size_t lines[LineCount];
+	std::fill(lines, lines + LineCount, ~(size_t)0);
+
+	VertexFetchStats stats;
+	for (const IndexRange& range : ranges)
+	{
+		for (size_t i = range.Start; i < (size_t)range.Start + range.Size; i++)
+		{
+			const size_t vertex = (size_t)indices[i] + range.Offset;
+			unsigned& loaded = timestamps[vertex];
+			if (!loaded)
+				stats.Bytes += vertex_size;
+			if (loaded && timestamp - loaded <= cacheSize)
+				continue;
+			loaded = timestamp++;
+
+			// Only vertices missing the post-transform cache are fetched
+			const size_t address = (size_t)position(vertex) * vertex_size;
+			for (size_t line = address / LineSize; line <= (address + vertex_size - 1) / LineSize; line++)
+			{
+				size_t& cached = lines[line % LineCount];
+				if (cached != line)
+				{
+					cached = line;
+					stats.BytesFetched += LineSize;
+				}
+			}
+		}
+		timestamp += cacheSize + 1;
+	}
+	return stats;
+}
+
+} // namespace
+
+VertexFetchStats AnalyzeVertexFetch(const unsigned* indices, const std::vector<IndexRange>& ranges, size_t vertex_count, size_t vertex_size)
+{
+	return analyze_fetch(indices, ranges, vertex_count, vertex_size, [](size_t vertex) { return vertex; });
+}
+
+bool OptimizeVertexFetch(std::vector<Vertex>& vertices, unsigned* indices, std::vector<IndexRange>& ranges, size_t vertex_size)
+{
+	LoadArena& arena = LoadArena::ForThread();
+	LoadArena::Scope arenaScope(arena);
+
+	// New position of each vertex, ~0u if not used
+	ArenaVector<unsigned> remap(vertices.size(), ~0u, &arena);
+	unsigned used = 0;
+	for (const IndexRange& range : ranges)
+	{
+		for (size_t i = range.Start; i < (size_t)range.Start + range.Size; i++)
+		{
+			unsigned& position = remap[indices[i] + range.Offset];
+			if (position == ~0u)
+				position = used++;
+		}
+	}
+
+	// First-use order is not always better, e.g. long strips over a grid in row order read
+	// the shared row at half density, so keep the order that fetches less
+	const VertexFetchStats current = AnalyzeVertexFetch(indices, ranges, vertices.size(), vertex_size);
+	const VertexFetchStats reordered = analyze_fetch(indices, ranges, vertices.size(), vertex_size, [&](size_t vertex) { return remap[vertex]; });
+	if (reordered.BytesFetched >= current.BytesFetched)
+		return false;
+
+	for (IndexRange& range : ranges)
+	{
+		for (size_t i = range.Start; i < (size_t)range.Start + range.Size; i++)
+			indices[i] = remap[indices[i] + range.Offset];
+		range.Offset = 0;
+	}
+
+	std::vector<Vertex> output(used);
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		if (remap[v] != ~0u)
+			output[remap[v]] = vertices[v];
+	}
+	vertices.swap(output);
+	return true;
+}
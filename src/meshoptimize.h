@@ -0,0 +1,159 @@
+/**
+ * @file meshoptimize.h
+ * @brief Index buffer optimizations for the GPU's vertex caches
+*/
+
+#pragma once
+#ifndef MESHOPTIMIZE_H
+#define MESHOPTIMIZE_H
+
+#include <vector>
+#include <cstddef>
+#include "drawcall.h"
+
+//! Reorder the triangles of each index range for the post-transform vertex cache when a mesh is loaded (and before it is cached)
+#define MESH_OPTIMIZE_VERTEX_CACHE
+
+//! After MESH_OPTIMIZE_VERTEX_CACHE, order clusters of triangles to reduce overdraw (outward facing first)
+#define MESH_OPTIMIZE_OVERDRAW
+
+//! After the triangle passes, store the vertices in the order the index buffer first uses them
+#define MESH_OPTIMIZE_VERTEX_FETCH
+
+//! How much worse than its vertex cache order (as a ratio of ACMR) a cluster, or a range, may get in OptimizeOverdraw()
+#ifndef MESH_OVERDRAW_THRESHOLD
+#define MESH_OVERDRAW_THRESHOLD 1.05f
+#endif
+
+//! Size of the FIFO vertex cache that AnalyzeVertexCache() simulates by default
+#ifndef MESH_VERTEX_CACHE_SIZE
+#define MESH_VERTEX_CACHE_SIZE 16
+#endif
+
+/**
+ * @brief Post-transform cache efficiency of an index buffer
+*/
+struct VertexCacheStats
+{
+	size_t Triangles = 0; //!< Triangles drawn
+	size_t Vertices = 0; //!< Distinct vertices referenced by each range, summed over the ranges
+	size_t Transforms = 0; //!< Cache misses, i.e. vertex shader invocations
+
+	/**
+	 * @brief Average cache miss ratio, vertex shader invocations per triangle. 0.5 is the ideal for large regular meshes, 3 the worst.
+	*/
+	float ACMR() const { return Triangles ? (float)Transforms / Triangles : 0.0f; }
+
+	/**
+	 * @brief Average transform to vertex ratio, vertex shader invocations per vertex. 1 is the ideal.
+	*/
+	float ATVR() const { return Vertices ? (float)Transforms / Vertices : 0.0f; }
+};
+
+/**
+ * @brief Pixels drawn by a mesh, from AnalyzeOverdraw()
+*/
+struct OverdrawStats
+{
+	size_t Covered = 0; //!< Pixels covered by the mesh, summed over the views
+	size_t Shaded = 0; //!< Pixels that passed the depth test when drawn, i.e. pixel shader invocations
+
+	/**
+	 * @brief Pixel shader invocations per covered pixel. 1 is the ideal.
+	*/
+	float Overdraw() const { return Covered ? (float)Shaded / Covered : 0.0f; }
+};
+
+/**
+ * @brief Memory traffic of vertex fetch, from AnalyzeVertexFetch()
+*/
+struct VertexFetchStats
+{
+	size_t Bytes = 0; //!< Size of the vertices referenced by the index buffer
+	size_t BytesFetched = 0; //!< Bytes read through the simulated cache, in whole cache lines
+
+	/**
+	 * @brief Bytes fetched per byte of vertex data referenced. 1 is the ideal, each vertex read once.
+	*/
+	float Overfetch() const { return Bytes ? (float)BytesFetched / Bytes : 0.0f; }
+};
+
+/**
+ * @brief Simulates a FIFO post-transform vertex cache drawing the index ranges.
+ * @details The cache is emptied at the start of each range, as each range is its own drawcall.
+ * @param indices Triangle index buffer.
+ * @param ranges Ranges of indices to draw.
+ * @param cache_size Number of vertices the cache holds.
+*/
+VertexCacheStats AnalyzeVertexCache(const unsigned* indices, const std::vector<IndexRange>& ranges, unsigned cache_size = MESH_VERTEX_CACHE_SIZE);
+
+/**
+ * @brief Reorders the triangles within each index range for the post-transform vertex cache.
+ * @details Uses Tom Forsyth's "Linear-Speed Vertex Cache Optimisation": triangles are emitted
+ * greedily by a score that favours vertices recently used (modelled as an LRU cache of 32) and
+ * vertices with few triangles left, so that fans are finished rather than left behind. The
+ * result is good for any cache size and type. Triangles keep their winding, and ranges keep
+ * their place in the buffer. Ranges are optimized in parallel on ThreadPool::Global().
+ * @param[in,out] indices Triangle index buffer.
+ * @param ranges Ranges of indices to optimize, each one independently.
+*/
+void OptimizeVertexCache(unsigned* indices, const std::vector<IndexRange>& ranges);
+
+/**
+ * @brief Reorders clusters of triangles within each index range to reduce overdraw from any view.
+ * @details After OptimizeVertexCache(): each range is cut where its vertex cache order restarts
+ * (a triangle with three new vertices), and those runs are cut further wherever the cache
+ * efficiency so far is within threshold of the run's own. The clusters are then drawn in order
+ * of how far they face out from the centre of the range (Sander, Nehab and Barczak, "Fast
+ * Triangle Reordering for Vertex Locality and Reduced Overdraw"), so outer surfaces tend to be
+ * drawn before the surfaces they hide. The order within clusters is kept. A range keeps its
+ * vertex cache order if the new one costs more than threshold in ACMR, or shades more pixels
+ * from the views of AnalyzeOverdraw() (at a low resolution, with a sample of the clusters).
+ * @param vertices Vertex array the indices refer to (after adding IndexRange::Offset).
+ * @param[in,out] indices Triangle index buffer.
+ * @param ranges Ranges of indices to optimize, each one independently.
+ * @param threshold Largest ACMR increase of a split cluster or a range, e.g. 1.05 for 5%.
+*/
+void OptimizeOverdraw(const Vertex* vertices, unsigned* indices, const std::vector<IndexRange>& ranges, float threshold = MESH_OVERDRAW_THRESHOLD);
+
+/**
+ * @brief Estimates the overdraw of a mesh with a CPU rasterizer.
+ * @details Draws the index ranges in order with back-face culling (counter-clockwise front faces)
+ * and a depth test into a resolution x resolution depth buffer, with orthographic views of the
+ * bounding sphere from 14 directions (the axes and the cube diagonals), and counts the pixels
+ * shaded and covered. Meant for offline measurements, e.g. objbench -overdraw.
+ * @param vertices Vertex array the indices refer to (after adding IndexRange::Offset).
+ * @param vertex_count Number of vertices.
+ * @param indices Triangle index buffer.
+ * @param ranges Ranges of indices to draw.
+ * @param resolution Width and height of the depth buffer.
+*/
+OverdrawStats AnalyzeOverdraw(const Vertex* vertices, size_t vertex_count, const unsigned* indices, const std::vector<IndexRange>& ranges, unsigned resolution = 256);
+
+/**
+ * @brief Simulates vertex fetch through a 16 KB direct-mapped cache of 64-byte lines.
+ * @details Each vertex shader invocation, i.e. each miss of the FIFO post-transform cache as in
+ * AnalyzeVertexCache(), reads the cache lines its vertex lies in. The fetch cache is shared by
+ * the ranges, as they read the same vertex buffer.
+ * @param indices Triangle index buffer.
+ * @param ranges Ranges of indices to draw.
+ * @param vertex_count Number of vertices.
+ * @param vertex_size Size of a vertex in bytes.
+*/
+VertexFetchStats AnalyzeVertexFetch(const unsigned* indices, const std::vector<IndexRange>& ranges, size_t vertex_count, size_t vertex_size = sizeof(Vertex));
+
+/**
+ * @brief Reorders the vertex array into the order the index buffer first uses them.
+ * @details After the triangle order is final, so that vertex fetch reads the vertex buffer
+ * close to sequentially. The indices are rewritten to match and become absolute, i.e.
+ * IndexRange::Offset is set to 0. Vertices no index refers to are removed. Nothing is changed
+ * if AnalyzeVertexFetch() finds that the new order would not fetch fewer bytes.
+ * @param[in,out] vertices Vertex array the indices refer to.
+ * @param[in,out] indices Triangle index buffer.
+ * @param[in,out] ranges Index ranges (drawcalls) within indices.
+ * @param vertex_size Size in bytes of a vertex as it is fetched, e.g. UploadVertexSize.
+ * @return True if the vertices were reordered.
+*/
+bool OptimizeVertexFetch(std::vector<Vertex>& vertices, unsigned* indices, std::vector<IndexRange>& ranges, size_t vertex_size = sizeof(Vertex));
+
+#endif
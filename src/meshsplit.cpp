@@ -0,0 +1,110 @@
+//
+//  Conversion of 32-bit index buffers to 16-bit index buffers
+//
+
+#include <algorithm>
+#include "meshsplit.h"
+
+static const size_t MaxVertices16 = 65536;
+
+bool MakeIndices16(
+	std::vector<Vertex>& vertices,
+	const std::vector<unsigned>& indices,
+	std::vector<IndexRange>& ranges,
+	std::vector<uint16_t>& indices16,
+	bool split)
+{
+	// Lowest vertex of each range, or ~0u if the range spans too many vertices
+	std::vector<unsigned> baseVertices(ranges.size());
+	bool fits = true;
+	for (size_t r = 0; r < ranges.size(); r++)
+	{
+		const IndexRange& range = ranges[r];
+		unsigned lowest = ~0u, highest = 0;
+		for (size_t i = range.Start; i < range.Start + range.Size; i++)
+		{
+			lowest = (std::min)(lowest, indices[i] + range.Offset);
+			highest = (std::max)(highest, indices[i] + range.Offset);
+		}
+		if (!range.Size)
+			lowest = highest = 0;
+
+		baseVertices[r] = highest - lowest < MaxVertices16 ? lowest : ~0u;
+		fits &= baseVertices[r] != ~0u;
+	}
+
+	if (!fits && !split)
+		return false;
+
+	indices16.resize(indices.size());
+
+	if (fits)
+	{
+		for (size_t r = 0; r < ranges.size(); r++)
+		{
+			IndexRange& range = ranges[r];
+			const unsigned shift = baseVertices[r] - range.Offset;
+			for (size_t i = range.Start; i < range.Start + range.Size; i++)
+				indices16[i] = (uint16_t)(indices[i] - shift);
+			range.Offset = baseVertices[r];
+		}
+		return true;
+	}
+
+	// Rebuild the vertex array, one block of at most 65536 vertices per sub-range
+	//
+	std::vector<Vertex> splitVertices;
+	splitVertices.reserve(vertices.size());
+	std::vector<IndexRange> splitRanges;
+
+	// vertex to position in the current block, ~0u if not in the block
+	std::vector<unsigned> blockIndex(vertices.size(), ~0u);
+	std::vector<unsigned> blockVertices;
+
+	for (const IndexRange& range : ranges)
+	{
+		IndexRange block = { range.Start, 0, (unsigned)splitVertices.size(), range.MaterialIndex };
+
+		for (size_t t = range.Start; t + 3 <= range.Start + range.Size; t += 3)
+		{
+			const unsigned* tri = indices.data() + t;
+
+			// start a new block if the triangle's new vertices do not fit
+			size_t newVertices = 0;
+			for (int k = 0; k < 3; k++)
+				newVertices += blockIndex[tri[k] + range.Offset] == ~0u;
+			if (blockVertices.size() + newVertices > MaxVertices16)
+			{
+				splitRanges.push_back(block);
+				block = { (unsigned)t, 0, (unsigned)splitVertices.size(), range.MaterialIndex };
+
+				for (unsigned v : blockVertices)
+					blockIndex[v] = ~0u;
+				blockVertices.clear();
+			}
+
+			for (int k = 0; k < 3; k++)
+			{
+				const unsigned v = tri[k] + range.Offset;
+				if (blockIndex[v] == ~0u)
+				{
+					blockIndex[v] = (unsigned)blockVertices.size();
+					blockVertices.push_back(v);
+					splitVertices.push_back(vertices[v]);
+				}
+				indices16[t + k] = (uint16_t)blockIndex[v];
+			}
+			block.Size += 3;
+		}
+		splitRanges.push_back(block);
+
+		// the next range starts with an empty block
+		for (unsigned v : blockVertices)
+			blockIndex[v] = ~0u;
+		blockVertices.clear();
+	}
+
+	vertices.swap(splitVertices);
+	ranges.swap(splitRanges);
+	return true;
+}
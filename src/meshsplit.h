@@ -0,0 +1,43 @@
+/**
+ * @file meshsplit.h
+ * @brief Conversion of 32-bit index buffers to 16-bit index buffers
+*/
+
+#pragma once
+#ifndef MESHSPLIT_H
+#define MESHSPLIT_H
+
+#include <vector>
+#include <cstdint>
+#include "drawcall.h"
+
+//! Use 16-bit index buffers for meshes where every drawcall fits 65536 vertices
+#define MESH_16BIT_INDICES
+
+//! Split drawcalls that use more than 65536 vertices into sub-drawcalls, so that large meshes can use 16-bit indices too
+#define MESH_SPLIT_FOR_16BIT_INDICES
+
+/**
+ * @brief Expresses a triangle index buffer with 16-bit indices.
+ * @details Every range whose indices lie within 65536 consecutive vertices keeps its
+ * vertices, and its lowest vertex becomes the base vertex (IndexRange::Offset).
+ *
+ * If some range does not fit and split is true, the vertex array is rebuilt: each range
+ * is cut into sub-ranges that use at most 65536 vertices, and the vertices of each
+ * sub-range are stored together in first-use order. Vertices used on both sides of a
+ * cut are duplicated. The index buffer keeps its size and triangle order.
+ * @param[in,out] vertices Vertex array the indices refer to.
+ * @param[in] indices 32-bit triangle indices.
+ * @param[in,out] ranges Index ranges (drawcalls) within indices.
+ * @param[out] indices16 The 16-bit indices, relative to the base vertex of their range.
+ * @param[in] split Allow splitting ranges.
+ * @return False if 32-bit indices are required, in which case nothing is changed.
+*/
+bool MakeIndices16(
+	std::vector<Vertex>& vertices,
+	const std::vector<unsigned>& indices,
+	std::vector<IndexRange>& ranges,
+	std::vector<uint16_t>& indices16,
+	bool split);
+
+#endif
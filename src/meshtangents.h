@@ -0,0 +1,32 @@
+/**
+ * @file meshtangents.h
+ * @brief Tangent space generation for triangle meshes
+*/
+
+#pragma once
+#ifndef MESHTANGENTS_H
+#define MESHTANGENTS_H
+
+#include <cstddef>
+#include "drawcall.h"
+
+/**
+ * @brief Adds the tangent and binormal of a triangle to its three vertices.
+ * @details The vectors are not normalized, so vertices shared by several triangles
+ * accumulate an area weighted sum that is normalized afterwards.
+ * @param v0 First vertex of the triangle.
+ * @param v1 Second vertex.
+ * @param v2 Third vertex.
+*/
+void AddTriangleTangents(Vertex& v0, Vertex& v1, Vertex& v2);
+
+/**
+ * @brief Computes the tangents and binormals of a triangle mesh from its texture coordinates.
+ * @param vertices Vertex array, Tangent and Binormal are overwritten.
+ * @param vertex_count Number of vertices.
+ * @param indices Triangle list indexing vertices.
+ * @param index_count Number of indices.
+*/
+void ComputeTangents(Vertex* vertices, size_t vertex_count, const unsigned* indices, size_t index_count);
+
+#endif
@@ -41,7 +41,7 @@ protected:
 
 	void InitMaterialBuffer();
 	void UpdateMaterialBuffer(vec4f ambient, vec4f diffuse, vec4f specular, int cubeMapMode = 0) const;
-	void compute_TB(Vertex& v0, Vertex& v1, Vertex& v2);
+	static void compute_TB(Vertex& v0, Vertex& v1, Vertex& v2);
 
 public:
 
@@ -60,6 +60,20 @@ public:
 	*/
 	virtual void Render() const = 0;
 
+	/**
+	 * @brief Chooses the level of detail for the next Render(), for models that have several.
+	 * @param model_to_view Transform of the model into view space.
+	 * @param projection Projection matrix.
+	 * @param viewport_height Height of the viewport in pixels.
+	*/
+	virtual void SelectLod(const mat4f& model_to_view, const mat4f& projection, float viewport_height) {}
+
+	/**
+	 * @brief Timings and sizes recorded while the model was loaded.
+	 * @return The report, or nullptr if the model does not keep one.
+	*/
+	virtual const LoadReport* GetLoadReport() const { return nullptr; }
+
 	/**
 	 * @brief Destructor.
 	 * @details Releases the vertex and index buffers of the Model.
@@ -0,0 +1,480 @@
+//
+//  objbench: headless load benchmark for OBJLoader
+//
+//  Usage: objbench [-n runs] [-o report.json] [-overdraw] [-check] file.obj...
+//
+//  Loads each file runs times the way OBJModel does (index buffer, generated normals,
+//  tangents, vertex cache and overdraw order, vertex fetch order, levels of detail,
+//  16-bit indices, compact vertices) and writes a JSON report, to stdout unless -o is given.
+//  -overdraw also estimates the overdraw before and after OptimizeOverdraw() (not timed).
+//  -check also decodes the compact vertices again and reports how far they are from the originals (not timed).
+//  Built without D3D or a window (MESH_HEADLESS), see CMakeLists.txt.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+#include "objloader.h"
+#include "meshtangents.h"
+#include "meshsplit.h"
+#include "meshoptimize.h"
+#include "meshcompact.h"
+#include "meshlod.h"
+#include "threadpool.h"
+
+//
+// Every heap allocation of the process goes through here, so a load can be charged
+// with the number and size of the allocations it made. The nothrow and aligned forms
+// are replaced as well: the library uses them (std::stable_sort takes its buffer with
+// nothrow new) and their memory comes back through the replaced delete. The array
+// forms call these by default.
+//
+static std::atomic<size_t> allocation_count(0);
+static std::atomic<size_t> allocation_bytes(0);
+
+static void* counted_malloc(size_t size)
+{
+	allocation_count++;
+	allocation_bytes += size;
+	return malloc(size ? size : 1);
+}
+
+void* operator new(size_t size)
+{
+	if (void* p = counted_malloc(size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return counted_malloc(size); }
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+
+#ifdef __cpp_aligned_new
+static void* counted_aligned_malloc(size_t size, std::align_val_t alignment)
+{
+	allocation_count++;
+	allocation_bytes += size;
+#ifdef _WIN32
+	return _aligned_malloc(size ? size : 1, (size_t)alignment);
+#else
+	void* p = nullptr;
+	return posix_memalign(&p, (std::max)((size_t)alignment, sizeof(void*)), size ? size : 1) ? nullptr : p;
+#endif
+}
+
+static void aligned_free(void* p)
+{
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	if (void* p = counted_aligned_malloc(size, alignment))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return counted_aligned_malloc(size, alignment); }
+
+void operator delete(void* p, std::align_val_t) noexcept { aligned_free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { aligned_free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { aligned_free(p); }
+#endif
+
+//
+// Largest resident set of the process so far, in bytes
+//
+static size_t peak_rss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return (size_t)usage.ru_maxrss;
+#else
+	return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+/**
+ * @brief Phases of one load, in seconds
+*/
+struct bench_phases_t
+{
+	static const int Count = 13;
+
+	double times[Count] = {};
+
+	double Total() const
+	{
+		double total = 0;
+		for (double time : times)
+			total += time;
+		return total;
+	}
+};
+
+static const char* const phase_names[bench_phases_t::Count] =
+{
+	"parse", "materials", "normals", "weld", "ccw", "sort", "tangents", "vcache", "vfetch", "lods", "indices16", "compact", "copy"
+};
+
+/**
+ * @brief Results for one file
+*/
+struct bench_file_t
+{
+	std::string filename;
+	std::string error;
+	bench_phases_t best; // best time of each phase
+	double bestTotal = 0;
+	double averageTotal = 0;
+	LoadReport report;
+	size_t allocations = 0; // per load
+	size_t allocatedBytes = 0; // per load
+	size_t peakRSS = 0; // of the process, after loading the file
+	float overdrawBefore = 0; // with -overdraw, see AnalyzeOverdraw()
+	float overdrawAfter = 0;
+	bool compactChecked = false; // with -check, see check_compact()
+	float compactPositionError = 0; // largest distance in model units
+	float compactNormalError = 0; // largest angle in degrees
+	float compactTangentError = 0; // largest angle in degrees
+	float compactTexCoordError = 0; // largest difference of a component
+	size_t compactHandednessErrors = 0; // vertices whose binormal flipped
+};
+
+//
+// Angle in degrees between two vectors, 0 if either is zero
+//
+static float angle_between(const vec3f& a, const vec3f& b)
+{
+	const float lengths = a.length() * b.length();
+	if (lengths <= 1e-12f)
+		return 0;
+	const float c = (std::max)(-1.0f, (std::min)(1.0f, dot(a, b) / lengths));
+	return acosf(c) * (180.0f / 3.14159265f);
+}
+
+//
+// Decodes compact vertices like VS_compact and records the largest error against the originals
+//
+static void check_compact(const Vertex* vertices, const CompactVertex* compact, size_t count, const CompactVertexDecode& decode, bench_file_t& result)
+{
+	result.compactChecked = true;
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& v = vertices[i];
+		const Vertex d = DecompressVertex(compact[i], decode);
+		result.compactPositionError = (std::max)(result.compactPositionError, (d.Position - v.Position).length());
+		result.compactNormalError = (std::max)(result.compactNormalError, angle_between(v.Normal, d.Normal));
+		result.compactTangentError = (std::max)(result.compactTangentError, angle_between(v.Tangent, d.Tangent));
+		result.compactTexCoordError = (std::max)(result.compactTexCoordError,
+			(std::max)(fabsf(d.TexCoord.x - v.TexCoord.x), fabsf(d.TexCoord.y - v.TexCoord.y)));
+		if ((dot(v.Normal % v.Tangent, v.Binormal) >= 0) != (dot(d.Normal % d.Tangent, d.Binormal) >= 0))
+			result.compactHandednessErrors++;
+	}
+}
+
+//
+// Loads a file like OBJModel and returns the time of each phase. If overdraw is not nullptr,
+// the overdraw before and after OptimizeOverdraw() is measured into it (and timed with it).
+// If check is not nullptr, the compact vertices are checked into it, see check_compact().
+//
+static bench_phases_t load(const std::string& filename, LoadReport& report, bench_file_t* overdraw, bench_file_t* check)
+{
+	bench_phases_t phases;
+	OBJLoader mesh;
+	mesh.Verbose = false;
+	mesh.Load(filename, true, true, OBJOutput::IndexBuffer);
+	report = mesh.Report;
+
+	LoadTimer timer;
+	ComputeTangents(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size());
+	phases.times[6] = timer.Lap();
+
+#ifdef MESH_OPTIMIZE_VERTEX_CACHE
+	const VertexCacheStats before = AnalyzeVertexCache(mesh.Indices.data(), mesh.IndexRanges);
+	OptimizeVertexCache(mesh.Indices.data(), mesh.IndexRanges);
+#ifdef MESH_OPTIMIZE_OVERDRAW
+	if (overdraw)
+		overdraw->overdrawBefore = AnalyzeOverdraw(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.IndexRanges).Overdraw();
+	OptimizeOverdraw(mesh.Vertices.data(), mesh.Indices.data(), mesh.IndexRanges);
+	if (overdraw)
+		overdraw->overdrawAfter = AnalyzeOverdraw(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.IndexRanges).Overdraw();
+#endif
+	const VertexCacheStats after = AnalyzeVertexCache(mesh.Indices.data(), mesh.IndexRanges);
+	report.ACMRBefore = before.ACMR();
+	report.ACMRAfter = after.ACMR();
+	report.ATVRBefore = before.ATVR();
+	report.ATVRAfter = after.ATVR();
+#endif
+	phases.times[7] = timer.Lap();
+
+#ifdef MESH_OPTIMIZE_VERTEX_FETCH
+	// for the vertices as OBJModel uploads them, see MESH_COMPACT_VERTICES
+	report.OverfetchBefore = AnalyzeVertexFetch(mesh.Indices.data(), mesh.IndexRanges, mesh.Vertices.size(), UploadVertexSize).Overfetch();
+	OptimizeVertexFetch(mesh.Vertices, mesh.Indices.data(), mesh.IndexRanges, UploadVertexSize);
+	report.OverfetchAfter = AnalyzeVertexFetch(mesh.Indices.data(), mesh.IndexRanges, mesh.Vertices.size(), UploadVertexSize).Overfetch();
+#endif
+	phases.times[8] = timer.Lap();
+
+#ifdef MESH_GENERATE_LODS
+	std::vector<MeshLod> lods = GenerateLods(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices, mesh.IndexRanges);
+	for (const MeshLod& lod : lods)
+	{
+		size_t triangles = 0;
+		for (const IndexRange& range : lod.IndexRanges)
+			triangles += range.Size / 3;
+		report.Lods.push_back({ triangles, lod.Error });
+	}
+	std::vector<IndexRange> ranges = GatherLodRanges(mesh.IndexRanges, lods);
+#else
+	std::vector<IndexRange>& ranges = mesh.IndexRanges;
+#endif
+	phases.times[9] = timer.Lap();
+
+	std::vector<uint16_t> indices16;
+	const void* indices = mesh.Indices.data();
+	size_t indexBytes = mesh.Indices.size() * sizeof(unsigned);
+#ifdef MESH_16BIT_INDICES
+	bool split = false;
+#ifdef MESH_SPLIT_FOR_16BIT_INDICES
+	split = true;
+#endif
+	if (MakeIndices16(mesh.Vertices, mesh.Indices, ranges, indices16, split))
+	{
+		indices = indices16.data();
+		indexBytes = indices16.size() * sizeof(uint16_t);
+	}
+#endif
+	phases.times[10] = timer.Lap();
+
+	const void* vertices = mesh.Vertices.data();
+	size_t vertexBytes = mesh.Vertices.size() * sizeof(Vertex);
+#ifdef MESH_COMPACT_VERTICES
+	std::vector<CompactVertex> compactVertices(mesh.Vertices.size());
+	const CompactVertexDecode decode = CompressVertices(mesh.Vertices.data(), mesh.Vertices.size(), compactVertices.data());
+	vertices = compactVertices.data();
+	vertexBytes = compactVertices.size() * sizeof(CompactVertex);
+	if (check)
+		check_compact(mesh.Vertices.data(), compactVertices.data(), compactVertices.size(), decode, *check);
+#endif
+	phases.times[11] = timer.Lap();
+
+	// Stands in for the buffer upload
+	std::vector<char> staging(vertexBytes + indexBytes);
+	if (!staging.empty())
+	{
+		memcpy(staging.data(), vertices, vertexBytes);
+		memcpy(staging.data() + vertexBytes, indices, indexBytes);
+	}
+	phases.times[12] = timer.Lap();
+
+	phases.times[0] = report.ParseTime;
+	phases.times[1] = report.MaterialTime;
+	phases.times[2] = report.NormalTime;
+	phases.times[3] = report.WeldTime;
+	phases.times[4] = report.CCWTime;
+	phases.times[5] = report.SortTime;
+	return phases;
+}
+
+static bench_file_t bench_file(const std::string& filename, int runs, bool overdraw, bool check)
+{
+	bench_file_t result;
+	result.filename = filename;
+	double total = 0;
+	try
+	{
+		// Measuring overdraw takes longer than loading, so it gets a load of its own that is not timed
+		if (overdraw || check)
+			load(filename, result.report, overdraw ? &result : nullptr, check ? &result : nullptr);
+
+		for (int run = 0; run < runs; run++)
+		{
+			const size_t count = allocation_count;
+			const size_t bytes = allocation_bytes;
+			LoadTimer timer;
+			const bench_phases_t phases = load(filename, result.report, nullptr, nullptr);
+			const double time = timer.Lap();
+			result.allocations = allocation_count - count;
+			result.allocatedBytes = allocation_bytes - bytes;
+
+			for (int p = 0; p < bench_phases_t::Count; p++)
+				result.best.times[p] = run ? (std::min)(result.best.times[p], phases.times[p]) : phases.times[p];
+			result.bestTotal = run ? (std::min)(result.bestTotal, time) : time;
+			total += time;
+		}
+		result.averageTotal = runs ? total / runs : 0;
+	}
+	catch (const std::exception& e)
+	{
+		result.error = e.what();
+	}
+	result.peakRSS = peak_rss();
+	return result;
+}
+
+//
+// Writes s as a JSON string
+//
+static void write_string(FILE* out, const std::string& s)
+{
+	fputc('"', out);
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+			fprintf(out, "\\%c", c);
+		else if ((unsigned char)c < 0x20)
+			fprintf(out, "\\u%04x", c);
+		else
+			fputc(c, out);
+	}
+	fputc('"', out);
+}
+
+static void write_report(FILE* out, const std::vector<bench_file_t>& files, int runs)
+{
+	fprintf(out, "{\n");
+	fprintf(out, "  \"runs\": %d,\n", runs);
+	fprintf(out, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+	fprintf(out, "  \"loader_threads\": %u,\n", ThreadPool::Global().Concurrency());
+	fprintf(out, "  \"vertex_bytes\": %zu,\n", sizeof(Vertex));
+#ifdef MESH_COMPACT_VERTICES
+	fprintf(out, "  \"compact_vertex_bytes\": %zu,\n", sizeof(CompactVertex));
+#endif
+	fprintf(out, "  \"vertex_cache_size\": %d,\n", MESH_VERTEX_CACHE_SIZE);
+	fprintf(out, "  \"files\": [");
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		const bench_file_t& file = files[i];
+		const LoadReport& report = file.report;
+		fprintf(out, "%s\n    {\n      \"file\": ", i ? "," : "");
+		write_string(out, file.filename);
+		if (!file.error.empty())
+		{
+			fprintf(out, ",\n      \"error\": ");
+			write_string(out, file.error);
+			fprintf(out, "\n    }");
+			continue;
+		}
+		const double seconds = file.bestTotal > 0 ? file.bestTotal : 1e-9;
+		fprintf(out, ",\n      \"bytes\": %zu,\n", report.FileBytes);
+		fprintf(out, "      \"vertices\": %zu,\n", report.Vertices);
+		fprintf(out, "      \"triangles\": %zu,\n", report.Triangles);
+		fprintf(out, "      \"drawcalls\": %zu,\n", report.Drawcalls);
+		fprintf(out, "      \"materials\": %zu,\n", report.Materials);
+		fprintf(out, "      \"best_s\": %.6f,\n", file.bestTotal);
+		fprintf(out, "      \"average_s\": %.6f,\n", file.averageTotal);
+		fprintf(out, "      \"mb_per_s\": %.2f,\n", report.FileBytes / seconds / (1 << 20));
+		fprintf(out, "      \"vertices_per_s\": %.0f,\n", report.Vertices / seconds);
+		fprintf(out, "      \"phases_s\": {");
+		for (int p = 0; p < bench_phases_t::Count; p++)
+			fprintf(out, "%s\"%s\": %.6f", p ? ", " : " ", phase_names[p], file.best.times[p]);
+		fprintf(out, " },\n");
+		fprintf(out, "      \"acmr\": [%.4f, %.4f],\n", report.ACMRBefore, report.ACMRAfter);
+		fprintf(out, "      \"atvr\": [%.4f, %.4f],\n", report.ATVRBefore, report.ATVRAfter);
+		fprintf(out, "      \"overfetch\": [%.4f, %.4f],\n", report.OverfetchBefore, report.OverfetchAfter);
+		fprintf(out, "      \"lods\": [");
+		for (size_t l = 0; l < report.Lods.size(); l++)
+			fprintf(out, "%s{ \"triangles\": %zu, \"error\": %g }", l ? ", " : "", report.Lods[l].Triangles, report.Lods[l].Error);
+		fprintf(out, "],\n");
+		if (file.overdrawBefore > 0)
+			fprintf(out, "      \"overdraw\": [%.4f, %.4f],\n", file.overdrawBefore, file.overdrawAfter);
+		if (file.compactChecked)
+			fprintf(out, "      \"compact_error\": { \"position\": %g, \"normal_deg\": %.4f, \"tangent_deg\": %.4f, \"texcoord\": %g, \"handedness\": %zu },\n",
+				file.compactPositionError, file.compactNormalError, file.compactTangentError, file.compactTexCoordError, file.compactHandednessErrors);
+		fprintf(out, "      \"allocations\": %zu,\n", file.allocations);
+		fprintf(out, "      \"allocated_bytes\": %zu,\n", file.allocatedBytes);
+		fprintf(out, "      \"temp_bytes\": %zu,\n", report.TempBytes);
+		fprintf(out, "      \"peak_rss_bytes\": %zu\n", file.peakRSS);
+		fprintf(out, "    }");
+	}
+	fprintf(out, "\n  ],\n");
+	fprintf(out, "  \"peak_rss_bytes\": %zu\n", peak_rss());
+	fprintf(out, "}\n");
+}
+
+int main(int argc, char** argv)
+{
+	int runs = 5;
+	const char* output = nullptr;
+	bool overdraw = false;
+	bool check = false;
+	std::vector<std::string> filenames;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			runs = (std::max)(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+			output = argv[++i];
+		else if (!strcmp(argv[i], "-overdraw"))
+			overdraw = true;
+		else if (!strcmp(argv[i], "-check"))
+			check = true;
+		else
+			filenames.push_back(argv[i]);
+	}
+	if (filenames.empty())
+	{
+		fprintf(stderr, "Usage: objbench [-n runs] [-o report.json] [-overdraw] [-check] file.obj...\n");
+		return 2;
+	}
+
+	std::vector<bench_file_t> files;
+	bool failed = false;
+	for (auto& filename : filenames)
+	{
+		fprintf(stderr, "%s\n", filename.c_str());
+		files.push_back(bench_file(filename, runs, overdraw, check));
+		if (!files.back().error.empty())
+		{
+			fprintf(stderr, "  failed: %s\n", files.back().error.c_str());
+			failed = true;
+		}
+		else if (files.back().compactHandednessErrors)
+		{
+			fprintf(stderr, "  failed: %zu compact vertices changed handedness\n", files.back().compactHandednessErrors);
+			failed = true;
+		}
+	}
+
+	FILE* out = stdout;
+	if (output && !(out = fopen(output, "w")))
+	{
+		fprintf(stderr, "Failed to write %s\n", output);
+		return 1;
+	}
+	write_report(out, files, runs);
+	if (out != stdout)
+		fclose(out);
+	return failed ? 1 : 0;
+}
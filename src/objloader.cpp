@@ -5,16 +5,23 @@
 //  Carl Johan Gribel 2016-2021, cjgribel@gmail.com
 //
 
-#include <fstream>
 #include <algorithm>
-#include "OBJLoader.h"
+#include <climits>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include "objloader.h"
 #include "vec/vec.h"
 #include "parseutil.h"
+#include "mappedfile.h"
+#include "threadpool.h"
+#include "weldtable.h"
+#include "arena.h"
 
 using namespace linalg;
 
 //
-// Auxiliary structs for raw file data
+// Auxiliary structs for raw file data, kept in the LoadArena of the load
 //
 struct unwelded_triangle_t { int vi[9]; };
 struct unwelded_quad_t { int vi[12]; };
@@ -22,11 +29,38 @@ struct unwelded_drawcall_t
 {
 	std::string material_name;
 	std::string group_name;
-	std::vector<unwelded_triangle_t> tris;
-	std::vector<unwelded_quad_t> quads;
+	ArenaVector<unwelded_triangle_t> tris;
+	ArenaVector<unwelded_quad_t> quads;
 	int vertex_offset = 0;
+	bool streamed = false;	// handed to OnDrawcallParsed while the file was parsed
+
+	// Smoothing group changes in face order: triangles from index tri and
+	// quads from index quad on use group (0 = off)
+	struct smoothing_span_t { unsigned tri, quad; int group; };
+	ArenaVector<smoothing_span_t> smoothing;
+
+	explicit unwelded_drawcall_t(LoadArena* arena) :
+		tris(ArenaAllocator<unwelded_triangle_t>(arena)),
+		quads(ArenaAllocator<unwelded_quad_t>(arena)),
+		smoothing(ArenaAllocator<smoothing_span_t>(arena)) {}
 };
 
+//
+// Force counter-clockwise:
+// flip triangle if geometric normal points away from vertex normal (at index=0)
+//
+static inline void forceCCW(const Vertex* vertices, unsigned* tri)
+{
+	int a = tri[0], b = tri[1], c = tri[2];
+	vec3f v0 = vertices[a].Position, v1 = vertices[b].Position, v2 = vertices[c].Position;
+
+	vec3f geo_n = linalg::normalize((v1 - v0) % (v2 - v0));
+	vec3f vert_n = vertices[a].Normal;
+
+	if (linalg::dot(geo_n, vert_n) < 0)
+		std::swap(tri[0], tri[1]);
+}
+
 //
 // Creates normals to a set of Vertices by averaging the 
 // geometric normals of the faces they belong to
@@ -34,372 +68,1026 @@ struct unwelded_drawcall_t
 // If a model lacks normals, this function can be used 
 // to create them. Works best for relatively smooth models.
 //
-void GenerateNormals(
-	const std::vector<vec3f>& v, 
-	std::vector<vec3f>& vn, 
-	std::vector<unwelded_drawcall_t>& drawcalls)
+// Face normals are weighted by the area of the face. Faces share a normal at a position
+// only if they are in the same smoothing group; faces with smoothing
+// off (group 0) get their own flat normals.
+//
+// Instead of one bin per vertex, the face corners around each position are
+// gathered in a single flat (CSR) array. Every position is then handled by
+// exactly one task, which averages its normals and writes the normal index
+// of its corners, so the parallel passes need no atomics.
+//
+static void GenerateNormals(
+	const ArenaVector<vec3f>& v, 
+	ArenaVector<vec3f>& vn, 
+	ArenaVector<unwelded_drawcall_t>& drawcalls,
+	LoadArena& arena)
 {
-	std::vector<std::vector<vec3f>> v_bin(v.size());
+	ThreadPool& threadPool = ThreadPool::Global();
+
+	// Faces are numbered drawcall by drawcall, triangles before quads.
+	// A segment is a run of faces of one type, stored in one array.
+	struct face_segment_t
+	{
+		size_t first_face;
+		size_t face_count;
+		int* vi;		// index array of the first face
+		int stride;		// ints per face
+		int corners;	// 3 or 4
+		const unwelded_drawcall_t* drawcall;
+	};
+	ArenaVector<face_segment_t> segments(&arena);
+	size_t faceCount = 0;
+	for (auto& dc : drawcalls)
+	{
+		if (dc.tris.size())
+			segments.push_back({ faceCount, dc.tris.size(), dc.tris[0].vi, 9, 3, &dc });
+		faceCount += dc.tris.size();
+		if (dc.quads.size())
+			segments.push_back({ faceCount, dc.quads.size(), dc.quads[0].vi, 12, 4, &dc });
+		faceCount += dc.quads.size();
+	}
+	if (!faceCount)
+		return;
+
+	auto findSegment = [&](size_t face)
+	{
+		return std::upper_bound(segments.begin(), segments.end(), face,
+			[](size_t f, const face_segment_t& seg) { return f < seg.first_face; }) - 1;
+	};
+
+	auto position = [&](int i) { return (size_t)i < v.size() ? v[i] : vec3f_zero; };
 
-	// bin normals from all faces to vertex bins
-	for (unwelded_drawcall_t& dc : drawcalls)
+	// normalize() returns zero below a fixed length, which small models reach
+	auto unit = [](const vec3f& n)
 	{
-		for (unwelded_triangle_t& tri : dc.tris)
+		float length_squared = n.length_squared();
+		return length_squared > 0.0f ? n * (1.0f / sqrtf(length_squared)) : n;
+	};
+
+	// Faces and positions are processed in blocks, each block by one task
+	const size_t BlockSize = 1 << 14;
+	auto blocks = [&](size_t count) { return (count + BlockSize - 1) / BlockSize; };
+
+	// Face normals, as long as twice the area of the face, and smoothing groups
+	//
+	ArenaVector<vec3f> faceNormals(faceCount, &arena);
+	ArenaVector<int> faceGroups(faceCount, &arena);
+	threadPool.ParallelFor(blocks(faceCount), [&](size_t block)
+	{
+		const size_t last = (std::min)(faceCount, (block + 1) * BlockSize);
+		for (size_t face = block * BlockSize; face < last; )
 		{
-			int a = tri.vi[0], b = tri.vi[1], c = tri.vi[2];
-			vec3f v0 = v[a], v1 = v[b], v2 = v[c];
-			vec3f n = linalg::normalize((v1 - v0) % (v2 - v0));
+			const face_segment_t& seg = *findSegment(face);
+			const auto& spans = seg.drawcall->smoothing;
+			const size_t segmentLast = (std::min)(last, seg.first_face + seg.face_count);
 
-			v_bin[a].push_back(n);
-			v_bin[b].push_back(n);
-			v_bin[c].push_back(n);
+			// last span that starts at or before the face
+			size_t i = face - seg.first_face;
+			auto spanStart = [&](size_t s) { return seg.corners == 3 ? spans[s].tri : spans[s].quad; };
+			size_t span = 0;
+			while (span + 1 < spans.size() && spanStart(span + 1) <= i)
+				span++;
 
-			memcpy(tri.vi + 3, tri.vi, 3 * sizeof(int));
+			for (; face < segmentLast; face++, i++)
+			{
+				const int* vi = seg.vi + i * seg.stride;
+				if (seg.corners == 3)
+				{
+					vec3f v0 = position(vi[0]), v1 = position(vi[1]), v2 = position(vi[2]);
+					faceNormals[face] = (v1 - v0) % (v2 - v0);
+				}
+				else
+				{
+					vec3f v0 = position(vi[0]), v1 = position(vi[1]), v2 = position(vi[2]), v3 = position(vi[3]);
+					faceNormals[face] = (v2 - v0) % (v3 - v1);
+				}
+
+				while (span + 1 < spans.size() && spanStart(span + 1) <= i)
+					span++;
+				faceGroups[face] = spans.size() ? spans[span].group : 0;
+			}
 		}
-	}
+	});
 
-	// average binned normals and add to array
+	// Corners around each position (counting sort into a CSR array).
+	// Corners are referenced as face * 4 + corner.
+	//
+	ArenaVector<unsigned> cornerStart(v.size() + 1, 0, &arena);
+	for (auto& seg : segments)
+		for (size_t f = 0; f < seg.face_count; f++)
+			for (int k = 0; k < seg.corners; k++)
+			{
+				unsigned i = (unsigned)seg.vi[f * seg.stride + k];
+				if (i < v.size())
+					cornerStart[i + 1]++;
+			}
 	for (size_t i = 0; i < v.size(); i++)
+		cornerStart[i + 1] += cornerStart[i];
+
+	ArenaVector<unsigned> corners(cornerStart.back(), &arena);
 	{
-		vec3f n = vec3f_zero;
-		for (size_t j = 0; j < v_bin[i].size(); j++)
+		ArenaVector<unsigned> fill(cornerStart.begin(), cornerStart.end() - 1, &arena);
+		for (auto& seg : segments)
+			for (size_t f = 0; f < seg.face_count; f++)
+				for (int k = 0; k < seg.corners; k++)
+				{
+					unsigned i = (unsigned)seg.vi[f * seg.stride + k];
+					if (i < v.size())
+						corners[fill[i]++] = (unsigned)(seg.first_face + f) * 4 + k;
+				}
+	}
+
+	auto group = [&](unsigned corner) { return faceGroups[corner / 4]; };
+
+	// Count the normals of each position: one per smoothing group,
+	// plus one per corner with smoothing off
+	//
+	ArenaVector<unsigned> normalStart(v.size() + 1, 0, &arena);
+	threadPool.ParallelFor(blocks(v.size()), [&](size_t block)
+	{
+		const size_t last = (std::min)(v.size(), (block + 1) * BlockSize);
+		for (size_t i = block * BlockSize; i < last; i++)
 		{
-			n += v_bin[i][j];
+			unsigned* first = corners.data() + cornerStart[i];
+			unsigned* end = corners.data() + cornerStart[i + 1];
+			if (first == end)
+				continue;
+
+			// order corners by group, so faces of one group are adjacent
+			const int g = group(*first);
+			if (std::any_of(first, end, [&](unsigned c) { return group(c) != g; }))
+				std::stable_sort(first, end, [&](unsigned a, unsigned b) { return group(a) < group(b); });
+
+			unsigned count = 0;
+			for (unsigned* c = first; c != end; c++)
+				if (c == first || !group(*c) || group(*c) != group(*(c - 1)))
+					count++;
+			normalStart[i + 1] = count;
 		}
-		n = linalg::normalize(n);
+	});
+	for (size_t i = 0; i < v.size(); i++)
+		normalStart[i + 1] += normalStart[i];
 
-		vn.push_back(n);
-	}
+	// Average the face normals and write the normal index of every corner
+	//
+	const size_t normalBase = vn.size();
+	vn.resize(normalBase + normalStart.back());
+	threadPool.ParallelFor(blocks(v.size()), [&](size_t block)
+	{
+		const size_t last = (std::min)(v.size(), (block + 1) * BlockSize);
+		for (size_t i = block * BlockSize; i < last; i++)
+		{
+			const unsigned* first = corners.data() + cornerStart[i];
+			const unsigned* end = corners.data() + cornerStart[i + 1];
+			size_t normal = normalBase + normalStart[i];
+
+			for (const unsigned* c = first; c != end; normal++)
+			{
+				// run of corners sharing this normal
+				const unsigned* run_end = c + 1;
+				if (group(*c))
+					while (run_end != end && group(*run_end) == group(*c))
+						run_end++;
+
+				vec3f n = vec3f_zero;
+				for (; c != run_end; c++)
+				{
+					const size_t face = *c / 4;
+					const int k = *c % 4;
+					const face_segment_t& seg = *findSegment(face);
+					int* vi = seg.vi + (face - seg.first_face) * seg.stride;
+
+					n += faceNormals[face];
+					vi[seg.corners + k] = (int)normal;
+				}
+				vn[normal] = unit(n);
+			}
+		}
+	});
 }
 
 void OBJLoader::LoadMaterials(
 	std::string path, 
 	std::string filename, 
-	MaterialHash &mtl_hash)
+	ArenaHashMap<std::string, Material> &mtl_hash)
 {
-    std::string fullpath = path+filename;
-    
-    std::ifstream in(fullpath.c_str());
-    if (!in)
-        throw std::runtime_error(std::string("Failed to open ") + fullpath);
-    std::cout << "Opened " << fullpath << "\n";
-    
-    std::string line;
-	line.reserve(1024);
-    Material *current_mtl = NULL;
-    
-    while (std::getline(in, line, '\n'))
-    {
-		const int MaxChars = 1024;
-		char str0[MaxChars] = { 0 }; // , str1[MaxChars];
-        float a,b,c;
-        
-		lrtrim(line);
-        if (sscanf_s(line.c_str(), "newmtl %s", str0, MaxChars) == 1)
-        {
-            // check for duplicate
-            if (mtl_hash.find(str0) != mtl_hash.end() ) printf("Warning: duplicate material '%s'\n", str0);
-            
-            mtl_hash[str0] = Material();
-            current_mtl = &mtl_hash[str0];
-            current_mtl->Name = str0;
-        }
-        else if (!current_mtl)
-        {
-            // no parsed material so can't add any content
-            continue;
-        }
-        else if (sscanf_s(line.c_str(), "map_Kd %[^\n]", str0, MaxChars) == 1)
-        {
-            // search for the image file and ignore the rest
-            std::string mapfile;
-			if (find_filename_from_suffixes(str0, ALLOWED_TEXTURE_SUFFIXES, mapfile))
-                current_mtl->DiffuseTextureFilename = path + mapfile;
-            else
-                throw std::runtime_error(std::string("Error: no allowed format found for 'map_Kd' in material ") + current_mtl->Name);
-        }
-		else if(sscanf_s(line.c_str(), "map_Ks %[^\n]", str0, MaxChars) == 1)
-		{
-			// search for the image file and ignore the rest
-			std::string mapfile;
-			if(find_filename_from_suffixes(str0, ALLOWED_TEXTURE_SUFFIXES, mapfile))
-				current_mtl->SpecularTextureFilename = path + mapfile;
-			else
-				throw std::runtime_error(std::string("Error: no allowed format found for 'map_Ks' in material ") + current_mtl->Name);
-		}
-        else if (sscanf_s(line.c_str(), "map_bump %[^\n]", str0, MaxChars) == 1)
-        {
-            // search for the image file and ignore the rest
-            std::string mapfile;
-			if (find_filename_from_suffixes(str0, ALLOWED_TEXTURE_SUFFIXES, mapfile))
-                current_mtl->NormalTextureFilename = path+mapfile;
-            else
-                throw std::runtime_error(std::string("Error: no allowed format found for 'map_bump' in material ") + current_mtl->Name);
-        }
-		////EXTENSION: Cube map
-  //      else if (sscanf_s(line.c_str(), "map_cube %[^\n]", str0, MaxChars) == 1)
-  //      {
-  //          // search for the image file and ignore the rest
-  //          std::string mapfile;
-		//	if (find_filename_from_suffixes(str0, ALLOWED_TEXTURE_SUFFIXES, mapfile))
-  //              current_mtl->CubeMapTextureFilename = path+mapfile;
-  //          else
-  //              throw std::runtime_error(std::string("Error: no allowed format found for 'map_cube' in material ") + current_mtl->Name);
-  //      }
-        else if (sscanf_s(line.c_str(), "bump %[^\n]", str0, MaxChars) == 1)
-        {
-            // search for the image file and ignore the rest
-            std::string mapfile;
-			if (find_filename_from_suffixes(str0, ALLOWED_TEXTURE_SUFFIXES, mapfile))
-                current_mtl->NormalTextureFilename = path+mapfile;
-            else
-                throw std::runtime_error(std::string("Error: no allowed format found for 'bump' in material ") + current_mtl->Name);
-        }
-        else if (sscanf_s(line.c_str(), "Ka %f %f %f", &a, &b, &c) == 3)
-        {
-            current_mtl->AmbientColour = vec3f(a, b, c);
-        }
-        else if (sscanf_s(line.c_str(), "Kd %f %f %f", &a, &b, &c) == 3)
-        {
-            current_mtl->DiffuseColour = vec3f(a, b, c);
-        }
-        else if (sscanf_s(line.c_str(), "Ks %f %f %f", &a, &b, &c) == 3)
-        {
-            current_mtl->SpecularColour = vec3f(a, b, c);
-        }
-    }
-    in.close();
+	std::string fullpath = path+filename;
+
+	MappedFile file;
+	if (!file.Open(fullpath))
+		throw std::runtime_error(std::string("Failed to open ") + fullpath);
+	if (Verbose)
+		std::cout << "Opened " << fullpath << "\n";
+
+	Material *current_mtl = NULL;
+	std::string token;
+
+	// Texture map: the image file is searched for in the rest of the line and the options are ignored
+	auto parseMap = [&](const char* q, const char* end, const char* keyword, std::string& texture_filename)
+	{
+		q = skip_blanks(q, end);
+		const char* line_end = std::find(q, end, '\n');
+		while (line_end > q && (line_end[-1] == ' ' || line_end[-1] == '\t' || line_end[-1] == '\r'))
+			line_end--;
+		if (q == line_end)
+			return;
+
+		std::string mapfile;
+		if (find_filename_from_suffixes(std::string(q, line_end), ALLOWED_TEXTURE_SUFFIXES, mapfile))
+			texture_filename = path + mapfile;
+		else
+			throw std::runtime_error(std::string("Error: no allowed format found for '") + keyword + "' in material " + current_mtl->Name);
+	};
+
+	// Colour: three floats
+	auto parseColour = [](const char* q, const char* end, vec3f& colour)
+	{
+		float a, b, c;
+		if (parse_float(q = skip_blanks(q, end), end, a) &&
+			parse_float(q = skip_blanks(q, end), end, b) &&
+			parse_float(q = skip_blanks(q, end), end, c))
+			colour = vec3f(a, b, c);
+	};
+
+	const char* end = file.Data() + file.Size();
+	for (const char* p = file.Data(); p < end; p = skip_line(p, end))
+	{
+		p = skip_blanks(p, end);
+		const char* q;
+
+		if ((q = match_keyword(p, end, "newmtl")))
+		{
+			if (!parse_token(q, end, token))
+				continue;
+
+			// check for duplicate
+			if (mtl_hash.find(token) != mtl_hash.end()) fprintf(stderr, "Warning: duplicate material '%s'\n", token.c_str());
+
+			current_mtl = &mtl_hash[token];
+			*current_mtl = Material();
+			current_mtl->Name = token;
+		}
+		else if (!current_mtl)
+		{
+			// no parsed material so can't add any content
+			continue;
+		}
+		else if ((q = match_keyword(p, end, "map_Kd")))
+			parseMap(q, end, "map_Kd", current_mtl->DiffuseTextureFilename);
+		else if ((q = match_keyword(p, end, "map_Ks")))
+			parseMap(q, end, "map_Ks", current_mtl->SpecularTextureFilename);
+		else if ((q = match_keyword(p, end, "map_bump")))
+			parseMap(q, end, "map_bump", current_mtl->NormalTextureFilename);
+		else if ((q = match_keyword(p, end, "bump")))
+			parseMap(q, end, "bump", current_mtl->NormalTextureFilename);
+		// + other map types here, e.g. map_cube - see Material class
+		else if ((q = match_keyword(p, end, "Ka")))
+			parseColour(q, end, current_mtl->AmbientColour);
+		else if ((q = match_keyword(p, end, "Kd")))
+			parseColour(q, end, current_mtl->DiffuseColour);
+		else if ((q = match_keyword(p, end, "Ks")))
+			parseColour(q, end, current_mtl->SpecularColour);
+	}
 }
 
-void OBJLoader::Load(
-	const std::string& filename,
-	bool auto_generate_normals,
-	bool triangulate)
+//
+// Raw data parsed from one newline-aligned chunk of an obj file.
+// Chunks are parsed independently and merged in file order, so everything
+// that depends on what came before the chunk is recorded for the merge.
+//
+struct obj_chunk_t
 {
-	std::string parentDirectory = get_parentdir(filename);
+	// A negative (relative) face index that was resolved against the counts
+	// of this chunk. The chunk's base offset is added when merging.
+	struct relative_index_t
+	{
+		unsigned drawcall;
+		unsigned face;
+		unsigned char slot;
+		bool quad;
+	};
 
-	std::ifstream in(filename.c_str());
-	if (!in) throw std::runtime_error(std::string("Failed to open ") + filename);
-	std::cout << "Opened " << filename << "\n";
+	// Skinning offsets that depend on state from earlier chunks
+	static const int OffsetInherit = -1;	// offset active when the chunk starts
+	static const int OffsetChunkStart = -2;	// chunk start if a face section is active, else as above
 
-	// raw data from obj
-	std::vector<vec3f> fileVertices, fileNormals;
-	std::vector<vec2f> fileTexcoords;
-	std::vector<unwelded_drawcall_t> fileDrawcalls;
-	MaterialHash fileMaterials;
+	LoadArena* arena;
+	const char* begin = nullptr;
+	const char* end = nullptr;
 
-	std::string currentGroupName;
-	unwelded_drawcall_t defaultDrawcall;
-	unwelded_drawcall_t* currentDrawcall = &defaultDrawcall;
-	int lastOffset = 0; bool faceSection = false; // info for skin weight mapping
+	ArenaVector<vec3f> vertices, normals;
+	ArenaVector<vec2f> texcoords;
+
+	// drawcalls[0] continues the drawcall active when the chunk starts,
+	// the rest are started by usemtl within the chunk
+	ArenaVector<unwelded_drawcall_t> drawcalls;
+	size_t drawcalls_before_group = 0;	// new drawcalls that use the group active when the chunk starts
+
+	std::vector<std::string> mtllibs;
+	ArenaVector<relative_index_t> relative_indices;
+
+	bool group_set = false;
+	std::string group_name;
+
+	int last_offset = OffsetInherit;
+	int face_section = -1;	// -1: inherit, 0: false, 1: true
 
-	char readBuffer[256]{};
+	// Smoothing group, SmoothingInherit until the chunk has an s directive
+	static const int SmoothingInherit = -1;
+	int smoothing_group = SmoothingInherit;
 
-	while (in.getline(readBuffer, 256, '\n'))
+	explicit obj_chunk_t(LoadArena* arena) :
+		arena(arena), vertices(arena), normals(arena), texcoords(arena), drawcalls(arena), relative_indices(arena) {}
+};
+
+//
+// Element counts of a chunk, taken by a quick pass over its lines before it is
+// parsed, so the arrays of the chunk are allocated once at their final size.
+// Malformed lines are counted too, so the counts are upper bounds.
+//
+struct obj_chunk_counts_t
+{
+	size_t vertices = 0, normals = 0, texcoords = 0;
+
+	// faces of each drawcall of the chunk, see obj_chunk_t::drawcalls
+	struct faces_t { size_t tris, quads; };
+	ArenaVector<faces_t> drawcalls;
+
+	explicit obj_chunk_counts_t(LoadArena* arena) : drawcalls(arena) {}
+};
+
+static void prescan_obj_chunk(const obj_chunk_t& chunk, bool triangulate, obj_chunk_counts_t& counts)
+{
+	counts.drawcalls.assign(1, { 0, 0 });
+
+	const char* end = chunk.end;
+	for (const char* p = chunk.begin; p < end; p = skip_line(p, end))
 	{
-		const int MaxChars = 1024;
-		float x, y, z;
-		int a[3]{}, b[3]{}, c[3]{}, d[3]{};
-		char str[MaxChars];
+		p = skip_blanks(p, end);
+		if (end - p < 2)
+			continue;
 
-		if (readBuffer[0] == ' ')
+		const char* q;
+		if (p[0] == 'v')
 		{
-			continue;
+			if (p[1] == ' ' || p[1] == '\t') counts.vertices++;
+			else if (p[1] == 'n') counts.normals++;
+			else if (p[1] == 't') counts.texcoords++;
 		}
+		else if ((q = match_keyword(p, end, "f")))
+		{
+			// count the corners, faces are triangulated as in parse_obj_chunk
+			size_t corners = 0;
+			for (q = skip_blanks(q, end); !is_line_end(q, end); q = skip_blanks(q, end), corners++)
+				while (q < end && *q != ' ' && *q != '\t' && *q != '\r' && *q != '\n')
+					q++;
+
+			auto& faces = counts.drawcalls.back();
+			if (corners == 4 && !triangulate)
+				faces.quads++;
+			else if (corners >= 3)
+				faces.tris += corners - 2;
+		}
+		else if ((q = match_keyword(p, end, "usemtl")))
+		{
+			q = skip_blanks(q, end);
+			if (q < end && *q != '\n')
+				counts.drawcalls.push_back({ 0, 0 });
+		}
+	}
+}
+
+//
+// Resolves a 1-based (or negative, relative) OBJ index to a 0-based index, 
+// given the number of elements read so far. Missing indices become -1.
+//
+static inline int resolve_index(int index, size_t count)
+{
+	if (index > 0) return index - 1;
+	if (index < 0) return (int)count + index;
+	return -1;
+}
+
+//
+// Parses the lines in [chunk.begin, chunk.end).
+// Does not touch any shared state so chunks can be parsed concurrently.
+//
+static void parse_obj_chunk(obj_chunk_t& chunk, bool triangulate)
+{
+	obj_chunk_counts_t counts(chunk.arena);
+	prescan_obj_chunk(chunk, triangulate, counts);
+	chunk.vertices.reserve(counts.vertices);
+	chunk.normals.reserve(counts.normals);
+	chunk.texcoords.reserve(counts.texcoords);
+	chunk.drawcalls.reserve(counts.drawcalls.size());
+
+	// starts a drawcall with room for the faces the prescan found
+	auto addDrawcall = [&]()
+	{
+		const obj_chunk_counts_t::faces_t faces = chunk.drawcalls.size() < counts.drawcalls.size() ?
+			counts.drawcalls[chunk.drawcalls.size()] : obj_chunk_counts_t::faces_t{ 0, 0 };
+		chunk.drawcalls.emplace_back(chunk.arena);
+		chunk.drawcalls.back().tris.reserve(faces.tris);
+		chunk.drawcalls.back().quads.reserve(faces.quads);
+		return &chunk.drawcalls.back();
+	};
+	unwelded_drawcall_t* currentDrawcall = addDrawcall();
+
+	// face corners (v, vt, vn) of the current face line, reused between lines
+	ArenaVector<int3> corners(chunk.arena);
+	ArenaVector<unsigned char> cornerIsRelative(chunk.arena);
+	std::string token;
+
+	const char* p = chunk.begin;
+	const char* end = chunk.end;
+
+	for (; p < end; p = skip_line(p, end))
+	{
+		p = skip_blanks(p, end);
+		if (is_line_end(p, end))
+			continue;
+
+		const char* q;
 
 		// Vertex data
 		//
-		if (readBuffer[0] == 'v')
+		if (*p == 'v')
 		{
-			// normal
+			float x, y, z;
+
+			// 3D/2D vertex
 			//
-			if (readBuffer[1] == 'n' && sscanf_s(readBuffer, "vn %f %f %f", &x, &y, &z) == 3)
-			{
-				fileNormals.push_back(vec3f(x, y, z));
-			}
-			else if (readBuffer[1] == 't')
+			if ((q = match_keyword(p, end, "v")))
 			{
-				// 3D texel (not supported: ignore last component)
-				//
-				if (sscanf_s(readBuffer, "vt %f %f %f", &x, &y, &z) == 3)
-				{
-					fileTexcoords.push_back(vec2f(x, y));
-				}
-				// 2D texel
-				//
-				else if (sscanf_s(readBuffer, "vt %f %f", &x, &y) == 2)
-				{
-					fileTexcoords.push_back(vec2f(x, y));
-				}
+				if (!parse_float(q = skip_blanks(q, end), end, x) ||
+					!parse_float(q = skip_blanks(q, end), end, y))
+					continue;
+				if (!parse_float(q = skip_blanks(q, end), end, z))
+					z = 0.0f;
+
+				// update vertex offset and mark end to a face section
+				if (chunk.face_section == 1)
+					chunk.last_offset = (int)chunk.vertices.size();
+				else if (chunk.face_section == -1)
+					chunk.last_offset = obj_chunk_t::OffsetChunkStart;
+				chunk.face_section = 0;
+
+				chunk.vertices.push_back(vec3f(x, y, z));
 			}
-			// 3D vertex
+			// texel (2D or 3D, last component ignored)
 			//
-			else if (sscanf_s(readBuffer, "v %f %f %f", &x, &y, &z) == 3)
+			else if ((q = match_keyword(p, end, "vt")))
 			{
-				// update vertex offset and mark end to a face section
-				if (faceSection)
-				{
-					lastOffset = (int)fileVertices.size();
-					faceSection = false;
-				}
-
-				fileVertices.push_back(vec3f(x, y, z));
+				if (parse_float(q = skip_blanks(q, end), end, x) &&
+					parse_float(q = skip_blanks(q, end), end, y))
+					chunk.texcoords.push_back(vec2f(x, y));
 			}
-			// 2D vertex
+			// normal
 			//
-			else if (sscanf_s(readBuffer, "v %f %f", &x, &y) == 2)
+			else if ((q = match_keyword(p, end, "vn")))
 			{
-				fileVertices.push_back(vec3f(x, y, 0.0f));
+				if (parse_float(q = skip_blanks(q, end), end, x) &&
+					parse_float(q = skip_blanks(q, end), end, y) &&
+					parse_float(q = skip_blanks(q, end), end, z))
+					chunk.normals.push_back(vec3f(x, y, z));
 			}
-
 			continue;
 		}
 
-		// face info
+		// face info: v, v/vt, v//vn or v/vt/vn for each corner
 		//
-		if (readBuffer[0] == 'f')
+		if ((q = match_keyword(p, end, "f")))
 		{
-			// face: 4x vertex/texel/normal (triangulate)
-			//
-			if (sscanf_s(readBuffer, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d", &a[0], &a[1], &a[2], &b[0], &b[1], &b[2], &c[0], &c[1], &c[2], &d[0], &d[1], &d[2]) == 12)
+			corners.clear();
+			cornerIsRelative.clear();
+			for (q = skip_blanks(q, end); !is_line_end(q, end); q = skip_blanks(q, end))
 			{
-				if (triangulate) 
+				int v = 0, vt = 0, vn = 0;
+				if (!parse_int(q, end, v))
+					break;
+				if (q < end && *q == '/')
 				{
-					currentDrawcall->tris.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, a[2] - 1, b[2] - 1, c[2] - 1, a[1] - 1, b[1] - 1, c[1] - 1 });
-					currentDrawcall->tris.push_back({ a[0] - 1, c[0] - 1, d[0] - 1, a[2] - 1, c[2] - 1, d[2] - 1, a[1] - 1, c[1] - 1, d[1] - 1 });
+					q++;
+					parse_int(q, end, vt);
+					if (q < end && *q == '/')
+					{
+						q++;
+						parse_int(q, end, vn);
+					}
 				}
-				else
-					currentDrawcall->quads.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, d[0] - 1, a[2] - 1, b[2] - 1, c[2] - 1, d[2] - 1, a[1] - 1, b[1] - 1, c[1] - 1, d[1] - 1 });
+				corners.push_back({ 
+					resolve_index(v, chunk.vertices.size()), 
+					resolve_index(vt, chunk.texcoords.size()), 
+					resolve_index(vn, chunk.normals.size()) });
+				cornerIsRelative.push_back((unsigned char)((v < 0) | (vt < 0) << 1 | (vn < 0) << 2));
 			}
-			// face: 3x vertex/texel/normal
-			//
-			else if (sscanf_s(readBuffer, "f %d/%d/%d %d/%d/%d %d/%d/%d", &a[0], &a[1], &a[2], &b[0], &b[1], &b[2], &c[0], &c[1], &c[2]) == 9)
+
+			// record relative indices so they can be rebased in the merge
+			auto addRelative = [&](unsigned char corner, unsigned char slot, unsigned char stride, bool quad)
+			{
+				unsigned char flags = cornerIsRelative[corner];
+				unsigned drawcall = (unsigned)(currentDrawcall - chunk.drawcalls.data());
+				unsigned face = (unsigned)(quad ? currentDrawcall->quads.size() : currentDrawcall->tris.size()) - 1;
+				if (flags & 1) chunk.relative_indices.push_back({ drawcall, face, slot, quad });
+				if (flags & 4) chunk.relative_indices.push_back({ drawcall, face, (unsigned char)(slot + stride), quad });
+				if (flags & 2) chunk.relative_indices.push_back({ drawcall, face, (unsigned char)(slot + 2 * stride), quad });
+			};
+
+			// start a new smoothing span if the group changed
+			if (corners.size() >= 3 && (currentDrawcall->smoothing.empty() || currentDrawcall->smoothing.back().group != chunk.smoothing_group))
+				currentDrawcall->smoothing.push_back({ (unsigned)currentDrawcall->tris.size(), (unsigned)currentDrawcall->quads.size(), chunk.smoothing_group });
+
+			if (corners.size() == 4 && !triangulate)
 			{
-				currentDrawcall->tris.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, a[2] - 1, b[2] - 1, c[2] - 1, a[1] - 1, b[1] - 1, c[1] - 1 });
+				const int3 &a = corners[0], &b = corners[1], &c = corners[2], &d = corners[3];
+				currentDrawcall->quads.push_back({ a.x, b.x, c.x, d.x, a.z, b.z, c.z, d.z, a.y, b.y, c.y, d.y });
+				for (unsigned char i = 0; i < 4; i++)
+					if (cornerIsRelative[i]) addRelative(i, i, 4, true);
 			}
-			// face: 4x vertex
-			//
-			else if (sscanf_s(readBuffer, "f %d %d %d %d", &a[0], &b[0], &c[0], &d[0]) == 4)
+			else
 			{
-				if (triangulate) 
+				// triangulate as a fan: (0,1,2), (0,2,3), ...
+				for (size_t i = 2; i < corners.size(); i++)
 				{
-					currentDrawcall->tris.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, -1, -1, -1, -1, -1, -1 });
-					currentDrawcall->tris.push_back({ a[0] - 1, c[0] - 1, d[0] - 1, -1, -1, -1, -1, -1, -1 });
+					const int3 &a = corners[0], &b = corners[i - 1], &c = corners[i];
+					currentDrawcall->tris.push_back({ a.x, b.x, c.x, a.z, b.z, c.z, a.y, b.y, c.y });
+					if (cornerIsRelative[0]) addRelative(0, 0, 3, false);
+					if (cornerIsRelative[i - 1]) addRelative((unsigned char)(i - 1), 1, 3, false);
+					if (cornerIsRelative[i]) addRelative((unsigned char)i, 2, 3, false);
 				}
-				else
-					currentDrawcall->quads.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, d[0] - 1, -1, -1, -1, -1, -1, -1, -1, -1 });
-			}
-			// face: 3x vertex
-			//
-			else if (sscanf_s(readBuffer, "f %d %d %d", &a[0], &b[0], &c[0]) == 3)
-			{
-				currentDrawcall->tris.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, -1, -1, -1, -1, -1, -1 });
 			}
-			// face: 4x vertex/texel (triangulate)
-			//
-			else if (sscanf_s(readBuffer, "f %d/%d %d/%d %d/%d %d/%d", &a[0], &a[1], &b[0], &b[1], &c[0], &c[1], &d[0], &d[1]) == 8)
+			continue;
+		}
+
+		// material file(s)
+		//
+		if ((q = match_keyword(p, end, "mtllib")))
+		{
+			while (parse_token(q, end, token))
+				chunk.mtllibs.push_back(token);
+			continue;
+		}
+		// active material
+		//
+		if ((q = match_keyword(p, end, "usemtl")))
+		{
+			if (!parse_token(q, end, token))
+				continue;
+
+			currentDrawcall = addDrawcall();
+			currentDrawcall->material_name = token;
+			currentDrawcall->group_name = chunk.group_name;
+			currentDrawcall->vertex_offset = chunk.last_offset; chunk.face_section = 1; // skinning: set current vertex offset and mark beginning of a face-section
+			if (!chunk.group_set)
+				chunk.drawcalls_before_group++;
+			continue;
+		}
+		// smoothing group: s <n> or s off
+		//
+		if ((q = match_keyword(p, end, "s")))
+		{
+			int group;
+			if (parse_int(q = skip_blanks(q, end), end, group))
+				chunk.smoothing_group = group > 0 ? group : 0;
+			else if (match_keyword(q, end, "off"))
+				chunk.smoothing_group = 0;
+			continue;
+		}
+		if ((q = match_keyword(p, end, "g")))
+		{
+			if (parse_token(q, end, token))
 			{
-				if (triangulate) 
-				{
-					currentDrawcall->tris.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, -1, -1, -1, a[1] - 1, b[1] - 1, c[1] - 1 });
-					currentDrawcall->tris.push_back({ a[0] - 1, c[0] - 1, d[0] - 1, -1, -1, -1, a[1] - 1, c[1] - 1, d[1] - 1 });
-				}
-				else
-					currentDrawcall->quads.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, d[0] - 1, -1, -1, -1, -1, a[1] - 1, b[1] - 1, c[1] - 1, d[1] - 1 });
+				chunk.group_name = token;
+				chunk.group_set = true;
 			}
-			// face: 3x vertex/texel
-			//
-			else if (sscanf_s(readBuffer, "f %d/%d %d/%d %d/%d", &a[0], &a[1], &b[0], &b[1], &c[0], &c[1]) == 6)
+		}
+	}
+}
+
+//
+// Appends src to dst, moving instead of copying when dst is empty and has no room reserved
+//
+template<class T, class Allocator>
+static void append_vector(std::vector<T, Allocator>& dst, std::vector<T, Allocator>& src)
+{
+	if (dst.empty() && dst.capacity() < src.size())
+		dst.swap(src);
+	else
+		dst.insert(dst.end(), src.begin(), src.end());
+}
+
+//
+// An array of the file that is still spread over the chunks parsed so far,
+// indexed like the merged array. Room for every part is made up front, so appending
+// a part does not move the ones before it while other threads read them.
+//
+template<class T>
+struct chunked_array_t
+{
+	ArenaVector<const ArenaVector<T>*> parts;
+	ArenaVector<size_t> bases;	// index of the first element of each part, and the end of the last one
+	size_t count = 0;	// parts appended so far
+
+	chunked_array_t(size_t max_parts, LoadArena* arena) : parts(max_parts, nullptr, arena), bases(max_parts + 1, (size_t)0, arena) {}
+
+	void append(const ArenaVector<T>& part)
+	{
+		parts[count] = &part;
+		bases[count + 1] = bases[count] + part.size();
+		count++;
+	}
+
+	size_t size() const { return bases[count]; }
+
+	// Element i within the first part_count parts, nullptr if it is not in them, e.g. for a missing (-1) index
+	const T* find(int i, size_t part_count) const
+	{
+		if (i < 0 || (size_t)i >= bases[part_count]) return nullptr;
+		const size_t part = std::upper_bound(bases.begin(), bases.begin() + part_count + 1, (size_t)i) - bases.begin() - 1;
+		return &(*parts[part])[i - bases[part]];
+	}
+};
+
+//
+// Hands a parsed drawcall to an OBJDrawcallCallback before the file has been merged and welded.
+// Vertices are welded by position only and take the normal and texture coordinates of their
+// first corner; positions without a normal in the file get the sum of their face normals.
+// position(), normal() and texcoord() return nullptr for indices that cannot be resolved
+// yet, triangles without positions are left out.
+//
+template<class Positions, class Normals, class Texcoords>
+static void stream_drawcall(const unwelded_drawcall_t& dc, const Positions& position, const Normals& normal, const Texcoords& texcoord,
+	const Material* material, const OBJDrawcallCallback& callback)
+{
+	int first = INT_MAX, last = -1;
+	for (auto& tri : dc.tris)
+		for (int i = 0; i < 3; i++)
+		{
+			first = (std::min)(first, tri.vi[i]);
+			last = (std::max)(last, tri.vi[i]);
+		}
+	if (first < 0 || last < first) return;
+
+	// positions are remapped through a table over the span they use, drawcalls that are
+	// scattered over the file wait for the complete mesh instead
+	const size_t span = (size_t)(last - first) + 1;
+	if (span > dc.tris.size() * 12 + 65536) return;
+
+	// temporaries are freed after the call, the arena would keep them until the load ends
+	std::vector<unsigned> remap(span, ~0u);
+	std::vector<unsigned char> generated;
+	std::vector<Vertex> vertices;
+	std::vector<unsigned> indices;
+	indices.reserve(dc.tris.size() * 3);
+
+	for (auto& tri : dc.tris)
+	{
+		const vec3f* p[3] = { position(tri.vi[0]), position(tri.vi[1]), position(tri.vi[2]) };
+		if (!p[0] || !p[1] || !p[2]) continue;
+		const vec3f faceNormal = (*p[1] - *p[0]) % (*p[2] - *p[0]);
+
+		for (int i = 0; i < 3; i++)
+		{
+			unsigned& index = remap[tri.vi[i] - first];
+			if (index == ~0u)
 			{
-				currentDrawcall->tris.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, -1, -1, -1, a[1] - 1, b[1] - 1, c[1] - 1 });
+				index = (unsigned)vertices.size();
+				Vertex v;
+				v.Position = *p[i];
+				const vec3f* n = normal(tri.vi[3 + i]);
+				v.Normal = n ? *n : vec3f_zero;
+				if (const vec2f* t = texcoord(tri.vi[6 + i])) v.TexCoord = *t;
+				vertices.push_back(v);
+				generated.push_back(!n);
 			}
-			// face: 4x vertex//normal (triangulate)
-			//
-			else if (sscanf_s(readBuffer, "f %d//%d %d//%d %d//%d %d//%d", &a[0], &a[1], &b[0], &b[1], &c[0], &c[1], &d[0], &d[1]) == 8)
+			if (generated[index])
+				vertices[index].Normal += faceNormal;
+			indices.push_back(index);
+		}
+	}
+	if (indices.empty()) return;
+
+	// normalize() returns zero below a fixed length, which small models reach
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		const float length_squared = vertices[v].Normal.length_squared();
+		if (generated[v] && length_squared > 0.0f)
+			vertices[v].Normal *= 1.0f / sqrtf(length_squared);
+	}
+
+#ifdef MESH_FORCE_CCW
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		forceCCW(vertices.data(), indices.data() + i);
+#endif
+
+	callback(vertices.data(), vertices.size(), indices.data(), indices.size(), material);
+}
+
+void OBJLoader::Load(
+	const std::string& filename,
+	bool auto_generate_normals,
+	bool triangulate,
+	OBJOutput output)
+{
+	// an index buffer only holds triangles
+	const bool indexBuffer = output == OBJOutput::IndexBuffer;
+	if (indexBuffer)
+		triangulate = true;
+
+	std::string parentDirectory = get_parentdir(filename);
+
+	Report = LoadReport();
+	Report.Filename = filename;
+	LoadTimer timer;
+
+	// Temporaries live in the arena of this thread, which is reset when the load ends.
+	// Tasks on other threads allocate from it too.
+	LoadArena& arena = LoadArena::ForThread();
+	LoadArena::Scope arenaScope(arena);
+
+	MappedFile file;
+	if (!file.Open(filename)) throw std::runtime_error(std::string("Failed to open ") + filename);
+	if (Verbose)
+		std::cout << "Opened " << filename << "\n";
+	Report.FileBytes = file.Size();
+
+	// raw data from obj
+	ArenaVector<vec3f> fileVertices(&arena), fileNormals(&arena);
+	ArenaVector<vec2f> fileTexcoords(&arena);
+	ArenaVector<unwelded_drawcall_t> fileDrawcalls(&arena);
+	ArenaHashMap<std::string, Material> fileMaterials(&arena);
+
+	std::string currentGroupName;
+	unwelded_drawcall_t defaultDrawcall(&arena);
+	unwelded_drawcall_t* currentDrawcall = &defaultDrawcall;
+	int lastOffset = 0; bool faceSection = false; // info for skin weight mapping
+	int smoothingGroup = 1; // files without s directives are smoothed as one group
+
+	// Split the file into chunks that start and end on line boundaries
+	//
+	size_t chunkCount = 1;
+#ifdef MESH_PARALLEL_PARSE
+	ThreadPool& threadPool = ThreadPool::Global();
+	if (threadPool.Concurrency() > 1)
+	{
+		chunkCount = file.Size() / MESH_PARALLEL_PARSE_MIN_CHUNK;
+		if (chunkCount > 4 * threadPool.Concurrency()) chunkCount = 4 * threadPool.Concurrency();
+		if (chunkCount < 1) chunkCount = 1;
+	}
+#endif
+	ArenaVector<obj_chunk_t> chunks(&arena);
+	chunks.reserve(chunkCount);
+	{
+		const char* data = file.Data();
+		const char* end = data + file.Size();
+		const char* p = data;
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			chunks.emplace_back(&arena);
+			chunks[i].begin = p;
+			p = (i + 1 == chunkCount) ? end : skip_line((std::max)(p, data + file.Size() * (i + 1) / chunkCount), end);
+			chunks[i].end = p;
+		}
+	}
+
+	// Chunks are completed in file order as soon as all chunks before them have been parsed:
+	// their relative indices are rebased and their material files loaded. The drawcalls that
+	// begin and end within them are then handed to OnDrawcallParsed outside the lock, so a
+	// thread streaming drawcalls does not hold up the others finishing their chunks.
+	//
+	std::mutex completeMutex;
+	size_t completed = 0;
+	ArenaVector<unsigned char> parsed(chunkCount, 0, &arena);
+	chunked_array_t<vec3f> chunkVertices(chunkCount, &arena), chunkNormals(chunkCount, &arena);
+	chunked_array_t<vec2f> chunkTexcoords(chunkCount, &arena);
+	const bool streamDrawcalls = indexBuffer && OnDrawcallParsed;
+
+	// a drawcall that is ready to stream, with the number of chunks its indices may refer to.
+	// The material is copied, a later material file may redefine it while the drawcall streams.
+	struct ready_drawcall_t
+	{
+		const unwelded_drawcall_t* drawcall;
+		size_t chunks;
+		bool hasMaterial;
+		Material material;
+	};
+
+	auto completeChunks = [&](size_t i)
+	{
+		ArenaVector<ready_drawcall_t> ready(&arena);
+		{
+			std::lock_guard<std::mutex> lock(completeMutex);
+			parsed[i] = 1;
+			for (; completed < chunkCount && parsed[completed]; completed++)
 			{
-				if (triangulate) 
+				obj_chunk_t& chunk = chunks[completed];
+
+				// rebase relative indices to global indices
+				const int vertexBase = (int)chunkVertices.size();
+				const int normalBase = (int)chunkNormals.size();
+				const int texcoordBase = (int)chunkTexcoords.size();
+				for (auto& ri : chunk.relative_indices)
 				{
-					currentDrawcall->tris.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, a[1] - 1, b[1] - 1, c[1] - 1, -1, -1, -1 });
-					currentDrawcall->tris.push_back({ a[0] - 1, c[0] - 1, d[0] - 1, a[1] - 1, c[1] - 1, d[1] - 1, -1, -1, -1 });
+					int stride = ri.quad ? 4 : 3;
+					int* vi = ri.quad ? chunk.drawcalls[ri.drawcall].quads[ri.face].vi : chunk.drawcalls[ri.drawcall].tris[ri.face].vi;
+					int type = ri.slot / stride;
+					vi[ri.slot] += type == 0 ? vertexBase : (type == 1 ? normalBase : texcoordBase);
+				}
+				chunkVertices.append(chunk.vertices);
+				chunkNormals.append(chunk.normals);
+				chunkTexcoords.append(chunk.texcoords);
+
+				for (auto& mtllib : chunk.mtllibs)
+				{
+					LoadTimer materialTimer;
+					LoadMaterials(parentDirectory, mtllib, fileMaterials);
+					MaterialFiles.push_back(parentDirectory + mtllib);
+					Report.MaterialTime += materialTimer.Lap();
+				}
+
+				// the first drawcall continues one from an earlier chunk and the last one may continue in the next
+				if (!streamDrawcalls)
+					continue;
+				for (size_t d = 1; d + 1 < chunk.drawcalls.size(); d++)
+				{
+					unwelded_drawcall_t& dc = chunk.drawcalls[d];
+					auto material = fileMaterials.find(dc.material_name);
+					const bool hasMaterial = material != fileMaterials.end();
+					ready.push_back({ &dc, completed + 1, hasMaterial, hasMaterial ? material->second : Material() });
+					dc.streamed = true;
 				}
-				else
-					currentDrawcall->quads.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, d[0] - 1, a[2] - 1, b[2] - 1, c[2] - 1, d[2] - 1, -1, -1, -1, -1 });
-			}
-			// face: 3x vertex//normal
-			//
-			else if (sscanf_s(readBuffer, "f %d//%d %d//%d %d//%d", &a[0], &a[1], &b[0], &b[1], &c[0], &c[1]) == 6)
-			{
-				currentDrawcall->tris.push_back({ a[0] - 1, b[0] - 1, c[0] - 1, a[1] - 1, b[1] - 1, c[1] - 1, -1, -1, -1 });
 			}
-			continue;
 		}
 
-		// material file
-		//
-		if (sscanf_s(readBuffer, "mtllib %s", str, MaxChars) == 1)
+		for (const ready_drawcall_t& r : ready)
+			stream_drawcall(*r.drawcall,
+				[&](int i) { return chunkVertices.find(i, r.chunks); },
+				[&](int i) { return chunkNormals.find(i, r.chunks); },
+				[&](int i) { return chunkTexcoords.find(i, r.chunks); },
+				r.hasMaterial ? &r.material : nullptr, OnDrawcallParsed);
+	};
+
+	// Parse chunks
+	//
+	if (chunkCount > 1)
+	{
+#ifdef MESH_PARALLEL_PARSE
+		threadPool.ParallelFor(chunkCount, [&](size_t i) { parse_obj_chunk(chunks[i], triangulate); completeChunks(i); });
+#endif
+	}
+	else
+	{
+		parse_obj_chunk(chunks[0], triangulate);
+		completeChunks(0);
+	}
+
+	// Merge chunks in file order, into arrays that are allocated up front
+	//
+	if (chunkCount > 1)
+	{
+		size_t vertexCount = 0, normalCount = 0, texcoordCount = 0, drawcallCount = 0;
+		for (const obj_chunk_t& chunk : chunks)
 		{
-			LoadMaterials(parentDirectory, str, fileMaterials);
-			continue;
+			vertexCount += chunk.vertices.size();
+			normalCount += chunk.normals.size();
+			texcoordCount += chunk.texcoords.size();
+			drawcallCount += chunk.drawcalls.size() - 1;
 		}
-		// active material
-		//
-		if (sscanf_s(readBuffer, "usemtl %s", str, MaxChars) == 1)
+		fileVertices.reserve(vertexCount);
+		fileNormals.reserve(normalCount);
+		fileTexcoords.reserve(texcoordCount);
+		fileDrawcalls.reserve(drawcallCount);
+	}
+	else
+		fileDrawcalls.reserve(chunks[0].drawcalls.size() - 1);
+
+	// Faces of the chunks after each chunk that continue its last drawcall, up to the chunk
+	// that starts a new one. The drawcall is grown to its final size once rather than once per
+	// chunk, since the arena keeps the storage a vector leaves behind until the load ends.
+	struct continued_faces_t { size_t tris = 0, quads = 0, smoothing = 0; };
+	ArenaVector<continued_faces_t> continuedFaces(chunkCount, continued_faces_t(), &arena);
+	for (size_t c = chunkCount - 1; c-- > 0; )
+	{
+		const unwelded_drawcall_t& next = chunks[c + 1].drawcalls[0];
+		continued_faces_t& faces = continuedFaces[c];
+		if (chunks[c + 1].drawcalls.size() == 1)
+			faces = continuedFaces[c + 1];
+		faces.tris += next.tris.size();
+		faces.quads += next.quads.size();
+		faces.smoothing += next.smoothing.size();
+	}
+
+	for (size_t c = 0; c < chunkCount; c++)
+	{
+		obj_chunk_t& chunk = chunks[c];
+		const int vertexBase = (int)fileVertices.size();
+
+		// skinning offsets
+		auto resolveOffset = [&](int offset)
 		{
-			unwelded_drawcall_t udc;
-			udc.material_name = str;
-			udc.group_name = currentGroupName;
-			udc.vertex_offset = lastOffset; faceSection = true; // skinning: set current vertex offset and mark beginning of a face-section
-			fileDrawcalls.push_back(udc);
+			if (offset >= 0) return vertexBase + offset;
+			if (offset == obj_chunk_t::OffsetChunkStart && faceSection) return vertexBase;
+			return lastOffset;
+		};
+
+		// smoothing spans start from the group active before the chunk, and continue the current drawcall's faces
+		auto resolveSmoothing = [&](unwelded_drawcall_t& udc, size_t triBase, size_t quadBase)
+		{
+			for (auto& span : udc.smoothing)
+			{
+				if (span.group == obj_chunk_t::SmoothingInherit)
+					span.group = smoothingGroup;
+				span.tri += (unsigned)triBase;
+				span.quad += (unsigned)quadBase;
+			}
+		};
+
+		// faces before the first usemtl of the chunk continue the current drawcall
+		resolveSmoothing(chunk.drawcalls[0], currentDrawcall->tris.size(), currentDrawcall->quads.size());
+		append_vector(currentDrawcall->smoothing, chunk.drawcalls[0].smoothing);
+		append_vector(currentDrawcall->tris, chunk.drawcalls[0].tris);
+		append_vector(currentDrawcall->quads, chunk.drawcalls[0].quads);
+
+		for (size_t i = 1; i < chunk.drawcalls.size(); i++)
+		{
+			unwelded_drawcall_t& udc = chunk.drawcalls[i];
+			resolveSmoothing(udc, 0, 0);
+			if (i <= chunk.drawcalls_before_group)
+				udc.group_name = currentGroupName;
+			udc.vertex_offset = resolveOffset(udc.vertex_offset);
+			fileDrawcalls.push_back(std::move(udc));
 			currentDrawcall = &fileDrawcalls.back();
-			continue;
 		}
-		else if (sscanf_s(readBuffer, "g %s", str, MaxChars) == 1)
+
+		// the current drawcall was opened in this chunk
+		if (c == 0 || chunk.drawcalls.size() > 1)
 		{
-			currentGroupName = str;
+			const continued_faces_t& faces = continuedFaces[c];
+			if (faces.tris) currentDrawcall->tris.reserve(currentDrawcall->tris.size() + faces.tris);
+			if (faces.quads) currentDrawcall->quads.reserve(currentDrawcall->quads.size() + faces.quads);
+			if (faces.smoothing) currentDrawcall->smoothing.reserve(currentDrawcall->smoothing.size() + faces.smoothing);
 		}
+
+		if (chunk.group_set)
+			currentGroupName = chunk.group_name;
+		if (chunk.smoothing_group != obj_chunk_t::SmoothingInherit)
+			smoothingGroup = chunk.smoothing_group;
+		lastOffset = resolveOffset(chunk.last_offset);
+		if (chunk.face_section != -1)
+			faceSection = chunk.face_section == 1;
+
+		append_vector(fileVertices, chunk.vertices);
+		append_vector(fileNormals, chunk.normals);
+		append_vector(fileTexcoords, chunk.texcoords);
 	}
-	in.close();
+	file.Close();
 
 	// use defualt drawcall if no instance of usemtl
 	if (!fileDrawcalls.size())
-		fileDrawcalls.push_back(defaultDrawcall);
+		fileDrawcalls.push_back(std::move(defaultDrawcall));
 
 	HasNormals = (bool)fileNormals.size();
 	HasTexcoords = (bool)fileTexcoords.size();
 
-	printf("Loaded:\n\t%d vertices\n\t%d texels\n\t%d normals\n\t%d drawcalls\n",
-		(int)fileVertices.size(), (int)fileTexcoords.size(), (int)fileNormals.size(), (int)fileDrawcalls.size());
+	// the drawcalls that continued over chunk boundaries are streamed before normals are generated
+	if (streamDrawcalls)
+		for (auto& dc : fileDrawcalls)
+			if (!dc.streamed)
+			{
+				auto material = fileMaterials.find(dc.material_name);
+				stream_drawcall(dc,
+					[&](int i) { return (size_t)i < fileVertices.size() ? &fileVertices[i] : nullptr; },
+					[&](int i) { return (size_t)i < fileNormals.size() ? &fileNormals[i] : nullptr; },
+					[&](int i) { return (size_t)i < fileTexcoords.size() ? &fileTexcoords[i] : nullptr; },
+					material == fileMaterials.end() ? nullptr : &material->second, OnDrawcallParsed);
+			}
+
+	Report.ParseTime = timer.Lap() - Report.MaterialTime;
+	Report.FilePositions = fileVertices.size();
+	Report.FileTexcoords = fileTexcoords.size();
 
 #if 1
 	// auto-generate normals
 	if (!HasNormals && auto_generate_normals)
 	{
-		GenerateNormals(fileVertices, fileNormals, fileDrawcalls);
+		GenerateNormals(fileVertices, fileNormals, fileDrawcalls, arena);
 		HasNormals = true;
-		printf("Auto-generated %d normals\n", (int)fileNormals.size());
+		Report.NormalTime = timer.Lap();
 	}
 #endif
+	Report.FileNormals = fileNormals.size();
+	timer.Lap();
 
 #if 1
-	printf("Welding vertex array...");
 
-	std::unordered_map<std::string, unsigned> materialToIndexHash;
-
-	// hash function for int3
-	struct int3_hashfunction 
-	{
-		std::size_t operator () (const int3& i3) const 
-		{
-			return i3.x;
-		}
-	};
+	ArenaHashMap<std::string, unsigned> materialToIndexHash(&arena);
+	ArenaVector<int> materialIndices(fileDrawcalls.size(), &arena);
 
-	for (auto &dc : fileDrawcalls)
+	// materials are numbered in order of first use, so this pass is serial
+	for (size_t d = 0; d < fileDrawcalls.size(); d++)
 	{
-		Drawcall drawcall;
-		drawcall.GroupName = dc.group_name;
-
-		std::unordered_map<int3, unsigned, int3_hashfunction> index3ToIndexHash;
+		auto& dc = fileDrawcalls[d];
 
 		// material
 		//
@@ -415,127 +1103,248 @@ void OBJLoader::Load(
 				if (material == fileMaterials.end())
 					throw std::runtime_error(std::string("Error: used material ") + dc.material_name + " not found\n");
 
-				drawcall.MaterialIndex = (unsigned)Materials.size();
+				materialIndices[d] = (int)Materials.size();
 				materialToIndexHash[dc.material_name] = (unsigned)Materials.size();
 
-				Materials.push_back(material->second);
+				Materials.push_back(std::move(material->second));
 			}
 			else
-				drawcall.MaterialIndex = materialIndex->second;;
+				materialIndices[d] = materialIndex->second;;
 		}
 		else
 		{
 			// mtl string is empty, use empty index
-			drawcall.MaterialIndex = -1;
+			materialIndices[d] = -1;
 		}
+	}
 
-		// weld Vertices from triangles
-		//
-		for (auto &tri : dc.tris)
+	// Output: either one Drawcall per drawcall, or an IndexRange per drawcall
+	// whose place in Indices is known up front from the triangle counts
+	const size_t drawcallBase = Drawcalls.size();
+	ArenaVector<size_t> indexStarts(&arena), indexCounts(&arena);
+	if (indexBuffer)
+	{
+		ArenaVector<size_t> rangeOrder(fileDrawcalls.size(), &arena);
+		for (size_t d = 0; d < rangeOrder.size(); d++)
+			rangeOrder[d] = d;
+#ifdef MESH_SORT_DRAWCALLS
+		std::stable_sort(rangeOrder.begin(), rangeOrder.end(), [&](size_t a, size_t b) { return materialIndices[a] < materialIndices[b]; });
+#endif
+
+		indexStarts.resize(fileDrawcalls.size());
+		indexCounts.resize(fileDrawcalls.size());
+		size_t indexCount = Indices.size();
+		for (size_t d : rangeOrder)
 		{
-			Triangle wtri{};
+			const size_t size = fileDrawcalls[d].tris.size() * 3;
+			indexStarts[d] = indexCount;
+			indexCounts[d] = size;
+			IndexRanges.push_back({ (unsigned)indexCount, (unsigned)size, 0, materialIndices[d] });
+			indexCount += size;
+		}
+		Indices.resize(indexCount);
+	}
+	else
+	{
+		Drawcalls.resize(drawcallBase + fileDrawcalls.size());
+		for (size_t d = 0; d < fileDrawcalls.size(); d++)
+		{
+			Drawcalls[drawcallBase + d].GroupName = fileDrawcalls[d].group_name;
+			Drawcalls[drawcallBase + d].MaterialIndex = materialIndices[d];
+		}
+	}
 
-			for (int i = 0; i < 3; i++)
-			{
-				int3 i3 = { tri.vi[0 + i], tri.vi[3 + i], tri.vi[6 + i] };
+	// Vertices are not shared between drawcalls, so each drawcall is welded by its own task
+	// into a local vertex array, with indices relative to that array
+	ArenaVector<ArenaVector<Vertex>> drawcallVertices(fileDrawcalls.size(), ArenaVector<Vertex>(&arena), &arena);
 
-				auto s = index3ToIndexHash.find(i3);
-				if (s == index3ToIndexHash.end())
-				{
-					// index-combo does not exist, create it
-					Vertex v;
-					v.Position = fileVertices[i3.x];
-					if (i3.y > -1) v.Normal = fileNormals[i3.y];
-					if (i3.z > -1) v.TexCoord = fileTexcoords[i3.z];
+	// hand out the largest drawcalls first so one big drawcall does not end up last
+	ArenaVector<size_t> weldOrder(fileDrawcalls.size(), &arena);
+	for (size_t d = 0; d < weldOrder.size(); d++)
+		weldOrder[d] = d;
+	auto corners = [&](size_t d) { return fileDrawcalls[d].tris.size() * 3 + fileDrawcalls[d].quads.size() * 4; };
+	std::stable_sort(weldOrder.begin(), weldOrder.end(), [&](size_t a, size_t b) { return corners(a) > corners(b); });
 
-					wtri.VertexIndices[i] = (unsigned)Vertices.size();
-					index3ToIndexHash[i3] = (unsigned)(Vertices.size());
+	// A drawcall is expected to weld into its share of the file's vertices, which number about as
+	// many as the largest of the position, normal and texture coordinate counts the prescan found,
+	// plus an eighth for seams. Its vertex array and weld table are sized for that: the arena cannot
+	// reuse the memory a vector leaves behind when it grows, and a table sized for every corner
+	// would be several times larger than needed and miss the cache far more.
+	size_t totalCorners = 0;
+	for (size_t d = 0; d < fileDrawcalls.size(); d++)
+		totalCorners += corners(d);
+	const size_t fileVertexCount = (std::max)(fileVertices.size(), (std::max)(fileNormals.size(), fileTexcoords.size()));
+	auto expectedVertices = [&](size_t d)
+	{
+		const size_t share = (size_t)((double)fileVertexCount * corners(d) / (std::max)(totalCorners, (size_t)1));
+		return (std::min)(corners(d), share + share / 8 + 16);
+	};
 
-					Vertices.push_back(v);
-				}
-				else
-				{
-					// use existing index-combo
-					wtri.VertexIndices[i] = s->second;
-				}
+	// Index-combo (v, vn, vt) to vertex index tables. A table is reused by the tasks that
+	// come after the one that created it, and since drawcalls are welded largest first,
+	// a table is sized by its first drawcall and rarely grows.
+	std::mutex weldTableMutex;
+	std::deque<WeldTable, ArenaAllocator<WeldTable>> weldTables(&arena);
+	ArenaVector<WeldTable*> freeWeldTables(&arena);
+
+	ThreadPool::Global().ParallelFor(weldOrder.size(), [&](size_t task)
+	{
+		const size_t d = weldOrder[task];
+		auto& dc = fileDrawcalls[d];
+		ArenaVector<Vertex>& vertices = drawcallVertices[d];
+		vertices.reserve(expectedVertices(d));
+
+		WeldTable* weldTable;
+		{
+			std::lock_guard<std::mutex> lock(weldTableMutex);
+			if (freeWeldTables.empty())
+			{
+				weldTables.emplace_back(&arena);
+				freeWeldTables.push_back(&weldTables.back());
 			}
-			drawcall.Triangles.push_back(wtri);
+			weldTable = freeWeldTables.back();
+			freeWeldTables.pop_back();
 		}
+		WeldTable& index3ToIndexHash = *weldTable;
+		index3ToIndexHash.Reset(expectedVertices(d));
 
-#if 1
-		// weld Vertices from quads
-		//
-		for (auto &quad : dc.quads)
+		// returns the vertex index of an index-combo, creating the vertex if the combo does not exist
+		auto weldVertex = [&](const int3& i3)
 		{
-			Quad wquad{};
+			bool inserted;
+			unsigned index = index3ToIndexHash.FindOrInsert(i3, (unsigned)vertices.size(), inserted);
+			if (inserted)
+			{
+				Vertex v;
+				v.Position = fileVertices[i3.x];
+				if (i3.y > -1) v.Normal = fileNormals[i3.y];
+				if (i3.z > -1) v.TexCoord = fileTexcoords[i3.z];
+				vertices.push_back(v);
+			}
+			return index;
+		};
 
-			for (int i = 0; i < 4; i++)
+		if (indexBuffer)
+		{
+			// weld Vertices from triangles, straight into the index buffer
+			//
+			unsigned* indices = Indices.data() + indexStarts[d];
+			for (auto &tri : dc.tris)
+				for (int i = 0; i < 3; i++)
+					*indices++ = weldVertex({ tri.vi[0 + i], tri.vi[3 + i], tri.vi[6 + i] });
+
+#ifdef MESH_FORCE_CCW
+			// the local vertices are at hand, so fix the winding here rather than in a serial pass
+			indices = Indices.data() + indexStarts[d];
+			for (size_t i = 0; i + 2 < indexCounts[d]; i += 3)
+				forceCCW(vertices.data(), indices + i);
+#endif
+		}
+		else
+		{
+			Drawcall& drawcall = Drawcalls[drawcallBase + d];
+
+			// weld Vertices from triangles
+			//
+			drawcall.Triangles.reserve(dc.tris.size());
+			for (auto &tri : dc.tris)
 			{
-				int3 i3 = { quad.vi[0 + i], quad.vi[3 + i], quad.vi[6 + i] };
+				Triangle wtri{};
 
-				auto s = index3ToIndexHash.find(i3);
-				if (s == index3ToIndexHash.end())
-				{
-					// index-combo does not exist, create it
-					Vertex v;
-					v.Position = fileVertices[i3.x];
-					if (i3.y > -1) v.Normal = fileNormals[i3.y];
-					if (i3.z > -1) v.TexCoord = fileTexcoords[i3.z];
+				for (int i = 0; i < 3; i++)
+					wtri.VertexIndices[i] = weldVertex({ tri.vi[0 + i], tri.vi[3 + i], tri.vi[6 + i] });
 
-					wquad.VertexIndices[i] = (unsigned)Vertices.size();
-					index3ToIndexHash[i3] = (unsigned)(Vertices.size());
+				drawcall.Triangles.push_back(wtri);
+			}
 
-					Vertices.push_back(v);
-				}
-				else
-				{
-					// use existing index-combo
-					wquad.VertexIndices[i] = s->second;
-				}
+#if 1
+			// weld Vertices from quads
+			//
+			drawcall.Quads.reserve(dc.quads.size());
+			for (auto &quad : dc.quads)
+			{
+				Quad wquad{};
+
+				for (int i = 0; i < 4; i++)
+					wquad.VertexIndices[i] = weldVertex({ quad.vi[0 + i], quad.vi[4 + i], quad.vi[8 + i] });
+
+				drawcall.Quads.push_back(wquad);
 			}
-			drawcall.Quads.push_back(wquad);
-		}
 #endif
+		}
 
-		Drawcalls.push_back(drawcall);
+		std::lock_guard<std::mutex> lock(weldTableMutex);
+		freeWeldTables.push_back(weldTable);
+	});
+
+	// Prefix sum over the vertex counts gives each drawcall its place in the final array
+	ArenaVector<size_t> vertexOffsets(fileDrawcalls.size(), &arena);
+	size_t vertexCount = Vertices.size();
+	for (size_t d = 0; d < fileDrawcalls.size(); d++)
+	{
+		vertexOffsets[d] = vertexCount;
+		vertexCount += drawcallVertices[d].size();
 	}
-	printf("Done\n");
+	Vertices.resize(vertexCount);
+
+	// Copy the local arrays into place and rebase the indices
+	ThreadPool::Global().ParallelFor(fileDrawcalls.size(), [&](size_t d)
+	{
+		std::copy(drawcallVertices[d].begin(), drawcallVertices[d].end(), Vertices.begin() + vertexOffsets[d]);
+
+		const unsigned offset = (unsigned)vertexOffsets[d];
+		if (indexBuffer)
+		{
+			unsigned* indices = Indices.data() + indexStarts[d];
+			for (size_t i = 0; i < indexCounts[d]; i++)
+				indices[i] += offset;
+		}
+		else
+		{
+			Drawcall& drawcall = Drawcalls[drawcallBase + d];
+			for (auto& tri : drawcall.Triangles)
+				for (auto& index : tri.VertexIndices)
+					index += offset;
+			for (auto& quad : drawcall.Quads)
+				for (auto& index : quad.VertexIndices)
+					index += offset;
+		}
+	});
+	Report.WeldTime = timer.Lap();
 
 	// Produce and print some stats
 	//
-	int tris = 0, quads = 0;
+	int tris = (int)Indices.size() / 3, quads = 0;
 	for (auto &dc : Drawcalls)
 	{
 		tris += (int)dc.Triangles.size();
 		quads += (int)dc.Quads.size();
 	}
-	printf("\t%d vertices\n\t%d drawcalls\n\t%d triangles\n\t%d quads\n",
-		(int)Vertices.size(), (int)Drawcalls.size(), tris, quads);
-	printf("Loaded materials:\n");
-
-	for (auto& mtl : Materials)
+	if (Verbose)
 	{
-		printf("\t%s\n", mtl.Name.c_str());
+		printf("\t%d vertices\n\t%d drawcalls\n\t%d triangles\n\t%d quads\n",
+			(int)Vertices.size(), (int)(Drawcalls.size() + IndexRanges.size()), tris, quads);
+		printf("Loaded materials:\n");
+		for (auto& mtl : Materials)
+			printf("\t%s\n", mtl.Name.c_str());
 	}
+	Report.Vertices = Vertices.size();
+	Report.Triangles = tris;
+	Report.Materials = Materials.size();
+	Report.UnmergedDrawcalls = Drawcalls.size() + IndexRanges.size();
+	timer.Lap();
 
 #ifdef MESH_FORCE_CCW
-    // Force counter-clockwise: 
-	// flip triangle if geometric normal points away from vertex normal (at index=0)
-	for (auto& dc : Drawcalls)
+    // Force counter-clockwise
+	// (index buffers are fixed while welding)
+	for (size_t d = drawcallBase; d < Drawcalls.size(); d++)
 	{
-		for (auto& tri : dc.Triangles)
-		{
-			int a = tri.VertexIndices[0], b = tri.VertexIndices[1], c = tri.VertexIndices[2];
-			vec3f v0 = Vertices[a].Position, v1 = Vertices[b].Position, v2 = Vertices[c].Position;
-
-			vec3f geo_n = linalg::normalize((v1 - v0) % (v2 - v0));
-			vec3f vert_n = Vertices[a].Normal;
-
-			if (linalg::dot(geo_n, vert_n) < 0)
-				std::swap(tri.VertexIndices[0], tri.VertexIndices[1]);
-		}
+		for (auto& tri : Drawcalls[d].Triangles)
+			forceCCW(Vertices.data(), tri.VertexIndices);
 	}
+	Report.CCWInWeld = indexBuffer;
 #endif
+	Report.CCWTime = timer.Lap();
     
 #ifdef MESH_SORT_DRAWCALLS
 	// Sort Drawcalls based on material
@@ -543,9 +1352,51 @@ void OBJLoader::Load(
 	// Drawcalls with the same resources (mainly shader & material) are 
 	// rendered back-to-back to make the number of texture binds (which are slow)
 	// as low as possible
-    std::sort(Drawcalls.begin(), Drawcalls.end());
-	printf("Sorted drawcalls\n");
+	// (index ranges are already laid out in this order)
+    std::stable_sort(Drawcalls.begin(), Drawcalls.end());
+#endif
+
+#ifdef MESH_MERGE_DRAWCALLS
+	// Merge consecutive drawcalls that use the same material, so each
+	// material (after sorting) is drawn with a single drawcall
+	if (Drawcalls.size() > 1)
+	{
+		size_t last = 0;
+		for (size_t i = 1; i < Drawcalls.size(); i++)
+		{
+			Drawcall& merged = Drawcalls[last];
+			Drawcall& dc = Drawcalls[i];
+			if (dc.MaterialIndex == merged.MaterialIndex)
+			{
+				merged.Triangles.insert(merged.Triangles.end(), dc.Triangles.begin(), dc.Triangles.end());
+				merged.Quads.insert(merged.Quads.end(), dc.Quads.begin(), dc.Quads.end());
+			}
+			else if (++last != i)
+				Drawcalls[last] = std::move(dc);
+		}
+		Drawcalls.resize(last + 1);
+	}
+	if (IndexRanges.size() > 1)
+	{
+		// ranges of one material are adjacent in the index buffer, so merging only extends the range
+		size_t last = 0;
+		for (size_t i = 1; i < IndexRanges.size(); i++)
+		{
+			IndexRange& merged = IndexRanges[last];
+			const IndexRange& range = IndexRanges[i];
+			if (range.MaterialIndex == merged.MaterialIndex &&
+				range.Offset == merged.Offset &&
+				range.Start == merged.Start + merged.Size)
+				merged.Size += range.Size;
+			else
+				IndexRanges[++last] = range;
+		}
+		IndexRanges.resize(last + 1);
+	}
 #endif
+	Report.SortTime = timer.Lap();
+	Report.Drawcalls = Drawcalls.size() + IndexRanges.size();
+	Report.TempBytes = arena.Used();
     
 #endif
 }
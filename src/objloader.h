@@ -9,7 +9,10 @@
 
 #include <vector>
 #include <string>
-#include "Drawcall.h"
+#include <functional>
+#include "drawcall.h"
+#include "loadreport.h"
+#include "arena.h"
 
 //! Make sure loaded normals face in the same direction as the triangle's CCW normal
 #define MESH_FORCE_CCW
@@ -17,6 +20,17 @@
 //! Sort drawcalls based on material - usually a good idea
 #define MESH_SORT_DRAWCALLS
 
+//! Merge consecutive drawcalls with the same material into one - together with MESH_SORT_DRAWCALLS, one drawcall per material
+#define MESH_MERGE_DRAWCALLS
+
+//! Parse large files in parallel, in newline-aligned chunks. The result is identical to a serial parse.
+#define MESH_PARALLEL_PARSE
+
+//! Smallest chunk (in bytes) a file is split into when parsing in parallel
+#ifndef MESH_PARALLEL_PARSE_MIN_CHUNK
+#define MESH_PARALLEL_PARSE_MIN_CHUNK (1 << 20)
+#endif
+
 /** 
  * @brief Accepted image formats
  * @note This is a short list, more formats may be accepted -
@@ -24,28 +38,64 @@
 */
 #define ALLOWED_TEXTURE_SUFFIXES { "bmp", "jpg", "png", "tga", "gif" }
 
+/**
+ * @brief Output layout of OBJLoader::Load()
+*/
+enum class OBJOutput
+{
+    Drawcalls,  //!< Drawcalls with lists of Triangles and Quads
+    IndexBuffer //!< One triangle index buffer (Indices) with an IndexRange per drawcall (IndexRanges), ready for the GPU
+};
+
+/**
+ * @brief Receives drawcalls from OBJLoader::Load() as soon as they are parsed, for OBJOutput::IndexBuffer.
+ * @details Called from the parsing threads, possibly several at once, before normals are generated and
+ * the mesh is welded. Drawcalls within a parse chunk come first, in no particular order, those spanning
+ * chunks follow once the file is parsed. The arrays are only valid during the call. Vertices are welded
+ * by position only and have no tangents; normals are those of the file or averaged from the faces of
+ * the drawcall. Triangles are counter-clockwise with MESH_FORCE_CCW.
+ * @param vertices Vertices of the drawcall.
+ * @param vertex_count Number of vertices.
+ * @param indices Triangle list, indexing vertices.
+ * @param index_count Number of indices.
+ * @param material Material of the drawcall, nullptr if it has none.
+*/
+typedef std::function<void(const Vertex* vertices, size_t vertex_count, const unsigned* indices, size_t index_count, const Material* material)> OBJDrawcallCallback;
+
 /**
  * @brief OBJ Loader.
  * @details Parses OBJ/MTL-files and organizes the data in arrays with Vertices, Drawcalls and materials.
+ * The temporary arrays of a load come from the LoadArena of the loading thread, so loading
+ * several models back to back reuses the same memory.
 */
 class OBJLoader
 {
-    void LoadMaterials(std::string directory, std::string filename, MaterialHash& material_hash);
+    void LoadMaterials(std::string directory, std::string filename, ArenaHashMap<std::string, Material>& material_hash);
 public:
     /**
      * @brief Loads a .obj file and any linked .mtl file.
      * @param filename Path to the file.
      * @param auto_generate_normals Should normals be automatically generated if they are not contained in the file.
-     * @param triangulate Should quads be triangulated.
+     * @param triangulate Should quads be triangulated. Always true for OBJOutput::IndexBuffer.
+     * @param output Fill Drawcalls, or Indices and IndexRanges.
     */
-    void Load(const std::string& filename, bool auto_generate_normals = true, bool triangulate = true);
+    void Load(const std::string& filename, bool auto_generate_normals = true, bool triangulate = true, OBJOutput output = OBJOutput::Drawcalls);
 
     bool HasNormals = false; //!< Does the model contain normals.
     bool HasTexcoords = false; //!< Does the model contain uv-coordinates
 
     std::vector<Vertex> Vertices; //!< Vector of Vertex data
     std::vector<Drawcall> Drawcalls; //!< Vector of Drawcall data
+    std::vector<unsigned> Indices; //!< Triangle index buffer, for OBJOutput::IndexBuffer
+    std::vector<IndexRange> IndexRanges; //!< Index ranges of the drawcalls within Indices, for OBJOutput::IndexBuffer
     std::vector<Material> Materials; //!< Vector of Material data
+    std::vector<std::string> MaterialFiles; //!< Paths of the .mtl files that were loaded
+
+    bool Verbose = true; //!< Print statistics to stdout after loading, warnings are always printed. Per-phase numbers are in Report
+
+    OBJDrawcallCallback OnDrawcallParsed; //!< Optional, set before Load() to receive drawcalls while the file is still loading
+
+    LoadReport Report; //!< Timings and sizes of the last Load(), the loader phases only
 };
 
 #endif
@@ -1,4 +1,67 @@
 #include "OBJModel.h"
+#include "meshcache.h"
+#include "meshsplit.h"
+#include "meshtangents.h"
+#include "meshoptimize.h"
+#include "meshcompact.h"
+#include "meshlod.h"
+#include "shader.h"
+#include "asyncloader.h"
+#include "glbloader.h"
+#include "plyloader.h"
+#include "materialtable.h"
+
+//
+// Case insensitive check of a file name's suffix, e.g. ".glb"
+//
+static bool has_suffix(const std::string& filename, const char* suffix)
+{
+	const size_t length = strlen(suffix);
+	if (filename.size() < length)
+		return false;
+	for (size_t i = 0; i < length; i++)
+	{
+		if (tolower((unsigned char)filename[filename.size() - length + i]) != suffix[i])
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief CPU side result of loading an OBJ: the final vertex and index arrays,
+ * index ranges, materials and decoded textures, ready to be uploaded to the device.
+*/
+struct OBJModel::MeshData
+{
+	// Vertex and index data for the buffers. Points either into
+	// the memory mapped cache file or into the loaded arrays below.
+	const Vertex* Vertices = nullptr;
+	const void* Indices = nullptr;
+	size_t VertexCount = 0, IndexCount = 0, IndexSize = sizeof(unsigned);
+
+	// Own the data pointed to above
+	MeshCache Cache;
+	OBJLoader Mesh;
+	GLBLoader Glb;
+	PLYLoader Ply;
+	std::vector<uint16_t> Indices16;
+
+	// The vertices as uploaded with MESH_COMPACT_VERTICES
+	std::vector<CompactVertex> CompactVertices;
+	CompactVertexDecode Decode;
+
+	std::vector<IndexRange> IndexRanges;
+	std::vector<MeshLod> Lods; // ranges into the same buffers
+	vec4f Bounds;
+	std::vector<Material> Materials;
+	std::vector<Image> DiffuseImages; // one per material, empty if the material has none
+	std::vector<Image> NormalImages; // one per material, empty if the material has none
+	LoadReport Report;
+	bool FromCache = false;
+};
+
+shader_data* OBJModel::s_vertex_shader = nullptr;
+shader_data* OBJModel::s_compact_vertex_shader = nullptr;
 
 OBJModel::OBJModel(
 	const std::string& objfile,
@@ -6,45 +69,412 @@ OBJModel::OBJModel(
 	ID3D11DeviceContext* dxdevice_context)
 	: Model(dxdevice, dxdevice_context)
 {
-	// Load the OBJ
-	OBJLoader* mesh = new OBJLoader();
-	mesh->Load(objfile);
+	bool created = true;
+#ifdef MESH_SHARE_ASSETS
+	std::shared_ptr<MeshAsset> asset = MeshAsset::Acquire(objfile, created);
+#else
+	std::shared_ptr<MeshAsset> asset(new MeshAsset());
+#endif
+	m_asset = asset;
+
+	if (!created)
+	{
+		printf("%s: sharing the already loaded mesh\n", objfile.c_str());
+		return;
+	}
+
+	std::shared_ptr<MeshData> data = LoadMeshData(objfile);
+	CreateDeviceResources(*data, *asset, dxdevice, dxdevice_context);
+	asset->SetReady();
+}
+
+OBJModel::OBJModel(
+	const std::string& objfile,
+	ID3D11Device* dxdevice,
+	ID3D11DeviceContext* dxdevice_context,
+	AsyncLoader& loader)
+	: Model(dxdevice, dxdevice_context)
+{
+	bool created = true;
+#ifdef MESH_SHARE_ASSETS
+	std::shared_ptr<MeshAsset> asset = MeshAsset::Acquire(objfile, created);
+#else
+	std::shared_ptr<MeshAsset> asset(new MeshAsset());
+#endif
+	m_asset = asset;
+	m_loader = &loader;
+
+	if (!created)
+		return;
+
+	// Parse and decode on a loader thread, create the device resources on the render thread.
+	// The upload only holds a weak reference, so models released before their mesh is
+	// uploaded do not keep it alive.
+	std::weak_ptr<MeshAsset> weakAsset = asset;
+	AsyncLoader* loaderPtr = &loader;
+	loader.Queue([objfile, dxdevice, dxdevice_context, weakAsset, loaderPtr]() -> AsyncLoader::Upload
+	{
+		if (weakAsset.expired())
+			return nullptr;
+
+		// Set once the complete mesh is loaded, streamed drawcalls that have not been
+		// uploaded by then are dropped rather than uploaded just before the mesh replaces them
+		auto loaded = std::make_shared<std::atomic<bool>>(false);
+
+		OBJDrawcallCallback onDrawcall;
+#ifdef MESH_STREAM_DRAWCALLS
+		onDrawcall = [=](const Vertex* vertices, size_t vertex_count, const unsigned* indices, size_t index_count, const Material* material)
+		{
+			StreamDrawcall(vertices, vertex_count, indices, index_count, material, weakAsset, loaded, dxdevice, *loaderPtr);
+		};
+#endif
+		std::shared_ptr<MeshData> data;
+		try
+		{
+			data = LoadMeshData(objfile, onDrawcall);
+			*loaded = true;
+		}
+		catch (const std::exception& e)
+		{
+			*loaded = true;
+
+			// Models sharing the asset stop waiting for it, and are not drawn
+			printf("%s: loading failed, the model is not drawn: %s\n", objfile.c_str(), e.what());
+			return [weakAsset]()
+			{
+				if (std::shared_ptr<MeshAsset> asset = weakAsset.lock())
+					asset->SetFailed();
+			};
+		}
+		return [data, dxdevice, dxdevice_context, weakAsset]()
+		{
+			if (std::shared_ptr<MeshAsset> asset = weakAsset.lock())
+			{
+				CreateDeviceResources(*data, *asset, dxdevice, dxdevice_context);
+				asset->SetReady();
+			}
+		};
+	});
+}
+
+std::shared_ptr<OBJModel::MeshData> OBJModel::LoadMeshData(const std::string& objfile, const OBJDrawcallCallback& on_drawcall)
+{
+	LoadTimer loadTimer, timer;
+	std::shared_ptr<MeshData> data = std::make_shared<MeshData>();
+	LoadReport& report = data->Report;
+
+	// Tangents, triangle order and 16-bit indices for arrays loaded from a source file
+	auto prepareArrays = [&](std::vector<Vertex>& vertices, std::vector<unsigned>& indices, bool compute_tangents)
+	{
+		if (compute_tangents)
+			ComputeTangents(vertices, indices.data(), indices.size());
+		report.TangentTime = timer.Lap();
+
+#ifdef MESH_OPTIMIZE_VERTEX_CACHE
+		const VertexCacheStats before = AnalyzeVertexCache(indices.data(), data->IndexRanges);
+		OptimizeVertexCache(indices.data(), data->IndexRanges);
+#ifdef MESH_OPTIMIZE_OVERDRAW
+		OptimizeOverdraw(vertices.data(), indices.data(), data->IndexRanges);
+#endif
+		const VertexCacheStats after = AnalyzeVertexCache(indices.data(), data->IndexRanges);
+		report.ACMRBefore = before.ACMR();
+		report.ACMRAfter = after.ACMR();
+		report.ATVRBefore = before.ATVR();
+		report.ATVRAfter = after.ATVR();
+		report.OptimizeTime = timer.Lap();
+#endif
+
+#ifdef MESH_OPTIMIZE_VERTEX_FETCH
+		// for the vertices as they are uploaded, see MESH_COMPACT_VERTICES
+		report.OverfetchBefore = AnalyzeVertexFetch(indices.data(), data->IndexRanges, vertices.size(), UploadVertexSize).Overfetch();
+		OptimizeVertexFetch(vertices, indices.data(), data->IndexRanges, UploadVertexSize);
+		report.OverfetchAfter = AnalyzeVertexFetch(indices.data(), data->IndexRanges, vertices.size(), UploadVertexSize).Overfetch();
+		report.FetchTime = timer.Lap();
+#endif
+
+#ifdef MESH_GENERATE_LODS
+		// The levels are added to the index buffer and share the vertices
+		const size_t meshIndexCount = indices.size();
+		data->Lods = GenerateLods(vertices.data(), vertices.size(), indices, data->IndexRanges);
+		for (const MeshLod& lod : data->Lods)
+		{
+			size_t triangles = 0;
+			for (const IndexRange& range : lod.IndexRanges)
+				triangles += range.Size / 3;
+			report.Lods.push_back({ triangles, lod.Error });
+		}
+		report.LodTime = timer.Lap();
+#endif
+
+		data->Vertices = vertices.data();
+		data->VertexCount = vertices.size();
+		data->Indices = indices.data();
+		data->IndexCount = indices.size();
 
-	// Load and organize indices in ranges per drawcall (material)
-	std::vector<unsigned> indices;
-	unsigned int indexOffset = 0;
+#ifdef MESH_16BIT_INDICES
+		bool split = false;
+#ifdef MESH_SPLIT_FOR_16BIT_INDICES
+		split = true;
+#endif
+#ifdef MESH_GENERATE_LODS
+		// Ranges of the levels may be split and rebased like those of the mesh
+		std::vector<IndexRange> ranges = GatherLodRanges(data->IndexRanges, data->Lods);
+#else
+		std::vector<IndexRange>& ranges = data->IndexRanges;
+#endif
+		if (MakeIndices16(vertices, indices, ranges, data->Indices16, split))
+		{
+			std::vector<unsigned>().swap(indices);
+			data->Vertices = vertices.data();
+			data->VertexCount = vertices.size();
+			data->Indices = data->Indices16.data();
+			data->IndexSize = sizeof(uint16_t);
+		}
+#ifdef MESH_GENERATE_LODS
+		ScatterLodRanges(ranges, meshIndexCount, data->IndexRanges, data->Lods);
+#endif
+		report.IndexTime = timer.Lap();
+#endif
+	};
+
+	if (has_suffix(objfile, ".glb"))
+	{
+		// glTF binaries are not cached, files written by GLBLoader::Save() are used in place
+		GLBLoader& glb = data->Glb;
+		glb.Load(objfile);
+		report = glb.Report;
+		timer.Lap();
+		data->IndexRanges.swap(glb.IndexRanges);
+		data->Materials.swap(glb.Materials);
 
-	for (auto& dc : mesh->Drawcalls)
+		if (glb.IsMapped())
+		{
+			data->Vertices = glb.Vertices();
+			data->VertexCount = glb.VertexCount();
+			data->Indices = glb.Indices();
+			data->IndexCount = glb.IndexCount();
+			data->IndexSize = glb.IndexSize();
+		}
+		else
+			prepareArrays(glb.VertexStorage, glb.IndexStorage, !glb.HasTangents);
+	}
+	else
 	{
-		// Append the drawcall indices
-		for (auto& tri : dc.Triangles)
-			indices.insert(indices.end(), tri.VertexIndices, tri.VertexIndices + 3);
+#ifdef MESH_BINARY_CACHE
+		if (data->Cache.Load(objfile))
+		{
+			MeshCache& cache = data->Cache;
+			data->Vertices = cache.Vertices();
+			data->VertexCount = cache.VertexCount();
+			data->Indices = cache.Indices();
+			data->IndexCount = cache.IndexCount();
+			data->IndexSize = cache.IndexSize();
+			data->IndexRanges.swap(cache.IndexRanges);
+			data->Lods.swap(cache.Lods);
+			data->Materials.swap(cache.Materials);
+			data->FromCache = true;
+
+			report.Filename = objfile;
+			report.FromCache = true;
+			report.Vertices = data->VertexCount;
+			for (const IndexRange& range : data->IndexRanges)
+				report.Triangles += range.Size / 3;
+			for (const MeshLod& lod : data->Lods)
+			{
+				size_t triangles = 0;
+				for (const IndexRange& range : lod.IndexRanges)
+					triangles += range.Size / 3;
+				report.Lods.push_back({ triangles, lod.Error });
+			}
+			report.Materials = data->Materials.size();
+			report.CacheReadTime = timer.Lap();
+		}
+#endif
+
+		if (!data->FromCache)
+		{
+			std::vector<std::string> sources = { objfile };
+			if (has_suffix(objfile, ".ply"))
+			{
+				// PLY meshes are indexed already, there is nothing to weld
+				PLYLoader& mesh = data->Ply;
+				mesh.Load(objfile);
+				data->IndexRanges.swap(mesh.IndexRanges);
+				report = mesh.Report;
+				timer.Lap();
 
-		// Create a range
-		unsigned int indexSize = (unsigned int)dc.Triangles.size() * 3;
-		int materialIndex = dc.MaterialIndex > -1 ? dc.MaterialIndex : -1;
-		m_index_ranges.push_back({ indexOffset, indexSize, 0, materialIndex });
+				data->Materials.swap(mesh.Materials);
+				prepareArrays(mesh.Vertices, mesh.Indices, true);
+			}
+			else
+			{
+				OBJLoader& mesh = data->Mesh;
 
-		indexOffset = (unsigned int)indices.size();
+				// Load the OBJ straight into an index buffer with a range per drawcall (material)
+				mesh.OnDrawcallParsed = on_drawcall;
+				mesh.Load(objfile, true, true, OBJOutput::IndexBuffer);
+				data->IndexRanges.swap(mesh.IndexRanges);
+				report = mesh.Report;
+				timer.Lap();
+
+				// Copy materials from mesh
+				data->Materials.swap(mesh.Materials);
+
+				prepareArrays(mesh.Vertices, mesh.Indices, true);
+				sources.insert(sources.end(), mesh.MaterialFiles.begin(), mesh.MaterialFiles.end());
+			}
+
+#ifdef MESH_BINARY_CACHE
+			if (!MeshCache::Save(objfile, sources, data->Vertices, data->VertexCount,
+				data->Indices, data->IndexCount, data->IndexSize, data->IndexRanges, data->Lods, data->Materials))
+				std::cout << "Failed to write mesh cache for " << objfile << std::endl;
+			report.CacheWriteTime = timer.Lap();
+#endif
+		}
 	}
 
-	//--- calculate tangent and binormal ---
-	//reset T and B
-	for (auto& v : mesh->Vertices) {
-		v.Tangent = vec3f_zero;
-		v.Binormal = vec3f_zero;
+	// For picking the level of detail
+	data->Bounds = BoundingSphere(data->Vertices, data->VertexCount);
+
+#ifdef MESH_COMPACT_VERTICES
+	// Encoded here rather than in the mesh cache, which keeps full vertices for other uses
+	data->CompactVertices.resize(data->VertexCount);
+	data->Decode = CompressVertices(data->Vertices, data->VertexCount, data->CompactVertices.data());
+	report.CompactTime = timer.Lap();
+#endif
+
+#ifndef MESH_LAZY_TEXTURES
+	// Decode the textures, they are uploaded with the buffers
+	data->DiffuseImages.resize(data->Materials.size());
+	data->NormalImages.resize(data->Materials.size());
+	for (size_t i = 0; i < data->Materials.size(); i++)
+	{
+		const Material& material = data->Materials[i];
+		if (material.DiffuseTextureFilename.size())
+		{
+			DecodeImage(material.DiffuseTextureFilename.c_str(), true, &data->DiffuseImages[i]);
+			report.Textures.push_back({ material.DiffuseTextureFilename, timer.Lap(), (bool)data->DiffuseImages[i].Pixels });
+		}
+		if (material.NormalTextureFilename.size())
+		{
+			DecodeImage(material.NormalTextureFilename.c_str(), true, &data->NormalImages[i]);
+			report.Textures.push_back({ material.NormalTextureFilename, timer.Lap(), (bool)data->NormalImages[i].Pixels });
+		}
 	}
+#endif
+
+	report.TotalTime = loadTimer.Lap();
+	return data;
+}
+
+void OBJModel::ComputeTangents(std::vector<Vertex>& vertices, const unsigned* indices, size_t index_count)
+{
+	::ComputeTangents(vertices.data(), vertices.size(), indices, index_count);
+}
+
+void OBJModel::StreamDrawcall(
+	const Vertex* vertices,
+	size_t vertex_count,
+	const unsigned* indices,
+	size_t index_count,
+	const Material* material,
+	const std::weak_ptr<MeshAsset>& asset,
+	const std::shared_ptr<const std::atomic<bool>>& loaded,
+	ID3D11Device* dxdevice,
+	AsyncLoader& loader)
+{
+	if (asset.expired() || *loaded || !index_count)
+		return;
+
+	// Copy the drawcall, the loader's arrays are only valid during the callback
+	auto chunkVertices = std::make_shared<std::vector<Vertex>>(vertices, vertices + vertex_count);
+	ComputeTangents(*chunkVertices, indices, index_count);
 
-	//compute average T and B for each vertex per triangle
-	for (int i = 0; i + 2 < indices.size(); i += 3) {
-			compute_TB(mesh->Vertices[indices[i]], mesh->Vertices[indices[i + 1]], mesh->Vertices[indices[i + 2]]);
+	auto chunkIndices = std::make_shared<std::vector<unsigned>>(indices, indices + index_count);
+	auto chunkIndices16 = std::make_shared<std::vector<uint16_t>>();
+	if (vertex_count <= 0x10000)
+	{
+		chunkIndices16->assign(indices, indices + index_count);
+		std::vector<unsigned>().swap(*chunkIndices);
 	}
 
-	//normalize T and B, this gives us a weighted average for T and B as compute_TB() uses compound assignment
-	for (auto& v : mesh->Vertices) {
-		v.Tangent = v.Tangent.normalize();
-		v.Binormal = v.Binormal.normalize();
+	MeshChunk chunk;
+	chunk.IndexCount = (UINT)index_count;
+	chunk.IndexFormat = chunkIndices16->size() ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	const Material& colours = material ? *material : DefaultMaterial;
+	chunk.Ambient = vec4f(colours.AmbientColour, 1);
+	chunk.Diffuse = vec4f(colours.DiffuseColour, 1);
+	chunk.Specular = vec4f(colours.SpecularColour, 1);
+
+	loader.QueueUpload([=]() mutable
+	{
+		std::shared_ptr<MeshAsset> target = asset.lock();
+		if (!target || *loaded || target->IsReady() || target->IsFailed())
+			return;
+
+		D3D11_BUFFER_DESC vertexbufferDesc = { 0 };
+		vertexbufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		vertexbufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		vertexbufferDesc.ByteWidth = (UINT)(chunkVertices->size() * sizeof(Vertex));
+		D3D11_SUBRESOURCE_DATA vertexData = { 0 };
+		vertexData.pSysMem = chunkVertices->data();
+		dxdevice->CreateBuffer(&vertexbufferDesc, &vertexData, &chunk.VertexBuffer);
+		SETNAME(chunk.VertexBuffer, "ChunkVertexBuffer");
+
+		D3D11_BUFFER_DESC indexbufferDesc = { 0 };
+		indexbufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		indexbufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		D3D11_SUBRESOURCE_DATA indexData = { 0 };
+		if (chunkIndices16->size())
+		{
+			indexbufferDesc.ByteWidth = (UINT)(chunkIndices16->size() * sizeof(uint16_t));
+			indexData.pSysMem = chunkIndices16->data();
+		}
+		else
+		{
+			indexbufferDesc.ByteWidth = (UINT)(chunkIndices->size() * sizeof(unsigned));
+			indexData.pSysMem = chunkIndices->data();
+		}
+		dxdevice->CreateBuffer(&indexbufferDesc, &indexData, &chunk.IndexBuffer);
+		SETNAME(chunk.IndexBuffer, "ChunkIndexBuffer");
+
+		if (!target->ChunkNormalTexture.TextureView)
+			LoadDefaultTexture(dxdevice, &target->ChunkNormalTexture);
+
+		target->Chunks.push_back(chunk);
+	});
+}
+
+void OBJModel::CreateDeviceResources(
+	MeshData& data,
+	MeshAsset& asset,
+	ID3D11Device* dxdevice,
+	ID3D11DeviceContext* dxdevice_context)
+{
+	LoadTimer timer;
+	const std::string& objfile = data.Report.Filename;
+	asset.IndexRanges.swap(data.IndexRanges);
+	asset.Lods.swap(data.Lods);
+	asset.Bounds = data.Bounds;
+
+	// Materials come from the global table, identical materials of other meshes are shared along with their textures
+	asset.Materials.reserve(data.Materials.size());
+	for (const Material& material : data.Materials)
+	{
+#ifdef MESH_SHARE_MATERIALS
+		asset.Materials.push_back(MaterialTable::Acquire(material));
+#else
+		asset.Materials.push_back(std::make_shared<SharedMaterial>(material));
+#endif
 	}
+	asset.Report = data.Report;
+	LoadReport& report = asset.Report;
+	const double decodeTime = report.TextureTime();
+
+	asset.IndexFormat = data.IndexSize == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+	// The complete buffers replace the drawcalls streamed in while loading
+	asset.ReleaseChunks();
 
 	// Vertex array descriptor
 	D3D11_BUFFER_DESC vertexbufferDesc = { 0 };
@@ -52,14 +482,32 @@ OBJModel::OBJModel(
 	vertexbufferDesc.CPUAccessFlags = 0;
 	vertexbufferDesc.Usage = D3D11_USAGE_DEFAULT;
 	vertexbufferDesc.MiscFlags = 0;
-	vertexbufferDesc.ByteWidth = (UINT)(mesh->Vertices.size() * sizeof(Vertex));
 
 	// Data resource
 	D3D11_SUBRESOURCE_DATA vertexData = { 0 };
-	vertexData.pSysMem = &(mesh->Vertices)[0];
+#ifdef MESH_COMPACT_VERTICES
+	asset.VertexStride = sizeof(CompactVertex);
+	vertexData.pSysMem = data.CompactVertices.data();
+#else
+	asset.VertexStride = sizeof(Vertex);
+	vertexData.pSysMem = data.Vertices;
+#endif
+	vertexbufferDesc.ByteWidth = (UINT)(data.VertexCount * asset.VertexStride);
 	// Create vertex buffer on device using descriptor & data
-	dxdevice->CreateBuffer(&vertexbufferDesc, &vertexData, &m_vertex_buffer);
-	SETNAME(m_vertex_buffer, "VertexBuffer");
+	dxdevice->CreateBuffer(&vertexbufferDesc, &vertexData, &asset.VertexBuffer);
+	SETNAME(asset.VertexBuffer, "VertexBuffer");
+
+#ifdef MESH_COMPACT_VERTICES
+	// Constants for VS_compact to decode the positions
+	D3D11_BUFFER_DESC decodebufferDesc = { 0 };
+	decodebufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	decodebufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	decodebufferDesc.ByteWidth = sizeof(CompactVertexDecode);
+	D3D11_SUBRESOURCE_DATA decodeData = { 0 };
+	decodeData.pSysMem = &data.Decode;
+	dxdevice->CreateBuffer(&decodebufferDesc, &decodeData, &asset.DecodeBuffer);
+	SETNAME(asset.DecodeBuffer, "DecodeBuffer");
+#endif
 
 	// Index array descriptor
 	D3D11_BUFFER_DESC indexbufferDesc = { 0 };
@@ -67,31 +515,59 @@ OBJModel::OBJModel(
 	indexbufferDesc.CPUAccessFlags = 0;
 	indexbufferDesc.Usage = D3D11_USAGE_DEFAULT;
 	indexbufferDesc.MiscFlags = 0;
-	indexbufferDesc.ByteWidth = (UINT)(indices.size() * sizeof(unsigned));
+	indexbufferDesc.ByteWidth = (UINT)(data.IndexCount * data.IndexSize);
 	// Data resource
 	D3D11_SUBRESOURCE_DATA indexData = { 0 };
-	indexData.pSysMem = &indices[0];
+	indexData.pSysMem = data.Indices;
 	// Create index buffer on device using descriptor & data
-	dxdevice->CreateBuffer(&indexbufferDesc, &indexData, &m_index_buffer);
-	SETNAME(m_index_buffer, "IndexBuffer");
+	dxdevice->CreateBuffer(&indexbufferDesc, &indexData, &asset.IndexBuffer);
+	SETNAME(asset.IndexBuffer, "IndexBuffer");
 
-	// Copy materials from mesh
-	append_materials(mesh->Materials);
+	report.BufferTime = timer.Lap();
+	report.Drawcalls = asset.IndexRanges.size();
+	report.VertexBytes = data.VertexCount * asset.VertexStride;
+	report.IndexBytes = data.IndexCount * data.IndexSize;
 
-	// Go through materials and load textures (if any) to device
+#ifdef MESH_LAZY_TEXTURES
+	// Textures are requested by Render(), the fallbacks are bound until they are ready
+	const uint8_t white[] = { 255, 255, 255, 255 };
+	CreateSolidTexture(dxdevice, white, &asset.FallbackDiffuseTexture);
+	LoadDefaultTexture(dxdevice, &asset.FallbackNormalTexture);
+#else
+	// Go through materials and upload the decoded textures (if any) to device
 	std::cout << "Loading textures..." << std::endl;
-	for (auto& material : m_materials)
+	size_t decodedTexture = 0;
+	for (size_t i = 0; i < asset.Materials.size(); i++)
 	{
+		SharedMaterial& material = *asset.Materials[i];
 		HRESULT hr;
 
+		// Upload times are added to the decode times recorded by LoadMeshData()
+		auto reportTexture = [&]()
+		{
+			LoadReport::TextureLoad& texture = report.Textures[decodedTexture++];
+			texture.Time += timer.Lap();
+			texture.Succeeded = SUCCEEDED(hr);
+		};
+
+		// A material shared with a mesh loaded earlier has its textures already
+		if (material.TexturesRequested)
+		{
+			decodedTexture += material.DiffuseTextureFilename.size() ? 1 : 0;
+			decodedTexture += material.NormalTextureFilename.size() ? 1 : 0;
+			continue;
+		}
+		material.TexturesRequested = true;
+
 		// Load Diffuse texture
 		if (material.DiffuseTextureFilename.size()) {
 
-			hr = LoadTextureFromFile(
+			hr = CreateTextureFromImage(
 				dxdevice,
 				dxdevice_context,
-				material.DiffuseTextureFilename.c_str(),
+				data.DiffuseImages[i],
 				&material.DiffuseTexture);
+			reportTexture();
 			std::cout << "\t" << material.DiffuseTextureFilename
 				<< (SUCCEEDED(hr) ? " - OK" : "- FAILED") << std::endl;
 		}
@@ -99,16 +575,18 @@ OBJModel::OBJModel(
 		// Load Normal texture
 		if (material.NormalTextureFilename.size()) {
 
-			hr = LoadTextureFromFile(
+			hr = CreateTextureFromImage(
 				dxdevice,
 				dxdevice_context,
-				material.NormalTextureFilename.c_str(),
+				data.NormalImages[i],
 				&material.NormalTexture);
+			reportTexture();
 			std::cout << "\t" << material.NormalTextureFilename
 				<< (SUCCEEDED(hr) ? " - OK" : "- FAILED") << std::endl;
 		}
 		else {
 			hr = LoadDefaultTexture(dxdevice, &material.NormalTexture);
+			report.Textures.push_back({ "(default normal map)", timer.Lap(), SUCCEEDED(hr) });
 			std::cout << "\t" << "Default normal map texture"
 				<< (SUCCEEDED(hr) ? " - OK" : "- FAILED") << std::endl;
 		}
@@ -117,29 +595,68 @@ OBJModel::OBJModel(
 		// ...
 	}
 	std::cout << "Done." << std::endl;
+#endif
 
-	SAFE_DELETE(mesh);
+	report.TotalTime += report.BufferTime + report.TextureTime() - decodeTime;
+	printf("%s: mesh %s in %.3fs (%d drawcalls), textures in %.3fs\n",
+		objfile.c_str(),
+		data.FromCache ? "read from cache" : "loaded from source",
+		report.TotalTime - report.TextureTime(),
+		(int)asset.IndexRanges.size(),
+		report.TextureTime());
 }
 
 void OBJModel::Render() const
 {
+	// Until the mesh has been loaded, draw what has been streamed in (if anything, and nothing
+	// if the load failed)
+	if (!m_asset->IsReady())
+	{
+		RenderChunks();
+		return;
+	}
+
+	// Compact vertices are decoded by their own vertex shader, with the constants in slot b1
+	const bool compact = m_asset->DecodeBuffer && s_compact_vertex_shader;
+	if (compact)
+	{
+		bind_shader(nullptr, m_dxdevice_context, s_compact_vertex_shader);
+		m_dxdevice_context->VSSetConstantBuffers(1, 1, &m_asset->DecodeBuffer);
+	}
+
 	// Bind vertex buffer
-	const UINT32 stride = sizeof(Vertex);
+	const UINT32 stride = m_asset->VertexStride;
 	const UINT32 offset = 0;
-	m_dxdevice_context->IASetVertexBuffers(0, 1, &m_vertex_buffer, &stride, &offset);
+	m_dxdevice_context->IASetVertexBuffers(0, 1, &m_asset->VertexBuffer, &stride, &offset);
 
 	// Bind index buffer
-	m_dxdevice_context->IASetIndexBuffer(m_index_buffer, DXGI_FORMAT_R32_UINT, 0);
+	m_dxdevice_context->IASetIndexBuffer(m_asset->IndexBuffer, m_asset->IndexFormat, 0);
 
-	// Iterate Drawcalls
-	for (auto& indexRange : m_index_ranges)
+	// Iterate Drawcalls, of the level of detail picked by SelectLod()
+	const bool lod = m_lod >= 0 && (size_t)m_lod < m_asset->Lods.size();
+	for (auto& indexRange : lod ? m_asset->Lods[m_lod].IndexRanges : m_asset->IndexRanges)
 	{
 		// Fetch material
-		const Material& material = m_materials[indexRange.MaterialIndex];
+		const SharedMaterial& material = *m_asset->Materials[indexRange.MaterialIndex];
+
+#ifdef MESH_LAZY_TEXTURES
+		if (!material.TexturesRequested)
+			RequestTextures(indexRange.MaterialIndex);
 
+		// Fallbacks until the textures have been uploaded, materials without a normal map keep the flat one
+		ID3D11ShaderResourceView* diffuseView = material.DiffuseTexture.TextureView;
+		if (!diffuseView && material.DiffuseTextureFilename.size())
+			diffuseView = m_asset->FallbackDiffuseTexture.TextureView;
+		ID3D11ShaderResourceView* normalView = material.NormalTexture.TextureView ?
+			material.NormalTexture.TextureView : m_asset->FallbackNormalTexture.TextureView;
+
+		m_dxdevice_context->PSSetShaderResources(0, 1, &diffuseView);
+		m_dxdevice_context->PSSetShaderResources(1, 1, &normalView);
+#else
 		// Bind diffuse texture to slot t0 of the PS
 		m_dxdevice_context->PSSetShaderResources(0, 1, &material.DiffuseTexture.TextureView);
 		m_dxdevice_context->PSSetShaderResources(1, 1, &material.NormalTexture.TextureView);
+#endif
 
 		// + bind other textures here, e.g. a normal map, to appropriate slots
 
@@ -147,17 +664,132 @@ void OBJModel::Render() const
 		m_dxdevice_context->PSSetConstantBuffers(1, 1, &m_material_buffer);
 
 		// Make the drawcall
-		m_dxdevice_context->DrawIndexed(indexRange.Size, indexRange.Start, 0);
+		m_dxdevice_context->DrawIndexed(indexRange.Size, indexRange.Start, (INT)indexRange.Offset);
+	}
+
+	if (compact && s_vertex_shader)
+		bind_shader(nullptr, m_dxdevice_context, s_vertex_shader);
+}
+
+void OBJModel::SelectLod(const mat4f& model_to_view, const mat4f& projection, float viewport_height)
+{
+	m_lod = -1;
+	if (!m_asset->IsReady() || m_asset->Lods.empty())
+		return;
+
+	// Distance to the bounding sphere and the largest scale of the transform
+	const vec4f& bounds = m_asset->Bounds;
+	const vec3f centre = (model_to_view * vec4f(bounds.xyz(), 1.0f)).xyz();
+	const float scale = (std::max)((model_to_view * vec4f(1, 0, 0, 0)).xyz().length(),
+		(std::max)((model_to_view * vec4f(0, 1, 0, 0)).xyz().length(), (model_to_view * vec4f(0, 0, 1, 0)).xyz().length()));
+	const float distance = centre.length() - bounds.w * scale;
+	if (distance <= 0)
+		return;
+
+	// The coarsest level whose error projects to at most MESH_LOD_PIXEL_ERROR pixels
+	const float pixelsPerUnit = 0.5f * viewport_height * projection.m22 * scale / distance;
+	for (size_t i = 0; i < m_asset->Lods.size(); i++)
+	{
+		if (m_asset->Lods[i].Error * pixelsPerUnit > MESH_LOD_PIXEL_ERROR)
+			break;
+		m_lod = (int)i;
 	}
 }
 
-OBJModel::~OBJModel()
+void OBJModel::SetVertexShaders(shader_data* standard, shader_data* compact)
+{
+	s_vertex_shader = standard;
+	s_compact_vertex_shader = compact;
+}
+
+void OBJModel::RequestTextures(size_t material_index) const
+{
+	SharedMaterial& material = *m_asset->Materials[material_index];
+	material.TexturesRequested = true;
+
+	const std::string diffuseFile = material.DiffuseTextureFilename;
+	const std::string normalFile = material.NormalTextureFilename;
+	if (diffuseFile.empty() && normalFile.empty())
+		return;
+
+	// Decode, then upload on the render thread. The upload only holds weak references,
+	// textures of materials released in the meantime are dropped.
+	std::weak_ptr<SharedMaterial> weakMaterial = m_asset->Materials[material_index];
+	std::weak_ptr<MeshAsset> weakAsset = m_asset;
+	ID3D11Device* dxdevice = m_dxdevice;
+	ID3D11DeviceContext* dxdevice_context = m_dxdevice_context;
+	AsyncLoader::Job job = [weakMaterial, weakAsset, diffuseFile, normalFile, dxdevice, dxdevice_context]() -> AsyncLoader::Upload
+	{
+		if (weakMaterial.expired())
+			return nullptr;
+
+		LoadTimer timer;
+		Image diffuseImage, normalImage;
+		double diffuseTime = 0, normalTime = 0;
+		if (diffuseFile.size())
+		{
+			DecodeImage(diffuseFile.c_str(), true, &diffuseImage);
+			diffuseTime = timer.Lap();
+		}
+		if (normalFile.size())
+		{
+			DecodeImage(normalFile.c_str(), true, &normalImage);
+			normalTime = timer.Lap();
+		}
+
+		return [=]()
+		{
+			MaterialHandle material = weakMaterial.lock();
+			if (!material)
+				return;
+
+			// the report goes to the mesh that requested the textures
+			std::shared_ptr<MeshAsset> asset = weakAsset.lock();
+			auto reportTexture = [&](const std::string& filename, double time, HRESULT hr)
+			{
+				if (asset)
+					asset->Report.Textures.push_back({ filename, time, SUCCEEDED(hr) });
+				std::cout << "\t" << filename << (SUCCEEDED(hr) ? " - OK" : " - FAILED") << std::endl;
+			};
+
+			LoadTimer uploadTimer;
+			if (diffuseFile.size())
+			{
+				HRESULT hr = CreateTextureFromImage(dxdevice, dxdevice_context, diffuseImage, &material->DiffuseTexture);
+				reportTexture(diffuseFile, diffuseTime + uploadTimer.Lap(), hr);
+			}
+			if (normalFile.size())
+			{
+				HRESULT hr = CreateTextureFromImage(dxdevice, dxdevice_context, normalImage, &material->NormalTexture);
+				reportTexture(normalFile, normalTime + uploadTimer.Lap(), hr);
+			}
+		};
+	};
+
+	if (m_loader)
+		m_loader->Queue(job);
+	else if (AsyncLoader::Upload upload = job())
+		upload();
+}
+
+void OBJModel::RenderChunks() const
 {
-	for (auto& material : m_materials)
+	const UINT32 stride = sizeof(Vertex);
+	const UINT32 offset = 0;
+	ID3D11ShaderResourceView* const noTexture = nullptr;
+
+	for (auto& chunk : m_asset->Chunks)
 	{
-		SAFE_RELEASE(material.DiffuseTexture.TextureView);
-		SAFE_RELEASE(material.NormalTexture.TextureView);
+		m_dxdevice_context->IASetVertexBuffers(0, 1, &chunk.VertexBuffer, &stride, &offset);
+		m_dxdevice_context->IASetIndexBuffer(chunk.IndexBuffer, chunk.IndexFormat, 0);
 
-		// Release other used textures ...
+		// Material colours only, with a flat normal map
+		m_dxdevice_context->PSSetShaderResources(0, 1, &noTexture);
+		m_dxdevice_context->PSSetShaderResources(1, 1, &m_asset->ChunkNormalTexture.TextureView);
+
+		UpdateMaterialBuffer(chunk.Ambient, chunk.Diffuse, chunk.Specular, m_cube_map_mode);
+		m_dxdevice_context->PSSetConstantBuffers(1, 1, &m_material_buffer);
+
+		m_dxdevice_context->DrawIndexed(chunk.IndexCount, 0, 0);
 	}
-}
\ No newline at end of file
+}
@@ -6,6 +6,18 @@
 
 #pragma once
 #include "Model.h"
+#include "meshasset.h"
+
+class AsyncLoader;
+typedef struct shader_data shader_data;
+
+//! Upload and render the drawcalls of background loaded models one by one as they are parsed,
+//! until the complete mesh is ready
+#define MESH_STREAM_DRAWCALLS
+
+//! Decode and upload the textures of a material when it is first drawn instead of when the
+//! model loads. Fallback textures are bound until the real ones are ready.
+#define MESH_LAZY_TEXTURES
 
 /**
  * @brief Model representing a 3D object.
@@ -13,41 +25,95 @@
 */
 class OBJModel : public Model
 {
-	// index ranges, representing Drawcalls, within an index array
-	struct IndexRange
-	{
-		unsigned int Start;
-		unsigned int Size;
-		unsigned Offset;
-		int MaterialIndex;
-	};
-
-	std::vector<IndexRange> m_index_ranges;
-	//std::vector<Material> m_materials;
-
-	void append_materials(const std::vector<Material>& mtl_vec)
-	{
-		m_materials.insert(m_materials.end(), mtl_vec.begin(), mtl_vec.end());
-	}
+	// vertex and index buffers, index ranges (representing Drawcalls) and materials,
+	// shared with other OBJModels loaded from the same file
+	std::shared_ptr<MeshAsset> m_asset;
+
+	// decodes lazily loaded textures in the background, nullptr to load them while rendering
+	AsyncLoader* m_loader = nullptr;
+
+	// level of detail Render() draws, -1 for the full mesh
+	int m_lod = -1;
+
+	struct MeshData;
+	static std::shared_ptr<MeshData> LoadMeshData(const std::string& objfile, const OBJDrawcallCallback& on_drawcall = nullptr);
+	static void StreamDrawcall(const Vertex* vertices, size_t vertex_count, const unsigned* indices, size_t index_count,
+		const Material* material, const std::weak_ptr<MeshAsset>& asset, const std::shared_ptr<const std::atomic<bool>>& loaded,
+		ID3D11Device* dxdevice, AsyncLoader& loader);
+	void RenderChunks() const;
+	void RequestTextures(size_t material_index) const;
+	static void CreateDeviceResources(MeshData& data, MeshAsset& asset, ID3D11Device* dxdevice, ID3D11DeviceContext* dxdevice_context);
+
+	// vertex shaders for Vertex and CompactVertex buffers, see SetVertexShaders()
+	static shader_data* s_vertex_shader;
+	static shader_data* s_compact_vertex_shader;
 
 public:
 
+	/**
+	 * @brief Sets the vertex shaders Render() uses for the vertex formats of loaded meshes.
+	 * @details With MESH_COMPACT_VERTICES, Render() binds the compact shader while drawing the
+	 * mesh and the standard shader again afterwards, so other models are unaffected.
+	 * @param standard Vertex shader (and input layout) for Vertex, bound by default.
+	 * @param compact Vertex shader (and input layout) for CompactVertex.
+	*/
+	static void SetVertexShaders(shader_data* standard, shader_data* compact);
+
+	/**
+	 * @brief Computes the tangents and binormals of a triangle mesh from its texture coordinates.
+	 * @param vertices Vertex array, Tangent and Binormal are overwritten.
+	 * @param indices Triangle list indexing vertices.
+	 * @param index_count Number of indices.
+	*/
+	static void ComputeTangents(std::vector<Vertex>& vertices, const unsigned* indices, size_t index_count);
+
 	/**
 	 * @brief Creates a .obj model.
-	 * @details Uses OBJLoader internaly.
-	 * @param objfile Path to the .obj file.
+	 * @details Uses OBJLoader internaly, or PLYLoader and GLBLoader for .ply and .glb files.
+	 * With MESH_SHARE_ASSETS the mesh is loaded once and shared by all OBJModels created
+	 * from the same file. With MESH_LAZY_TEXTURES the textures of a material are loaded
+	 * during the first Render() that draws it.
+	 * @param objfile Path to the .obj, .ply or .glb file.
 	 * @param dxdevice Valid ID3D11Device.
 	 * @param dxdevice_context Valid ID3D11DeviceContext.
 	*/
 	OBJModel(const std::string& objfile, ID3D11Device* dxdevice, ID3D11DeviceContext* dxdevice_context);
 
+	/**
+	 * @brief Creates a .obj model that is loaded in the background.
+	 * @details Returns right away. The file is parsed and its textures decoded on a loader
+	 * thread, the buffers and textures are created when loader.Update() runs the upload.
+	 * Until then the model renders nothing, or with MESH_STREAM_DRAWCALLS the drawcalls
+	 * (without textures) that have been parsed and uploaded so far.
+	 * With MESH_LAZY_TEXTURES the textures of a material are decoded by the loader once
+	 * the material is first drawn.
+	 * @param objfile Path to the .obj, .ply or .glb file.
+	 * @param dxdevice Valid ID3D11Device.
+	 * @param dxdevice_context Valid ID3D11DeviceContext.
+	 * @param loader Loader that runs the load, must outlive the model.
+	*/
+	OBJModel(const std::string& objfile, ID3D11Device* dxdevice, ID3D11DeviceContext* dxdevice_context, AsyncLoader& loader);
+
+	/**
+	 * @brief True once the mesh has been loaded and is rendered.
+	 * @details Stays false if the load failed, see MeshAsset::IsFailed().
+	*/
+	bool IsLoaded() const { return m_asset->IsReady(); }
+
 	/**
 	 * @brief Renders the model.
 	*/
 	virtual void Render() const;
 
 	/**
-	 * @brief Destructor 
+	 * @brief Picks the coarsest level of detail whose error is at most MESH_LOD_PIXEL_ERROR pixels on screen.
+	 * @details The error is projected at the front of the bounding sphere, so the whole
+	 * mesh meets the bound. Models viewed from inside their bounds draw the full mesh.
+	*/
+	void SelectLod(const mat4f& model_to_view, const mat4f& projection, float viewport_height) override;
+
+	/**
+	 * @brief Timings and sizes recorded while the mesh was loaded, shared with other models using the mesh.
 	*/
-	~OBJModel();
+	const LoadReport* GetLoadReport() const override { return m_asset->IsReady() ? &m_asset->Report : nullptr; }
 };
\ No newline at end of file
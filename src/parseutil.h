@@ -10,6 +10,9 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 
 /**
  * @brief Trims whitespace from the start of a string.
@@ -103,4 +106,211 @@ static bool find_filename_from_suffixes(const std::string& str, const std::vecto
 	return false;
 }
 
+//
+// Tokenizer helpers for parsing directly from a character range [p, end),
+// e.g. a memory mapped file. Newlines are never skipped implicitly.
+//
+
+/**
+ * @brief Skips spaces, tabs and carriage returns.
+ * @param[in] p Current position.
+ * @param[in] end End of the range.
+ * @return Position of the first non-blank character, or end.
+*/
+inline const char* skip_blanks(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p;
+}
+
+/**
+ * @brief Skips to the start of the next line.
+ * @param[in] p Current position.
+ * @param[in] end End of the range.
+ * @return Position after the next '\\n', or end.
+*/
+inline const char* skip_line(const char* p, const char* end)
+{
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    return eol ? eol + 1 : end;
+}
+
+/**
+ * @brief Checks if p is at the end of a line, i.e. at '\\n', a comment or the end of the range.
+*/
+inline bool is_line_end(const char* p, const char* end)
+{
+    return p >= end || *p == '\n' || *p == '#';
+}
+
+/**
+ * @brief Checks if the range starts with keyword followed by a blank or line end.
+ * @param[in] p Current position.
+ * @param[in] end End of the range.
+ * @param[in] keyword Null-terminated keyword, e.g. "usemtl".
+ * @return Position after the keyword, or nullptr if there is no match.
+*/
+inline const char* match_keyword(const char* p, const char* end, const char* keyword)
+{
+    while (*keyword)
+    {
+        if (p >= end || *p != *keyword)
+            return nullptr;
+        p++; keyword++;
+    }
+    if (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+        return nullptr;
+    return p;
+}
+
+/**
+ * @brief Reads a whitespace-delimited token.
+ * @param[in, out] p Current position, moved past the token.
+ * @param[in] end End of the range.
+ * @param[out] res The token, empty if there is none on this line.
+ * @return True if a token was found.
+*/
+inline bool parse_token(const char*& p, const char* end, std::string& res)
+{
+    p = skip_blanks(p, end);
+    const char* start = p;
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+        p++;
+    res.assign(start, p);
+    return p != start;
+}
+
+/**
+ * @brief Reads a signed decimal integer.
+ * @param[in, out] p Current position, moved past the integer on success.
+ * @param[in] end End of the range.
+ * @param[out] res The parsed value.
+ * @return True if at least one digit was read.
+*/
+inline bool parse_int(const char*& p, const char* end, int& res)
+{
+    const char* s = p;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+'))
+        negative = *s++ == '-';
+
+    if (s >= end || (unsigned)(*s - '0') > 9)
+        return false;
+
+    int value = 0;
+    while (s < end && (unsigned)(*s - '0') <= 9)
+        value = value * 10 + (*s++ - '0');
+
+    res = negative ? -value : value;
+    p = s;
+    return true;
+}
+
+/**
+ * @brief Reads a decimal floating point number, e.g. "-1.5e-3".
+ * @details Short numbers, which is what OBJ files mostly contain, are converted
+ * directly with a single correctly rounded operation. Anything else (long mantissas,
+ * large exponents, inf/nan) falls back to strtof, so the result is always the same
+ * as with scanf("%f").
+ * @param[in, out] p Current position, moved past the number on success.
+ * @param[in] end End of the range.
+ * @param[out] res The parsed value.
+ * @return True if a number was read.
+*/
+inline bool parse_float(const char*& p, const char* end, float& res)
+{
+    static const float pow10f[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+    static const double pow10d[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char* s = p;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+'))
+        negative = *s++ == '-';
+
+    uint64_t mantissa = 0;
+    int significant = 0, exponent = 0;
+    bool digits = false, exact = true;
+
+    while (s < end && (unsigned)(*s - '0') <= 9)
+    {
+        if (significant < 19) { mantissa = mantissa * 10 + (*s - '0'); if (mantissa) significant++; }
+        else { exponent++; exact &= *s == '0'; }
+        s++; digits = true;
+    }
+    if (s < end && *s == '.')
+    {
+        s++;
+        while (s < end && (unsigned)(*s - '0') <= 9)
+        {
+            if (significant < 19) { mantissa = mantissa * 10 + (*s - '0'); if (mantissa) significant++; exponent--; }
+            else exact &= *s == '0';
+            s++; digits = true;
+        }
+    }
+    if (digits && s < end && (*s == 'e' || *s == 'E'))
+    {
+        const char* e = s + 1;
+        int exp_value;
+        if (parse_int(e, end, exp_value))
+        {
+            exponent += exp_value;
+            s = e;
+        }
+    }
+
+    if (digits && exact)
+    {
+        // Drop trailing zeros of the fraction, e.g. "1.5000"
+        while (mantissa && exponent < 0 && mantissa % 10 == 0)
+        {
+            mantissa /= 10;
+            exponent++;
+        }
+
+        // Both operands exact in float: one correctly rounded operation
+        if (mantissa <= (1u << 24) && exponent >= -10 && exponent <= 10)
+        {
+            float value = (float)mantissa;
+            value = exponent < 0 ? value / pow10f[-exponent] : value * pow10f[exponent];
+            res = negative ? -value : value;
+            p = s;
+            return true;
+        }
+
+        // Both operands exact in double: the double is correctly rounded, and rounding
+        // it to float is too unless it lies exactly halfway between two floats
+        if (mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+        {
+            double value = (double)mantissa;
+            value = exponent < 0 ? value / pow10d[-exponent] : value * pow10d[exponent];
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            if ((value == 0.0 || value >= 1.17549435e-38) && (bits & 0x1FFFFFFFull) != 0x10000000ull)
+            {
+                res = (float)(negative ? -value : value);
+                p = s;
+                return true;
+            }
+        }
+    }
+
+    // Slow path: copy the token and let the C library do it
+    char buffer[64];
+    size_t length = 0;
+    for (const char* c = p; c < end && length < sizeof(buffer) - 1 && *c != ' ' && *c != '\t' && *c != '\r' && *c != '\n' && *c != '/'; c++)
+        buffer[length++] = *c;
+    buffer[length] = '\0';
+
+    char* parsed_end;
+    float value = strtof(buffer, &parsed_end);
+    if (parsed_end == buffer)
+        return false;
+    res = value;
+    p += parsed_end - buffer;
+    return true;
+}
+
 #endif /* parseutil_h */
\ No newline at end of file
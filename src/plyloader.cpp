@@ -0,0 +1,677 @@
+//
+//  Binary PLY loader
+//
+
+#include <cmath>
+#include <atomic>
+#include <stdexcept>
+#include <algorithm>
+#include "plyloader.h"
+#include "mappedfile.h"
+#include "parseutil.h"
+#include "threadpool.h"
+
+enum class ply_scalar_t { invalid, int8, uint8, int16, uint16, int32, uint32, float32, float64 };
+
+struct ply_property_t
+{
+	std::string name;
+	ply_scalar_t type; // value type, or the item type of a list
+	ply_scalar_t count_type; // count type of a list, invalid for scalar properties
+};
+
+struct ply_element_t
+{
+	std::string name;
+	size_t count;
+	std::vector<ply_property_t> properties;
+	size_t record_size; // 0 if the element has list properties
+};
+
+// Vertex properties that are read, by slot
+enum { SlotX, SlotY, SlotZ, SlotNX, SlotNY, SlotNZ, SlotS, SlotT, SlotCount };
+
+// Records (vertices or faces) decoded by one task
+static const size_t BlockSize = 1 << 14;
+
+static ply_scalar_t parse_scalar_type(const std::string& name)
+{
+	if (name == "char" || name == "int8") return ply_scalar_t::int8;
+	if (name == "uchar" || name == "uint8") return ply_scalar_t::uint8;
+	if (name == "short" || name == "int16") return ply_scalar_t::int16;
+	if (name == "ushort" || name == "uint16") return ply_scalar_t::uint16;
+	if (name == "int" || name == "int32") return ply_scalar_t::int32;
+	if (name == "uint" || name == "uint32") return ply_scalar_t::uint32;
+	if (name == "float" || name == "float32") return ply_scalar_t::float32;
+	if (name == "double" || name == "float64") return ply_scalar_t::float64;
+	return ply_scalar_t::invalid;
+}
+
+static size_t scalar_size(ply_scalar_t type)
+{
+	switch (type)
+	{
+	case ply_scalar_t::int8: case ply_scalar_t::uint8: return 1;
+	case ply_scalar_t::int16: case ply_scalar_t::uint16: return 2;
+	case ply_scalar_t::int32: case ply_scalar_t::uint32: case ply_scalar_t::float32: return 4;
+	case ply_scalar_t::float64: return 8;
+	default: return 0;
+	}
+}
+
+static int vertex_slot(const std::string& name)
+{
+	if (name == "x") return SlotX;
+	if (name == "y") return SlotY;
+	if (name == "z") return SlotZ;
+	if (name == "nx") return SlotNX;
+	if (name == "ny") return SlotNY;
+	if (name == "nz") return SlotNZ;
+	if (name == "s" || name == "u" || name == "texture_u" || name == "texture_s") return SlotS;
+	if (name == "t" || name == "v" || name == "texture_v" || name == "texture_t") return SlotT;
+	return -1;
+}
+
+static inline void load_bytes(const char* p, void* out, size_t size, bool swap)
+{
+	if (!swap)
+		memcpy(out, p, size);
+	else
+		for (size_t i = 0; i < size; i++)
+			((char*)out)[i] = p[size - 1 - i];
+}
+
+static inline float read_float(const char* p, ply_scalar_t type, bool swap)
+{
+	switch (type)
+	{
+	case ply_scalar_t::int8: return (float)*(const int8_t*)p;
+	case ply_scalar_t::uint8: return (float)*(const uint8_t*)p;
+	case ply_scalar_t::int16: { int16_t v; load_bytes(p, &v, sizeof(v), swap); return (float)v; }
+	case ply_scalar_t::uint16: { uint16_t v; load_bytes(p, &v, sizeof(v), swap); return (float)v; }
+	case ply_scalar_t::int32: { int32_t v; load_bytes(p, &v, sizeof(v), swap); return (float)v; }
+	case ply_scalar_t::uint32: { uint32_t v; load_bytes(p, &v, sizeof(v), swap); return (float)v; }
+	case ply_scalar_t::float32: { float v; load_bytes(p, &v, sizeof(v), swap); return v; }
+	case ply_scalar_t::float64: { double v; load_bytes(p, &v, sizeof(v), swap); return (float)v; }
+	default: return 0.0f;
+	}
+}
+
+//
+// Reads an integer such as a list count or a vertex index, -1 if it is negative or not an integer
+//
+static inline int64_t read_int(const char* p, ply_scalar_t type, bool swap)
+{
+	switch (type)
+	{
+	case ply_scalar_t::int8: return (std::max)((int64_t)*(const int8_t*)p, (int64_t)-1);
+	case ply_scalar_t::uint8: return *(const uint8_t*)p;
+	case ply_scalar_t::int16: { int16_t v; load_bytes(p, &v, sizeof(v), swap); return (std::max)((int64_t)v, (int64_t)-1); }
+	case ply_scalar_t::uint16: { uint16_t v; load_bytes(p, &v, sizeof(v), swap); return v; }
+	case ply_scalar_t::int32: { int32_t v; load_bytes(p, &v, sizeof(v), swap); return (std::max)((int64_t)v, (int64_t)-1); }
+	case ply_scalar_t::uint32: { uint32_t v; load_bytes(p, &v, sizeof(v), swap); return v; }
+	default: return -1;
+	}
+}
+
+//
+// Size of a record of an element with list properties, 0 if it does not fit in size bytes
+//
+static size_t record_size(const ply_element_t& element, const char* p, size_t size, bool swap)
+{
+	size_t offset = 0;
+	for (const ply_property_t& property : element.properties)
+	{
+		size_t bytes = scalar_size(property.type);
+		if (property.count_type != ply_scalar_t::invalid)
+		{
+			const size_t countSize = scalar_size(property.count_type);
+			if (size - offset < countSize)
+				return 0;
+			const int64_t count = read_int(p + offset, property.count_type, swap);
+			if (count < 0)
+				return 0;
+			offset += countSize;
+			bytes *= (size_t)count;
+		}
+		if (size - offset < bytes)
+			return 0;
+		offset += bytes;
+	}
+	return offset;
+}
+
+//
+// Smallest size of a record of an element, with every list empty
+//
+static size_t min_record_size(const ply_element_t& element)
+{
+	size_t bytes = 0;
+	for (const ply_property_t& property : element.properties)
+		bytes += scalar_size(property.count_type != ply_scalar_t::invalid ? property.count_type : property.type);
+	return bytes;
+}
+
+//
+// Finds where every block of BlockSize records starts, relative to data, plus the end of the
+// element. Elements with a single list property are first tried as if every list had the length
+// of the first one, which is what meshes with only triangles or only quads look like; that is
+// verified in parallel. Otherwise the records are walked once to find the block starts.
+// uniform_length is set to the common list length, or -1.
+//
+static bool find_blocks(const ply_element_t& element, const char* data, size_t size, bool swap,
+	std::vector<size_t>& starts, int64_t& uniform_length)
+{
+	// The count in the header is checked before anything is sized by it
+	const size_t minSize = min_record_size(element);
+	if (element.count && (!minSize || size / minSize < element.count))
+		return false;
+
+	const size_t blockCount = (element.count + BlockSize - 1) / BlockSize;
+	starts.resize(blockCount + 1);
+	uniform_length = -1;
+
+	size_t fixedSize = element.record_size;
+	size_t countOffset = 0;
+	const ply_property_t* list = nullptr;
+	if (!fixedSize && element.count)
+	{
+		for (const ply_property_t& property : element.properties)
+		{
+			if (property.count_type == ply_scalar_t::invalid)
+				countOffset += list ? 0 : scalar_size(property.type);
+			else if (!list)
+				list = &property;
+			else
+			{
+				list = nullptr;
+				break;
+			}
+		}
+
+		if (list)
+		{
+			// Guess from the first record and check every record's list length
+			fixedSize = record_size(element, data, size, swap);
+			if (fixedSize && (size / fixedSize) >= element.count)
+			{
+				const int64_t length = read_int(data + countOffset, list->count_type, swap);
+				std::atomic<bool> uniform{ true };
+				ThreadPool::Global().ParallelFor(blockCount, [&](size_t block)
+				{
+					const size_t last = (std::min)(element.count, (block + 1) * BlockSize);
+					for (size_t i = block * BlockSize; i < last && uniform; i++)
+					{
+						if (read_int(data + i * fixedSize + countOffset, list->count_type, swap) != length)
+							uniform = false;
+					}
+				});
+				if (uniform)
+					uniform_length = length;
+				else
+					fixedSize = 0;
+			}
+			else
+				fixedSize = 0;
+		}
+	}
+
+	if (fixedSize || !element.count)
+	{
+		if (element.count && size / fixedSize < element.count)
+			return false;
+		for (size_t block = 0; block <= blockCount; block++)
+			starts[block] = (std::min)(block * BlockSize, element.count) * fixedSize;
+		return true;
+	}
+
+	size_t offset = 0;
+	for (size_t i = 0; i < element.count; i++)
+	{
+		if (i % BlockSize == 0)
+			starts[i / BlockSize] = offset;
+		const size_t bytes = record_size(element, data + offset, size - offset, swap);
+		if (!bytes)
+			return false;
+		offset += bytes;
+	}
+	starts[blockCount] = offset;
+	return true;
+}
+
+void PLYLoader::Load(const std::string& filename, bool auto_generate_normals)
+{
+	LoadTimer timer;
+	ThreadPool& threadPool = ThreadPool::Global();
+
+	Vertices.clear();
+	Indices.clear();
+	IndexRanges.clear();
+	Materials.clear();
+	HasNormals = HasTexcoords = false;
+	Report = LoadReport();
+	Report.Filename = filename;
+
+	auto fail = [&](const std::string& what)
+	{
+		throw std::runtime_error("PLY: " + what + " in " + filename);
+	};
+
+	MappedFile file;
+	if (!file.Open(filename))
+		fail("could not open file");
+	const char* p = file.Data();
+	const char* end = p + file.Size();
+	Report.FileBytes = file.Size();
+
+	// Header
+	//
+	if (!p || !match_keyword(p, end, "ply"))
+		fail("not a PLY file");
+	p = skip_line(p, end);
+
+	bool swap = false, format = false;
+	std::vector<ply_element_t> elements;
+	for (;;)
+	{
+		if (p >= end)
+			fail("missing end_header");
+
+		const char* q;
+		std::string token;
+		if ((q = match_keyword(p, end, "format")))
+		{
+			parse_token(q, end, token);
+			if (token == "binary_little_endian")
+				swap = false;
+			else if (token == "binary_big_endian")
+				swap = true;
+			else
+				fail("unsupported format " + token + ", only binary PLY can be loaded");
+			// swap assumes a little endian host, which is all eduRend builds for
+			format = true;
+		}
+		else if ((q = match_keyword(p, end, "element")))
+		{
+			ply_element_t element;
+			parse_token(q, end, element.name);
+			parse_token(q, end, token);
+			element.count = (size_t)strtoull(token.c_str(), nullptr, 10);
+			element.record_size = 0;
+			elements.push_back(element);
+		}
+		else if ((q = match_keyword(p, end, "property")))
+		{
+			if (elements.empty())
+				fail("property outside of an element");
+			ply_property_t property;
+			parse_token(q, end, token);
+			if (token == "list")
+			{
+				parse_token(q, end, token);
+				property.count_type = parse_scalar_type(token);
+				parse_token(q, end, token);
+				property.type = parse_scalar_type(token);
+				if (property.count_type == ply_scalar_t::invalid || property.count_type == ply_scalar_t::float32 ||
+					property.count_type == ply_scalar_t::float64)
+					fail("invalid list count type");
+			}
+			else
+			{
+				property.type = parse_scalar_type(token);
+				property.count_type = ply_scalar_t::invalid;
+			}
+			if (property.type == ply_scalar_t::invalid)
+				fail("unknown property type " + token);
+			parse_token(q, end, property.name);
+			elements.back().properties.push_back(property);
+		}
+		else if (match_keyword(p, end, "end_header"))
+		{
+			p = skip_line(p, end);
+			break;
+		}
+		// comment, obj_info and unknown lines are ignored
+		p = skip_line(p, end);
+	}
+	if (!format)
+		fail("missing format");
+
+	for (ply_element_t& element : elements)
+	{
+		element.record_size = 0;
+		for (const ply_property_t& property : element.properties)
+		{
+			if (property.count_type != ply_scalar_t::invalid)
+			{
+				element.record_size = 0;
+				break;
+			}
+			element.record_size += scalar_size(property.type);
+		}
+	}
+
+	// Element data follows the header in order. Elements before the
+	// vertices and faces are skipped, anything after them is not read.
+	//
+	const ply_element_t* vertexElement = nullptr;
+	const ply_element_t* faceElement = nullptr;
+	const char* vertexData = nullptr;
+	const char* faceData = nullptr;
+	std::vector<size_t> vertexBlocks, faceBlocks;
+	int64_t faceLength = -1;
+	for (const ply_element_t& element : elements)
+	{
+		std::vector<size_t> blocks;
+		int64_t uniformLength;
+		if (!find_blocks(element, p, end - p, swap, blocks, uniformLength))
+			fail("element " + element.name + " exceeds the file");
+
+		if (element.name == "vertex" && !vertexElement)
+		{
+			vertexElement = &element;
+			vertexData = p;
+			vertexBlocks.swap(blocks);
+		}
+		else if (element.name == "face" && !faceElement)
+		{
+			faceElement = &element;
+			faceData = p;
+			faceLength = uniformLength;
+			faceBlocks.swap(blocks);
+		}
+		p += vertexElement == &element ? vertexBlocks.back() : faceElement == &element ? faceBlocks.back() : blocks.back();
+		if (vertexElement && faceElement)
+			break;
+	}
+	if (!vertexElement)
+		fail("missing vertex element");
+
+	// Vertices
+	//
+	if (!vertexElement->record_size && vertexElement->count)
+		fail("list properties in the vertex element are not supported");
+
+	size_t slotOffsets[SlotCount] = { 0 };
+	ply_scalar_t slotTypes[SlotCount] = { ply_scalar_t::invalid };
+	bool hasSlot[SlotCount] = { false };
+	{
+		size_t offset = 0;
+		for (const ply_property_t& property : vertexElement->properties)
+		{
+			const int slot = vertex_slot(property.name);
+			if (slot >= 0 && !hasSlot[slot])
+			{
+				hasSlot[slot] = true;
+				slotOffsets[slot] = offset;
+				slotTypes[slot] = property.type;
+			}
+			offset += scalar_size(property.type);
+		}
+	}
+	if (!hasSlot[SlotX] || !hasSlot[SlotY] || !hasSlot[SlotZ])
+		fail("vertices without x, y and z");
+	HasNormals = hasSlot[SlotNX] && hasSlot[SlotNY] && hasSlot[SlotNZ];
+	HasTexcoords = hasSlot[SlotS] && hasSlot[SlotT];
+
+	const size_t vertexCount = vertexElement->count;
+	const size_t stride = vertexElement->record_size;
+	Vertices.resize(vertexCount);
+	threadPool.ParallelFor(vertexBlocks.size() - 1, [&](size_t block)
+	{
+		const size_t first = block * BlockSize;
+		const size_t last = (std::min)(vertexCount, first + BlockSize);
+		const char* record = vertexData + vertexBlocks[block];
+		auto get = [&](int slot) { return read_float(record + slotOffsets[slot], slotTypes[slot], swap); };
+
+		for (size_t i = first; i < last; i++, record += stride)
+		{
+			Vertex& v = Vertices[i];
+			v.Position = vec3f(get(SlotX), get(SlotY), get(SlotZ));
+			if (HasNormals)
+				v.Normal = vec3f(get(SlotNX), get(SlotNY), get(SlotNZ));
+			if (HasTexcoords)
+				v.TexCoord = vec2f(get(SlotS), get(SlotT));
+		}
+	});
+
+	// Faces, as triangle fans
+	//
+	size_t listOffset = 0;
+	const ply_property_t* indexList = nullptr;
+	if (faceElement)
+	{
+		for (const ply_property_t& property : faceElement->properties)
+		{
+			if (property.count_type != ply_scalar_t::invalid && (property.name == "vertex_indices" || property.name == "vertex_index"))
+			{
+				indexList = &property;
+				break;
+			}
+			if (property.count_type != ply_scalar_t::invalid)
+				listOffset = ~(size_t)0; // a list before the indices, the offset varies
+			else if (listOffset != ~(size_t)0)
+				listOffset += scalar_size(property.type);
+		}
+		if (!indexList)
+			fail("faces without vertex_indices");
+		if (indexList->type == ply_scalar_t::float32 || indexList->type == ply_scalar_t::float64)
+			fail("invalid vertex index type");
+	}
+
+	// Position of the index list within a face record
+	auto findIndexList = [&](const char* record) -> const char*
+	{
+		if (listOffset != ~(size_t)0)
+			return record + listOffset;
+		for (const ply_property_t& property : faceElement->properties)
+		{
+			if (&property == indexList)
+				break;
+			size_t bytes = scalar_size(property.type);
+			if (property.count_type != ply_scalar_t::invalid)
+			{
+				bytes *= (size_t)read_int(record, property.count_type, swap);
+				record += scalar_size(property.count_type);
+			}
+			record += bytes;
+		}
+		return record;
+	};
+
+	const size_t faceCount = faceElement ? faceElement->count : 0;
+	const size_t faceBlockCount = faceElement ? faceBlocks.size() - 1 : 0;
+	const size_t countSize = indexList ? scalar_size(indexList->count_type) : 0;
+	const size_t indexSize = indexList ? scalar_size(indexList->type) : 0;
+
+	// Triangles per block, known up front if all faces have the same number of corners
+	std::vector<size_t> triangleStarts(faceBlockCount + 1, 0);
+	if (faceLength >= 0)
+	{
+		const size_t perFace = faceLength > 2 ? (size_t)faceLength - 2 : 0;
+		for (size_t block = 0; block <= faceBlockCount; block++)
+			triangleStarts[block] = (std::min)(block * BlockSize, faceCount) * perFace;
+	}
+	else if (faceElement)
+	{
+		threadPool.ParallelFor(faceBlockCount, [&](size_t block)
+		{
+			const size_t last = (std::min)(faceCount, (block + 1) * BlockSize);
+			const char* record = faceData + faceBlocks[block];
+			size_t triangles = 0;
+			for (size_t i = block * BlockSize; i < last; i++)
+			{
+				const int64_t corners = read_int(findIndexList(record), indexList->count_type, swap);
+				triangles += corners > 2 ? (size_t)corners - 2 : 0;
+				record += record_size(*faceElement, record, (size_t)-1, swap);
+			}
+			triangleStarts[block + 1] = triangles;
+		});
+		for (size_t block = 0; block < faceBlockCount; block++)
+			triangleStarts[block + 1] += triangleStarts[block];
+	}
+
+	std::atomic<bool> invalidIndex{ false };
+	Indices.resize(triangleStarts.back() * 3);
+	threadPool.ParallelFor(faceBlockCount, [&](size_t block)
+	{
+		const size_t last = (std::min)(faceCount, (block + 1) * BlockSize);
+		const char* record = faceData + faceBlocks[block];
+		const size_t fixedSize = faceLength >= 0 ? (faceBlocks[1] - faceBlocks[0]) / (std::min)(faceCount, BlockSize) : 0;
+		unsigned* out = Indices.data() + triangleStarts[block] * 3;
+
+		for (size_t i = block * BlockSize; i < last; i++)
+		{
+			const char* list = findIndexList(record);
+			const int64_t corners = read_int(list, indexList->count_type, swap);
+			const char* index = list + countSize;
+
+			auto vertex = [&](int64_t k) -> unsigned
+			{
+				const int64_t v = read_int(index + k * indexSize, indexList->type, swap);
+				if (v < 0 || (size_t)v >= vertexCount)
+				{
+					invalidIndex = true;
+					return 0;
+				}
+				return (unsigned)v;
+			};
+
+			if (corners > 2)
+			{
+				const unsigned first = vertex(0);
+				unsigned previous = vertex(1);
+				for (int64_t k = 2; k < corners; k++)
+				{
+					const unsigned current = vertex(k);
+					*out++ = first;
+					*out++ = previous;
+					*out++ = current;
+					previous = current;
+				}
+			}
+			record += fixedSize ? fixedSize : record_size(*faceElement, record, (size_t)-1, swap);
+		}
+	});
+	if (invalidIndex)
+		fail("vertex index out of range");
+
+	Report.ParseTime = timer.Lap();
+
+	// Area weighted vertex normals
+	//
+	if (!HasNormals && auto_generate_normals)
+	{
+		// Each block of triangles sums its face normals into partial sums over the range of
+		// vertices it uses, then every block of vertices adds up the partial sums that reach it,
+		// so no vertex is written by two tasks. Blocks whose vertices are spread wider than
+		// their corners (shuffled vertices, say) add their normals afterwards, one at a time.
+		// Either way the sums do not depend on the number of threads.
+		static const size_t NoPartial = (size_t)-1;
+		struct normal_block_t
+		{
+			unsigned first, last;	// vertices used by the block
+			size_t partial;			// start of its partial sums, or NoPartial
+		};
+		const size_t triangleCount = Indices.size() / 3;
+		std::vector<normal_block_t> normalBlocks((triangleCount + BlockSize - 1) / BlockSize);
+		threadPool.ParallelFor(normalBlocks.size(), [&](size_t block)
+		{
+			const size_t last = (std::min)(triangleCount, (block + 1) * BlockSize) * 3;
+			unsigned first = Indices[block * BlockSize * 3], lastVertex = first;
+			for (size_t i = block * BlockSize * 3; i < last; i++)
+			{
+				first = (std::min)(first, Indices[i]);
+				lastVertex = (std::max)(lastVertex, Indices[i]);
+			}
+			normalBlocks[block] = { first, lastVertex, NoPartial };
+		});
+
+		size_t partialCount = 0;
+		for (size_t block = 0; block < normalBlocks.size(); block++)
+		{
+			normal_block_t& nb = normalBlocks[block];
+			const size_t corners = ((std::min)(triangleCount, (block + 1) * BlockSize) - block * BlockSize) * 3;
+			if (nb.last - nb.first < corners)
+			{
+				nb.partial = partialCount;
+				partialCount += nb.last - nb.first + 1;
+			}
+		}
+		std::vector<vec3f> partialNormals(partialCount, vec3f_zero);
+
+		auto addNormals = [&](size_t block, auto&& normal)
+		{
+			const size_t last = (std::min)(triangleCount, (block + 1) * BlockSize) * 3;
+			for (size_t i = block * BlockSize * 3; i < last; i += 3)
+			{
+				const unsigned i0 = Indices[i], i1 = Indices[i + 1], i2 = Indices[i + 2];
+				const vec3f& p0 = Vertices[i0].Position;
+				const vec3f faceNormal = (Vertices[i1].Position - p0) % (Vertices[i2].Position - p0);
+				normal(i0) += faceNormal;
+				normal(i1) += faceNormal;
+				normal(i2) += faceNormal;
+			}
+		};
+		threadPool.ParallelFor(normalBlocks.size(), [&](size_t block)
+		{
+			const normal_block_t& nb = normalBlocks[block];
+			if (nb.partial != NoPartial)
+				addNormals(block, [&](unsigned i) -> vec3f& { return partialNormals[nb.partial + (i - nb.first)]; });
+		});
+
+		// normalize() returns zero below a fixed length, which small models reach
+		auto unit = [](const vec3f& n)
+		{
+			const float length_squared = n.length_squared();
+			return length_squared > 0.0f ? n * (1.0f / sqrtf(length_squared)) : n;
+		};
+		bool spread = false;
+		for (const normal_block_t& nb : normalBlocks)
+			spread |= nb.partial == NoPartial;
+
+		threadPool.ParallelFor((vertexCount + BlockSize - 1) / BlockSize, [&](size_t block)
+		{
+			const size_t first = block * BlockSize;
+			const size_t last = (std::min)(vertexCount, first + BlockSize);
+			for (const normal_block_t& nb : normalBlocks)
+			{
+				if (nb.partial == NoPartial || nb.last < first || nb.first >= last)
+					continue;
+				const size_t from = (std::max)(first, (size_t)nb.first);
+				const size_t to = (std::min)(last, (size_t)nb.last + 1);
+				for (size_t i = from; i < to; i++)
+					Vertices[i].Normal += partialNormals[nb.partial + (i - nb.first)];
+			}
+			if (!spread)
+				for (size_t i = first; i < last; i++)
+					Vertices[i].Normal = unit(Vertices[i].Normal);
+		});
+
+		if (spread)
+		{
+			for (size_t block = 0; block < normalBlocks.size(); block++)
+				if (normalBlocks[block].partial == NoPartial)
+					addNormals(block, [&](unsigned i) -> vec3f& { return Vertices[i].Normal; });
+			threadPool.ParallelFor((vertexCount + BlockSize - 1) / BlockSize, [&](size_t block)
+			{
+				const size_t last = (std::min)(vertexCount, (block + 1) * BlockSize);
+				for (size_t i = block * BlockSize; i < last; i++)
+					Vertices[i].Normal = unit(Vertices[i].Normal);
+			});
+		}
+		Report.NormalTime = timer.Lap();
+	}
+
+	Materials.push_back(Material());
+	Materials.back().Name = "default";
+	IndexRanges.push_back({ 0, (unsigned)Indices.size(), 0, 0 });
+
+	Report.FilePositions = vertexCount;
+	Report.FileNormals = HasNormals || auto_generate_normals ? vertexCount : 0;
+	Report.FileTexcoords = HasTexcoords ? vertexCount : 0;
+	Report.Vertices = vertexCount;
+	Report.Triangles = Indices.size() / 3;
+	Report.Drawcalls = Report.UnmergedDrawcalls = IndexRanges.size();
+	Report.Materials = Materials.size();
+}
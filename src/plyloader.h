@@ -0,0 +1,51 @@
+/**
+ * @file plyloader.h
+ * @brief Binary PLY loader
+*/
+
+#pragma once
+#ifndef PLYLOADER_H
+#define PLYLOADER_H
+
+#include <vector>
+#include <string>
+#include "Drawcall.h"
+#include "loadreport.h"
+
+/**
+ * @brief Binary PLY loader.
+ * @details Reads binary little- or big-endian PLY files, as written by scanning and
+ * photogrammetry tools, into the index buffer layout of OBJLoader with OBJOutput::IndexBuffer.
+ * PLY vertices are already shared by the faces, so there is no welding: the vertex and face
+ * elements are decoded straight into Vertices and Indices from the memory mapped file, in
+ * blocks on ThreadPool::Global().
+ *
+ * Vertex properties read: x, y, z; nx, ny, nz; s, t (or u, v, texture_u, texture_v), of any
+ * scalar type. Faces are read from the vertex_indices (or vertex_index) list and triangulated
+ * as fans, so triangles and quads both work. Other properties and elements are skipped.
+ *
+ * The whole mesh is one IndexRange with a single default material. ASCII PLY is not supported.
+*/
+class PLYLoader
+{
+public:
+	/**
+	 * @brief Loads a binary .ply file.
+	 * @param filename Path to the file.
+	 * @param auto_generate_normals Should normals be generated if the file has none.
+	 * @throw std::runtime_error if the file can not be read, is not binary PLY or has invalid faces.
+	*/
+	void Load(const std::string& filename, bool auto_generate_normals = true);
+
+	bool HasNormals = false; //!< Does the model contain normals (before generating them)
+	bool HasTexcoords = false; //!< Does the model contain uv-coordinates
+
+	std::vector<Vertex> Vertices; //!< Vertices, without tangents
+	std::vector<unsigned> Indices; //!< Triangle index buffer
+	std::vector<IndexRange> IndexRanges; //!< One range covering Indices
+	std::vector<Material> Materials; //!< One default material
+
+	LoadReport Report; //!< Timings and sizes of the last Load()
+};
+
+#endif
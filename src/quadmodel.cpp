@@ -8,7 +8,7 @@ QuadModel::QuadModel(
 	// Vertex and index arrays
 	// Once their data is loaded to GPU buffers, they are not needed anymore
 	std::vector<Vertex> vertices;
-	std::vector<unsigned> indices;
+	std::vector<uint16_t> indices;
 
 	// Populate the vertex array with 4 Vertices
 	Vertex v0, v1, v2, v3;
@@ -59,7 +59,7 @@ QuadModel::QuadModel(
 	indexbufferDesc.CPUAccessFlags = 0;
 	indexbufferDesc.Usage = D3D11_USAGE_DEFAULT;
 	indexbufferDesc.MiscFlags = 0;
-	indexbufferDesc.ByteWidth = (UINT)(indices.size() * sizeof(unsigned));
+	indexbufferDesc.ByteWidth = (UINT)(indices.size() * sizeof(uint16_t));
 	// Data resource
 	D3D11_SUBRESOURCE_DATA indexData { 0 };
 	indexData.pSysMem = &indices[0];
@@ -79,7 +79,7 @@ void QuadModel::Render() const
 	m_dxdevice_context->IASetVertexBuffers(0, 1, &m_vertex_buffer, &stride, &offset);
 
 	// Bind our index buffer
-	m_dxdevice_context->IASetIndexBuffer(m_index_buffer, DXGI_FORMAT_R32_UINT, 0);
+	m_dxdevice_context->IASetIndexBuffer(m_index_buffer, DXGI_FORMAT_R16_UINT, 0);
 
 	// Make the drawcall
 	m_dxdevice_context->DrawIndexed(m_number_of_indices, 0, 0);
@@ -1,8 +1,10 @@
 
+#include <algorithm>
 #include "Scene.h"
 #include "QuadModel.h"
 #include "cube.h"
 #include "OBJModel.h"
+#include "asyncloader.h"
 
 Scene::Scene(
 	ID3D11Device* dxdevice,
@@ -50,6 +52,10 @@ void OurTestScene::Init()
 	// Move camera to (0,0,5)
 	m_camera->MoveTo({ 0, 0, 5 });
 
+#ifdef SCENE_ASYNC_LOADING
+	m_loader = new AsyncLoader();
+#endif
+
 	//load cube map
 	m_cube_map_texture = new Texture();
 	LoadCubeMap(m_dxdevice, m_cube_map_texture);
@@ -58,21 +64,28 @@ void OurTestScene::Init()
 
 	//Create light sources
 	m_light_pos = { 0, 0,-4 };
-	m_light_debug_model = new OBJModel("assets/sphere/sphere.obj", m_dxdevice, m_dxdevice_context);
+	m_light_debug_model = LoadOBJModel("assets/sphere/sphere.obj");
 
 	// Create objects
 	m_quad = new QuadModel(m_dxdevice, m_dxdevice_context);
 	//m_cube = new Cube(m_dxdevice, m_dxdevice_context);
-	m_cube = new OBJModel("assets/hand/hand.obj", m_dxdevice, m_dxdevice_context);
-	m_sponza = new OBJModel("assets/crytek-sponza/sponza.obj", m_dxdevice, m_dxdevice_context);
+	m_cube = LoadOBJModel("assets/hand/hand.obj");
+	m_sponza = LoadOBJModel("assets/crytek-sponza/sponza.obj");
 	m_sponza->SetCubeMapMode(2);
 
 	//Solar system model objects
-	m_sun = new OBJModel("assets/sphere/sphere.obj", m_dxdevice, m_dxdevice_context);
+	m_sun = LoadOBJModel("assets/sphere/sphere.obj");
 	m_sun->SetCubeMapMode(1);
 	//m_sun = new OBJModel("assets/carbody/carbody.obj", m_dxdevice, m_dxdevice_context);
-	m_earth = new OBJModel("assets/sphere/sphere.obj", m_dxdevice, m_dxdevice_context);
-	m_moon = new OBJModel("assets/sphere/sphere.obj", m_dxdevice, m_dxdevice_context);
+	m_earth = LoadOBJModel("assets/sphere/sphere.obj");
+	m_moon = LoadOBJModel("assets/sphere/sphere.obj");
+}
+
+Model* OurTestScene::LoadOBJModel(const std::string& objfile)
+{
+	if (m_loader)
+		return new OBJModel(objfile, m_dxdevice, m_dxdevice_context, *m_loader);
+	return new OBJModel(objfile, m_dxdevice, m_dxdevice_context);
 }
 
 //
@@ -83,6 +96,10 @@ void OurTestScene::Update(
 	float dt,
 	const InputHandler& input_handler)
 {
+	// Upload models and textures that finished loading in the background
+	if (m_loader)
+		m_loader->Update();
+
 	//converting camera direction vectors to world space
 	vec4f cam_forward_local_homogenous = { 0, 0, -1, 0};
 	vec4f cam_forward_world_homogenous = m_camera->ViewToWorldMatrix() * cam_forward_local_homogenous;
@@ -259,29 +276,38 @@ void OurTestScene::Render()
 
 	// Load matrices + the cube's transformation to the device and render it
 	UpdateTransformationBuffer(m_cube_transform, m_view_matrix, m_projection_matrix);
+	m_cube->SelectLod(m_view_matrix * m_cube_transform, m_projection_matrix, (float)m_window_height);
 	m_cube->Render();
 
 	// Load matrices + Sponza's transformation to the device and render it
 	UpdateTransformationBuffer(m_sponza_transform, m_view_matrix, m_projection_matrix);
+	m_sponza->SelectLod(m_view_matrix * m_sponza_transform, m_projection_matrix, (float)m_window_height);
 	m_sponza->Render();
 
 	// Solar system render
 	UpdateTransformationBuffer(m_sun_transform, m_view_matrix, m_projection_matrix);
+	m_sun->SelectLod(m_view_matrix * m_sun_transform, m_projection_matrix, (float)m_window_height);
 	m_sun->Render();
 
 	UpdateTransformationBuffer(m_earth_transform, m_view_matrix, m_projection_matrix);
+	m_earth->SelectLod(m_view_matrix * m_earth_transform, m_projection_matrix, (float)m_window_height);
 	m_earth->Render();
 
 	UpdateTransformationBuffer(m_moon_transform, m_view_matrix, m_projection_matrix);
+	m_moon->SelectLod(m_view_matrix * m_moon_transform, m_projection_matrix, (float)m_window_height);
 	m_moon->Render();
 
 	// Light debug model
 	UpdateTransformationBuffer(m_light_debug_model_transform, m_view_matrix, m_projection_matrix);
+	m_light_debug_model->SelectLod(m_view_matrix * m_light_debug_model_transform, m_projection_matrix, (float)m_window_height);
 	m_light_debug_model->Render();
 }
 
 void OurTestScene::Release()
 {
+	// Stop background loads first, their uploads write into the scene's textures
+	SAFE_DELETE(m_loader);
+
 	SAFE_DELETE(m_skybox);
 
 	SAFE_DELETE(m_sun);
@@ -319,6 +345,22 @@ void OurTestScene::OnWindowResized(
 	Scene::OnWindowResized(new_width, new_height);
 }
 
+void OurTestScene::GetLoadReports(std::vector<const LoadReport*>& reports) const
+{
+	for (const Model* model : { m_light_debug_model, m_skybox, m_quad, m_cube, m_sponza, m_sun, m_earth, m_moon })
+	{
+		// models sharing a mesh share its report, list it once
+		const LoadReport* report = model ? model->GetLoadReport() : nullptr;
+		if (report && std::find(reports.begin(), reports.end(), report) == reports.end())
+			reports.push_back(report);
+	}
+}
+
+size_t OurTestScene::PendingLoads() const
+{
+	return m_loader ? m_loader->PendingCount() : 0;
+}
+
 void OurTestScene::InitSamplerState() {
 	HRESULT hr;
 	D3D11_SAMPLER_DESC sampler_desc = {
@@ -453,6 +495,31 @@ void OurTestScene::LoadCubeMap(ID3D11Device* dxdevice, Texture* cube_texture) {
 		"assets/cubemaps/debug_cubemap/debug_negz.png"
 	};*/
 
+	if (m_loader)
+	{
+		// Decode on a loader thread, create the texture on the render thread
+		std::vector<std::string> filenames(cube_filenames, cube_filenames + 6);
+		m_loader->Queue([dxdevice, cube_texture, filenames]() -> AsyncLoader::Upload
+		{
+			std::shared_ptr<Image> images(new Image[6], std::default_delete<Image[]>());
+			for (int i = 0; i < 6; i++)
+			{
+				if (FAILED(DecodeImage(filenames[i].c_str(), false, &images.get()[i])))
+				{
+					std::cout << "Cubemap failed to load" << std::endl;
+					return nullptr;
+				}
+			}
+			return [dxdevice, cube_texture, images]()
+			{
+				HRESULT hr = CreateCubeTextureFromImages(dxdevice, images.get(), cube_texture);
+				if (SUCCEEDED(hr)) std::cout << "Cubemap OK" << std::endl;
+				else std::cout << "Cubemap failed to load" << std::endl;
+			};
+		});
+		return;
+	}
+
 	HRESULT hr = LoadCubeTextureFromFile(
 		dxdevice,
 		cube_filenames,
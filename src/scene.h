@@ -14,6 +14,11 @@
 #include "Texture.h"
 #include "buffers.h"
 
+//! Load models and textures in the background, the scene renders what has been loaded so far
+#define SCENE_ASYNC_LOADING
+
+class AsyncLoader;
+
 /**
  * @brief Abstract class defining scene rendering and updating.
 */
@@ -60,6 +65,17 @@ public:
 	*/
 	virtual void OnWindowResized(int window_width,	int window_height);
 
+	/**
+	 * @brief Collects the load reports of the models in the scene.
+	 * @param[out] reports Reports are appended here.
+	*/
+	virtual void GetLoadReports(std::vector<const LoadReport*>& reports) const {}
+
+	/**
+	 * @brief Number of loads still running in the background.
+	*/
+	virtual size_t PendingLoads() const { return 0; }
+
 protected:
 	ID3D11Device*			m_dxdevice; //!< Graphics device, use for creating resources.
 	ID3D11DeviceContext*	m_dxdevice_context; //!< Graphics context, use for binding resources and draw commands.
@@ -149,6 +165,11 @@ class OurTestScene : public Scene
 
 	void LoadCubeMap(ID3D11Device* dxdevice, Texture* cube_texture);
 
+	// Creates an OBJModel, loaded in the background with SCENE_ASYNC_LOADING
+	Model* LoadOBJModel(const std::string& objfile);
+
+	AsyncLoader* m_loader = nullptr; // background loader, null if loading synchronously
+
 public:
 	/**
 	 * @brief Constructor
@@ -187,6 +208,17 @@ public:
 	 * @param window_height New height
 	*/
 	void OnWindowResized(int window_width, int window_height) override;
+
+	/**
+	 * @brief Collects the load reports of the models in the scene
+	 * @param reports Reports are appended here
+	*/
+	void GetLoadReports(std::vector<const LoadReport*>& reports) const override;
+
+	/**
+	 * @brief Number of models and textures still loading in the background
+	*/
+	size_t PendingLoads() const override;
 };
 
 #endif
\ No newline at end of file
@@ -238,60 +238,65 @@ void delete_shader(shader_data* pShader)
 	free(pShader);
 }
 
-void bind_shader(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext, shader_data* pShader)
+void reload_shader(ID3D11Device* pDevice, shader_data* pShader)
 {
-	if (pShader == NULL || pShader->type == SHADER_INVALID)
+	if (pDevice == NULL || pShader == NULL || pShader->type == SHADER_INVALID)
 		return;
 
-	if (pDevice)
+	FILETIME file_write = { 0 };
+	BOOL result = load_file(pShader->file_path, NULL, NULL, &file_write);
+	if (result && CompareFileTime(&file_write, &pShader->last_write) > 0)
 	{
-		FILETIME file_write = { 0 };
-		BOOL result = load_file(pShader->file_path, NULL, NULL, &file_write);
-		if (result && CompareFileTime(&file_write, &pShader->last_write) > 0)
+		pShader->last_write = file_write;
+		char* codeBuffer = NULL;
+		uint32_t fileSize = 0;
+		result = load_file(pShader->file_path, &codeBuffer, &fileSize, NULL);
+		if (result)
 		{
-			pShader->last_write = file_write;
-			char* codeBuffer = NULL;
-			uint32_t fileSize = 0;
-			result = load_file(pShader->file_path, &codeBuffer, &fileSize, NULL);
-			if (result)
+			if (fileSize > 0)
 			{
-				if (fileSize > 0)
-				{
-					ID3DBlob* shaderByteCode = compile_shader(pShader->type, codeBuffer, fileSize, pShader->entrypoint);
+				ID3DBlob* shaderByteCode = compile_shader(pShader->type, codeBuffer, fileSize, pShader->entrypoint);
 
-					if (shaderByteCode != NULL)
+				if (shaderByteCode != NULL)
+				{
+					switch (pShader->type)
 					{
-						switch (pShader->type)
-						{
-						case SHADER_VERTEX:
+					case SHADER_VERTEX:
+					{
+						ID3D11VertexShader* vs;
+						if (create_vertex_Shader(pDevice, shaderByteCode, &vs))
 						{
-							ID3D11VertexShader* vs;
-							if (create_vertex_Shader(pDevice, shaderByteCode, &vs))
-							{
-								pShader->vetex_shader->lpVtbl->Release(pShader->vetex_shader);
-								pShader->vetex_shader = vs;
-							}
+							pShader->vetex_shader->lpVtbl->Release(pShader->vetex_shader);
+							pShader->vetex_shader = vs;
 						}
-						break;
-						case SHADER_PIXEL:
+					}
+					break;
+					case SHADER_PIXEL:
+					{
+						ID3D11PixelShader* ps;
+						if (create_pixel_Shader(pDevice, shaderByteCode, &ps))
 						{
-							ID3D11PixelShader* ps;
-							if (create_pixel_Shader(pDevice, shaderByteCode, &ps))
-							{
-								pShader->pixel_shader->lpVtbl->Release(pShader->pixel_shader);
-								pShader->pixel_shader = ps;
-							}
+							pShader->pixel_shader->lpVtbl->Release(pShader->pixel_shader);
+							pShader->pixel_shader = ps;
 						}
-						break;
-						}
-
-						shaderByteCode->lpVtbl->Release(shaderByteCode);
 					}
+					break;
+					}
+
+					shaderByteCode->lpVtbl->Release(shaderByteCode);
 				}
-				free(codeBuffer);
 			}
+			free(codeBuffer);
 		}
 	}
+}
+
+void bind_shader(ID3D11Device* pDevice, ID3D11DeviceContext* pDeviceContext, shader_data* pShader)
+{
+	if (pShader == NULL || pShader->type == SHADER_INVALID)
+		return;
+
+	reload_shader(pDevice, pShader);
 
 	if (pDeviceContext)
 	{
@@ -40,6 +40,7 @@ extern "C" {
 	 * @see create_shader(ID3D11Device*, const SCHAR*, const char*, SHADER_TYPE, const D3D11_INPUT_ELEMENT_DESC*, uint32_t, shader_data**)
 	 * @see delete_shader(shader_data*)
 	 * @see bind_shader(ID3D11Device*, ID3D11DeviceContext*, shader_data*)
+	 * @see reload_shader(ID3D11Device*, shader_data*)
 	*/
 	typedef struct shader_data shader_data;
 
@@ -88,6 +89,15 @@ extern "C" {
 	*/
 	void delete_shader(shader_data* pShader);
 
+	/**
+	 * @brief Reloads a shader if its HLSL file changed since it was last compiled, without binding it.
+	 * @details For shaders that are bound without a device, which skips the reload.
+	 *
+	 * @param[in] pDevice Pointer to the active DX11 device, if this is left to NULL no reload of the shader will be done.
+	 * @param[in] pShader Pointer to the shader that should be reloaded.
+	*/
+	void reload_shader(ID3D11Device* pDevice, shader_data* pShader);
+
 	/**
 	 * @brief Bind a shader to the DX11 pipeline.
 	 * @details This function does hot reloading of the shader if a ID3D11DeviceContext is supplied.
@@ -28,6 +28,46 @@ HRESULT LoadTextureFromFile(
     ID3D11DeviceContext* dxdevice_context,
     const char* filename,
     Texture* texture_out)
+{
+    Image image;
+    HRESULT hr = DecodeImage(filename, true, &image);
+    if (FAILED(hr))
+        return hr;
+
+    return CreateTextureFromImage(
+        dxdevice,
+        dxdevice_context,
+        image,
+        texture_out);
+}
+
+HRESULT DecodeImage(
+    const char* filename,
+    bool flip_vertically,
+    Image* image_out)
+{
+    // Load from disk into a raw RGBA buffer. The flip setting is per thread
+    // so that images can be decoded on several threads at once.
+    stbi_set_flip_vertically_on_load_thread(flip_vertically ? 1 : 0);
+    int imageWidth = 0;
+    int imageHeight = 0;
+    unsigned char* imageData = stbi_load(filename, &imageWidth, &imageHeight, NULL, 4);
+    if (imageData == nullptr)
+    {
+        return E_FAIL;
+    }
+
+    image_out->Width = imageWidth;
+    image_out->Height = imageHeight;
+    image_out->Pixels = std::shared_ptr<unsigned char>(imageData, stbi_image_free);
+    return S_OK;
+}
+
+HRESULT CreateTextureFromImage(
+    ID3D11Device* dxdevice,
+    ID3D11DeviceContext* dxdevice_context,
+    const Image& image,
+    Texture* texture_out)
 {
     int mipLevels = 1;
     int mipLevelsSRV = 1;
@@ -48,20 +88,15 @@ HRESULT LoadTextureFromFile(
 
     HRESULT hr;
 
-    // Load from disk into a raw RGBA buffer
-    stbi_set_flip_vertically_on_load(1);
-    int imageWidth = 0;
-    int imageHeight = 0;
-    unsigned char* imageData = stbi_load(filename, &imageWidth, &imageHeight, NULL, 4);
-    if (imageData == nullptr)
+    if (!image.Pixels)
     {
         return E_FAIL;
     }
 
     // Create texture
     D3D11_TEXTURE2D_DESC desc = {};
-    desc.Width = imageWidth;
-    desc.Height = imageHeight;
+    desc.Width = image.Width;
+    desc.Height = image.Height;
     desc.MipLevels = mipLevels;
     desc.ArraySize = 1;
     desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -73,7 +108,7 @@ HRESULT LoadTextureFromFile(
 
     ID3D11Texture2D* pTexture = NULL;
     D3D11_SUBRESOURCE_DATA subResource{};
-    subResource.pSysMem = imageData;
+    subResource.pSysMem = image.Pixels.get();
     subResource.SysMemPitch = desc.Width * 4;
     subResource.SysMemSlicePitch = 0;
     D3D11_SUBRESOURCE_DATA* subResourcePtr = &subResource;
@@ -92,7 +127,7 @@ HRESULT LoadTextureFromFile(
             pTexture,
             0,
             0,
-            imageData,
+            image.Pixels.get(),
             subResource.SysMemPitch,
             0);
 
@@ -108,6 +143,7 @@ HRESULT LoadTextureFromFile(
         &srvDesc,
         &texture_out->TextureView)))
     {
+        pTexture->Release();
         return hr;
     }
     SETNAME((texture_out->TextureView), "TextureSRV");
@@ -117,17 +153,25 @@ HRESULT LoadTextureFromFile(
 
     // Cleanup
     pTexture->Release();
-    stbi_image_free(imageData);
 
     // Done
-    texture_out->Width = imageWidth;
-    texture_out->Weight = imageHeight;
+    texture_out->Width = image.Width;
+    texture_out->Weight = image.Height;
     return S_OK;
 }
 
 HRESULT LoadDefaultTexture(
     ID3D11Device* dxdevice,
     Texture* texture_out)
+{
+    const uint8_t flatNormalPixel[] = { 128, 128, 255, 255 };
+    return CreateSolidTexture(dxdevice, flatNormalPixel, texture_out);
+}
+
+HRESULT CreateSolidTexture(
+    ID3D11Device* dxdevice,
+    const uint8_t* rgba,
+    Texture* texture_out)
 {
     HRESULT hr;
 
@@ -144,8 +188,7 @@ HRESULT LoadDefaultTexture(
     desc.CPUAccessFlags = 0;
 
     D3D11_SUBRESOURCE_DATA subResource{};
-    uint8_t flatNormalPixel[] = { 128, 128, 255, 255 };
-    subResource.pSysMem = flatNormalPixel;
+    subResource.pSysMem = rgba;
     subResource.SysMemPitch = 4;
 
     ID3D11Texture2D* pTexture = NULL;
@@ -179,18 +222,30 @@ HRESULT LoadCubeTextureFromFile(
     ID3D11Device* dxdevice,
     const char** filenames,
     Texture* texture_out)
+{
+    Image images[6];
+    for (int i = 0; i < 6; i++)
+    {
+        HRESULT hr = DecodeImage(filenames[i], false, &images[i]);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    return CreateCubeTextureFromImages(dxdevice, images, texture_out);
+}
+
+HRESULT CreateCubeTextureFromImages(
+    ID3D11Device* dxdevice,
+    const Image* images,
+    Texture* texture_out)
 {
     HRESULT hr;
 
-    // Load from disk into a raw RGBA buffer
-    stbi_set_flip_vertically_on_load(0);
-    int imageWidth = 0;
-    int imageHeight = 0;
-    unsigned char* imageData[6]{};
+    const int imageWidth = images[0].Width;
+    const int imageHeight = images[0].Height;
     for (int i = 0; i < 6; i++)
     {
-        imageData[i] = stbi_load(filenames[i], &imageWidth, &imageHeight, NULL, 4);
-        if (imageData[i] == nullptr)
+        if (!images[i].Pixels || images[i].Width != imageWidth || images[i].Height != imageHeight)
         {
             return E_FAIL;
         }
@@ -213,7 +268,7 @@ HRESULT LoadCubeTextureFromFile(
     D3D11_SUBRESOURCE_DATA subResource[6]{};
     for (int i = 0; i < 6; i++)
     {
-        subResource[i].pSysMem = imageData[i];
+        subResource[i].pSysMem = images[i].Pixels.get();
         subResource[i].SysMemPitch = (UINT)imageWidth * 4;
         subResource[i].SysMemSlicePitch = 0;
     }
@@ -234,14 +289,13 @@ HRESULT LoadCubeTextureFromFile(
         &srvDesc,
         &texture_out->TextureView)))
     {
+        pTexture->Release();
         return hr;
     }
     SETNAME((texture_out->TextureView), "TextureSRV");
 
     // Cleanup
     pTexture->Release();
-    for (int i = 0; i < 6; i++)
-        stbi_image_free(imageData[i]);
 
     // Done
     texture_out->Width = imageWidth;
@@ -10,6 +10,7 @@
 
 #include <utility>
 #include <vector>
+#include <memory>
 //#include <wrl/client.h>
 #include "stdafx.h"
 
@@ -30,6 +31,16 @@ struct Texture
 	operator bool() { return (bool)TextureView && Width && Weight; }
 };
 
+/**
+ * @brief RGBA image decoded to CPU memory, not yet uploaded to the device.
+*/
+struct Image
+{
+	int Width = 0; //!< Width of the image in pixels
+	int Height = 0; //!< Height of the image in pixels
+	std::shared_ptr<unsigned char> Pixels; //!< Width * Height RGBA pixels, rows from top to bottom unless flipped
+};
+
 /**
  * @brief Loads a 2D texture from file.
  * @details Calls LoadTextureFromFile(ID3D11Device*,ID3D11DeviceContext*,const char*,Texture*) for the actual work.
@@ -49,6 +60,28 @@ HRESULT LoadTextureFromFile(ID3D11Device* dxdevice,	const char* filename, Textur
  * @return HRESULT of the texture creation.
 */
 HRESULT LoadTextureFromFile(ID3D11Device* dxdevice,	ID3D11DeviceContext* dxdevice_context, const char* filename, Texture* texture_out);
+
+/**
+ * @brief Decodes an image file to RGBA pixels.
+ * @details Does not touch the device, so it can run on any thread while the device is in use.
+ * @param[in] filename File path to a valid image.
+ * @param[in] flip_vertically Store the rows bottom to top, as 2D textures expect.
+ * @param[out] image_out Decoded image.
+ * @return E_FAIL if the file could not be read or decoded.
+*/
+HRESULT DecodeImage(const char* filename, bool flip_vertically, Image* image_out);
+
+/**
+ * @brief Creates a 2D texture from a decoded image.
+ * @param[in] dxdevice Valid ID3D11Device device.
+ * @param[in] dxdevice_context If provided the ID3D11DeviceContext will be used to auto generate mip maps for the texture.
+ * Must then be called on the thread that owns the context.
+ * @param[in] image Image from DecodeImage().
+ * @param[out] texture_out Texture struct to store the resulting texture in.
+ * @return HRESULT of the texture creation.
+*/
+HRESULT CreateTextureFromImage(ID3D11Device* dxdevice, ID3D11DeviceContext* dxdevice_context, const Image& image, Texture* texture_out);
+
 /**
  * @brief Gereates a one pixel texture with RGBA: 128, 128, 255, 255. Used for materials that don't include normal maps.
  * @param[in] dxdevice Valid ID3D11Device device.
@@ -57,6 +90,15 @@ HRESULT LoadTextureFromFile(ID3D11Device* dxdevice,	ID3D11DeviceContext* dxdevic
 */
 HRESULT LoadDefaultTexture(ID3D11Device* dxdevice, Texture* texture_out);
 
+/**
+ * @brief Creates a one pixel texture of a single colour.
+ * @param[in] dxdevice Valid ID3D11Device device.
+ * @param[in] rgba The pixel, 4 bytes RGBA.
+ * @param[out] texture_out Texture struct to store the resulting texture in.
+ * @return HRESULT of the texture creation.
+*/
+HRESULT CreateSolidTexture(ID3D11Device* dxdevice, const uint8_t* rgba, Texture* texture_out);
+
 /**
  * @brief Loads a 3D texture from 6 individual images.
  * @param[in] dxdevice Valid ID3D11Device device.
@@ -66,4 +108,13 @@ HRESULT LoadDefaultTexture(ID3D11Device* dxdevice, Texture* texture_out);
 */
 HRESULT LoadCubeTextureFromFile(ID3D11Device* dxdevice,	const char** filenames,	Texture* texture_out);
 
+/**
+ * @brief Creates a 3D texture from 6 decoded images of the same size.
+ * @param[in] dxdevice Valid ID3D11Device device.
+ * @param[in] images 6 images from DecodeImage(), not flipped.
+ * @param[out] texture_out Texture struct to store the resulting texture in.
+ * @return HRESULT of the texture creation.
+*/
+HRESULT CreateCubeTextureFromImages(ID3D11Device* dxdevice, const Image* images, Texture* texture_out);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+//
+//  Simple fixed size thread pool
+//
+
+#include "threadpool.h"
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned thread_count)
+{
+	if (!thread_count)
+	{
+		unsigned hardware_threads = std::thread::hardware_concurrency();
+		thread_count = hardware_threads > 1 ? hardware_threads - 1 : 0;
+	}
+
+	for (unsigned i = 0; i < thread_count; i++)
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+
+	for (auto& worker : m_workers)
+		worker.join();
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	// Without workers the task has to run right away
+	if (m_workers.empty())
+	{
+		task();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+			if (m_tasks.empty())
+				return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+	if (!count)
+		return;
+
+	// State shared with the helper tasks. Helpers that start after all iterations
+	// have been handed out return without touching body, so they may outlive this call.
+	struct shared_state_t
+	{
+		std::atomic<size_t> next{ 0 };
+		size_t remaining = 0;
+		std::exception_ptr exception;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	auto state = std::make_shared<shared_state_t>();
+	state->remaining = count;
+
+	const std::function<void(size_t)>* body_ptr = &body;
+	auto run = [state, body_ptr, count]()
+	{
+		for (size_t i = state->next++; i < count; i = state->next++)
+		{
+			std::exception_ptr exception;
+			try { (*body_ptr)(i); }
+			catch (...) { exception = std::current_exception(); }
+
+			std::lock_guard<std::mutex> lock(state->mutex);
+			if (exception && !state->exception)
+				state->exception = exception;
+			if (!--state->remaining)
+				state->done.notify_all();
+		}
+	};
+
+	size_t helpers = std::min(count - 1, m_workers.size());
+	for (size_t i = 0; i < helpers; i++)
+		Submit(run);
+
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&] { return state->remaining == 0; });
+
+	if (state->exception)
+		std::rethrow_exception(state->exception);
+}
+
+ThreadPool& ThreadPool::Global()
+{
+	static ThreadPool pool;
+	return pool;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file threadpool.h
+ * @brief Simple fixed size thread pool used for parallel asset loading
+*/
+
+#pragma once
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/**
+ * @brief A fixed set of worker threads executing queued tasks in FIFO order.
+*/
+class ThreadPool
+{
+public:
+	/**
+	 * @brief Starts the worker threads.
+	 * @param thread_count Number of workers. 0 means one less than the number of hardware threads,
+	 * since the thread calling ParallelFor() takes part in the work.
+	*/
+	explicit ThreadPool(unsigned thread_count = 0);
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * @brief Finishes all queued tasks and joins the worker threads.
+	*/
+	~ThreadPool();
+
+	/**
+	 * @brief Queues a task for execution on a worker thread.
+	 * @param task Task to run. Exceptions must not escape the task.
+	*/
+	void Submit(std::function<void()> task);
+
+	/**
+	 * @brief Runs body(i) for every i in [0, count) and waits for all of them to finish.
+	 * @details The calling thread takes part in the work, so this may also be called from
+	 * inside a task without risking a deadlock. Iterations are handed out one at a time,
+	 * so uneven iteration costs balance out. The first exception thrown by body is
+	 * rethrown in the calling thread once all started iterations have finished.
+	 * @param count Number of iterations.
+	 * @param body Function to call for each iteration.
+	*/
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+	/**
+	 * @brief Number of threads that can work on a ParallelFor(), including the caller.
+	*/
+	unsigned Concurrency() const { return (unsigned)m_workers.size() + 1; }
+
+	/**
+	 * @brief Pool shared by all loaders. Created on first use.
+	*/
+	static ThreadPool& Global();
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop = false;
+};
+
+#endif
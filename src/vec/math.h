@@ -9,7 +9,7 @@
 #define MATH_H
 
 #include <stdlib.h>
-//#include <cmath>
+#include <cmath>
 #include <algorithm>
 
 #ifndef DEBUG
@@ -0,0 +1,131 @@
+/**
+ * @file weldtable.h
+ * @brief Hash table mapping (position, normal, texcoord) index triplets to welded vertex indices
+*/
+
+#pragma once
+#ifndef WELDTABLE_H
+#define WELDTABLE_H
+
+#include <vector>
+#include <cstdint>
+#include "vec/vec.h"
+#include "arena.h"
+
+/**
+ * @brief Flat open-addressing hash table used when welding OBJ index triplets into vertices.
+ * @details Keys are (v, vn, vt) index triplets. Slots live in one array that is
+ * reused for every drawcall, so welding does no per-key allocation. The table is sized
+ * for the number of vertices a drawcall is expected to have rather than its corners,
+ * which keeps it small enough to stay in cache, and doubles if the guess was too low.
+ * The slots can live in a LoadArena.
+ * Uses linear probing and a 64-bit mix of all three indices.
+*/
+class WeldTable
+{
+public:
+	/**
+	 * @brief Creates an empty table.
+	 * @param arena Arena for the slots, nullptr to use the heap.
+	*/
+	explicit WeldTable(LoadArena* arena = nullptr) : m_slots(ArenaAllocator<slot_t>(arena)) {}
+
+	/**
+	 * @brief Empties the table and makes room for a number of keys.
+	 * @details Memory is only reallocated if the table has to grow.
+	 * @param expected_keys Number of keys that will probably be inserted, e.g. the number
+	 * of vertices expected in the drawcall. More keys are fine, the table grows.
+	*/
+	void Reset(size_t expected_keys)
+	{
+		size_t capacity = 16;
+		while (capacity < expected_keys + expected_keys / 4)
+			capacity *= 2;
+		Clear(capacity);
+	}
+
+	/**
+	 * @brief Looks up a key and inserts it if it is missing.
+	 * @param key Index triplet (x = position, y = normal, z = texcoord).
+	 * @param value Value to insert if the key is missing.
+	 * @param[out] inserted True if the key was inserted.
+	 * @return The value stored for the key.
+	*/
+	unsigned FindOrInsert(const linalg::int3& key, unsigned value, bool& inserted)
+	{
+		if (m_count >= m_limit)
+			Grow();
+
+		for (size_t i = Hash(key) & m_mask;; i = (i + 1) & m_mask)
+		{
+			slot_t& slot = m_slots[i];
+			if (slot.value == EmptySlot)
+			{
+				slot.key = key;
+				slot.value = value;
+				m_count++;
+				inserted = true;
+				return value;
+			}
+			if (slot.key.x == key.x && slot.key.y == key.y && slot.key.z == key.z)
+			{
+				inserted = false;
+				return slot.value;
+			}
+		}
+	}
+
+private:
+	static const unsigned EmptySlot = ~0u;
+
+	struct slot_t
+	{
+		linalg::int3 key;
+		unsigned value = EmptySlot;
+	};
+
+	// Empties the first capacity slots (a power of two) and uses them
+	void Clear(size_t capacity)
+	{
+		if (m_slots.size() < capacity)
+			m_slots.resize(capacity);
+		m_mask = capacity - 1;
+		m_count = 0;
+		m_limit = capacity - capacity / 5; // keep the load factor below 0.8
+
+		for (size_t i = 0; i < capacity; i++)
+			m_slots[i].value = EmptySlot;
+	}
+
+	// Doubles the capacity and inserts the keys again
+	void Grow()
+	{
+		const ArenaVector<slot_t> keys(m_slots.begin(), m_slots.begin() + m_mask + 1, m_slots.get_allocator());
+		Clear(2 * (m_mask + 1));
+		bool inserted;
+		for (const slot_t& slot : keys)
+			if (slot.value != EmptySlot)
+				FindOrInsert(slot.key, slot.value, inserted);
+	}
+
+	static size_t Hash(const linalg::int3& key)
+	{
+		uint64_t h = (uint64_t)(uint32_t)key.x | (uint64_t)(uint32_t)key.y << 32;
+		h ^= (uint64_t)(uint32_t)key.z * 0x9E3779B97F4A7C15ull;
+
+		// murmur3 finalizer
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDull;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		h ^= h >> 33;
+		return (size_t)h;
+	}
+
+	ArenaVector<slot_t> m_slots;
+	size_t m_mask = 0;
+	size_t m_count = 0;	// keys in the table
+	size_t m_limit = 0;	// keys the table holds before it grows
+};
+
+#endif